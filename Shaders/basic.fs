@@ -19,12 +19,23 @@ in vec3 FragPos;
 in vec3 Normal;  
 in vec2 TexCoords;
   
-uniform vec3 viewPos;
 uniform Material material;
-uniform Light light;
+
+// per-frame constants, learnopengl/frame_constants.h ; the same block as the vertex shader's
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    int lightCount;
+    Light lights[4];
+};
 
 void main()
 {
+    Light light = lights[0];
+
     // ambient
     vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
   	
@@ -18,16 +18,26 @@ struct Material{
 	float shininess;
 };
 
-uniform vec3 viewPos;
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 //uniform sampler2D texture_normal1;
-uniform Light light;
 uniform Material material;
 
+// per-frame constants, learnopengl/frame_constants.h ; the same block as the vertex shader's
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    int lightCount;
+    Light lights[4];
+};
+
 // Gooch Shading
 void main()
 {   
+	Light light = lights[0];
 	// init consts and vectors
 
 	vec3 normalVec = normalize(Normal);
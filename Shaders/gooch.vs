@@ -8,13 +8,28 @@ out vec3 Normal;
 out vec3 FragPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// per-frame constants, learnopengl/frame_constants.h
+struct Light {
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    int lightCount;
+    Light lights[4];
+};
 
 void main()
 {
 	FragPos = vec3(model * vec4(aPos,1.0f)); // Pixel pos in world coords
 	Normal = mat3(transpose(inverse(model))) * aNormal;
     TexCoords = aTexCoords;    
-    gl_Position = projection * view *  vec4(FragPos, 1.0);
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
 }
\ No newline at end of file
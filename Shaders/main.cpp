@@ -9,6 +9,7 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/frame_constants.h>
 
 #include <iostream>
 
@@ -94,6 +95,9 @@ int main()
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+	// camera and light of the frame, uploaded once per frame : the draws only set model and material
+	FrameConstantsBuffer frameConstants;
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -126,20 +130,24 @@ int main()
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
 
         // render the loaded model
         glm::mat4 model;
         model = glm::translate(model, glm::vec3(0.0f, -1.75f, 0.0f)); // translate it down so it's at the center of the scene
         model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));	// it's a bit too big for our scene, so scale it down
 
-		// light properties
-		ourShader.setVec3("light.position", glm::vec3(pmodel[3]));
-		ourShader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-		ourShader.setVec3("light.diffuse", 0.5f, 0.5f, 0.5f);
-		ourShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-		ourShader.setVec3("viewPos", camera.Position);
+		// camera and light properties
+		FrameConstants constants;
+		constants.View = view;
+		constants.Projection = projection;
+		constants.ViewProjection = projection * view;
+		constants.ViewPos = camera.Position;
+		constants.LightCount = 1;
+		constants.Lights[0].Position = pmodel[3];
+		constants.Lights[0].Ambient = glm::vec4(0.2f, 0.2f, 0.2f, 0.0f);
+		constants.Lights[0].Diffuse = glm::vec4(0.5f, 0.5f, 0.5f, 0.0f);
+		constants.Lights[0].Specular = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+		frameConstants.Upload(constants);
 
 		// material properties
 		ourShader.setVec3("material.specular", 0.2f, 0.2f, 0.2f);
@@ -161,6 +169,9 @@ int main()
         glfwPollEvents();
     }
 
+	// the uniform buffer, while the context still exists
+	frameConstants.Release();
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
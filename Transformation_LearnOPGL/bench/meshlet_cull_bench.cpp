@@ -0,0 +1,167 @@
+// Meshlet culling (learnopengl/meshlet.h) checked against a brute-force reference, without a window :
+// a bumpy UV sphere (a stand-in for rock.obj) is split into meshlets, then seen from cameras all around it,
+// near and far, looking at it or past it. The reference keeps every triangle that faces the camera and is not
+// fully outside one frustum plane ; the culler must keep all of those, and the bench prints how many it keeps
+// on top. Exits with 1 if a visible triangle was culled.
+// Usage : meshlet_cull_bench [sphereSegments]
+// Build : compile with -Iincludes (GLM and glad headers on the include path) ; no GL function is called.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/vertex_cache.h>
+#include <learnopengl/meshlet.h>
+
+using namespace std;
+
+// UV sphere with a bumpy radius and a UV seam at u = 0
+static void makeRock(int segments, vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    int rings = segments / 2;
+    for (int r = 0; r <= rings; r++)
+    {
+        for (int s = 0; s <= segments; s++)
+        {
+            float theta = 3.14159265f * r / rings, phi = 6.2831853f * (s % segments) / segments;
+            glm::vec3 direction(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+            float bump = 1.0f + 0.08f * sinf(5 * direction.x + 3 * direction.y) * cosf(4 * direction.z) + 0.02f * sinf(23 * direction.x * direction.y);
+            Vertex vertex = {};
+            vertex.Position = direction * bump;
+            vertex.Normal = direction;
+            vertex.TexCoords = glm::vec2((float)s / segments, (float)r / rings);
+            vertices.push_back(vertex);
+        }
+    }
+    // counter-clockwise seen from outside, as GL_CULL_FACE expects
+    for (int r = 0; r < rings; r++)
+    {
+        for (int s = 0; s < segments; s++)
+        {
+            unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+            if (r != 0)
+            {
+                indices.push_back(a); indices.push_back(a + 1); indices.push_back(b);
+            }
+            if (r != rings - 1)
+            {
+                indices.push_back(a + 1); indices.push_back(b + 1); indices.push_back(b);
+            }
+        }
+    }
+}
+
+// faces the camera and is not entirely behind one of the planes
+static bool triangleVisible(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, const glm::vec4 planes[6], const glm::vec3 &camera)
+{
+    if (glm::dot(glm::cross(b - a, c - a), camera - a) <= 0)
+        return false;
+    for (int i = 0; i < 6; i++)
+    {
+        glm::vec3 n(planes[i]);
+        if (glm::dot(n, a) + planes[i].w < 0 && glm::dot(n, b) + planes[i].w < 0 && glm::dot(n, c) + planes[i].w < 0)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int segments = argc > 1 ? atoi(argv[1]) : 256;
+
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    makeRock(segments, vertices, indices);
+    OptimizeVertexCache(indices, vertices.size());
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<Meshlet> meshlets;
+    BuildMeshlets(indices, indices.size(), vertices, meshlets);
+    double buildTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t triangleCount = indices.size() / 3;
+    unsigned int maxVertices = 0, maxTriangles = 0, withCone = 0;
+    for (size_t i = 0; i < meshlets.size(); i++)
+    {
+        maxVertices = glm::max(maxVertices, meshlets[i].VertexCount);
+        maxTriangles = glm::max(maxTriangles, meshlets[i].TriangleCount);
+        withCone += meshlets[i].ConeCutoff < 1.0f;
+    }
+    printf("%zu triangles, %zu vertices -> %zu meshlets (up to %u vertices, %u triangles), %u with a usable cone, built in %.1f ms\n\n",
+        triangleCount, vertices.size(), meshlets.size(), maxVertices, maxTriangles, withCone, buildTime * 1000);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, -1.0f, 0.5f)), glm::vec3(1.5f, 1.5f, 1.5f));
+    const float distances[] = {1.2f, 2.0f, 4.0f, 10.0f, 40.0f};
+    const float aimOffsets[] = {0.0f, 1.5f, 4.0f};
+    printf("%10s %8s %12s %12s %10s %12s %12s\n", "distance", "aim", "reference", "kept", "missed", "ref ms", "cull ms");
+
+    unsigned int totalMissed = 0;
+    vector<bool> kept(triangleCount);
+    vector<GLsizei> counts;
+    vector<const void*> offsets;
+    for (int d = 0; d < 5; d++)
+    {
+        for (int o = 0; o < 3; o++)
+        {
+            unsigned int reference = 0, keptTriangles = 0, missed = 0;
+            double referenceTime = 0, cullTime = 0;
+            // cameras on a spiral around the model
+            for (int c = 0; c < 32; c++)
+            {
+                float angle = 6.2831853f * c / 32, height = sinf(angle * 3.0f) * 0.8f;
+                glm::vec3 center = glm::vec3(model[3]);
+                glm::vec3 eye = center + glm::vec3(cosf(angle), height, sinf(angle)) * distances[d] * 1.5f;
+                glm::vec3 target = center + glm::vec3(-sinf(angle), 0.0f, cosf(angle)) * aimOffsets[o];
+                glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+
+                start = chrono::steady_clock::now();
+                counts.clear();
+                offsets.clear();
+                keptTriangles += CullMeshlets(meshlets, model, projection * view, eye, counts, offsets);
+                cullTime += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+                // brute force, in world space
+                start = chrono::steady_clock::now();
+                glm::vec4 planes[6];
+                ExtractFrustumPlanes(projection * view, planes);
+                vector<bool> visible(triangleCount);
+                for (size_t t = 0; t < triangleCount; t++)
+                {
+                    glm::vec3 p[3];
+                    for (int k = 0; k < 3; k++)
+                        p[k] = glm::vec3(model * glm::vec4(vertices[indices[t * 3 + k]].Position, 1.0f));
+                    visible[t] = triangleVisible(p[0], p[1], p[2], planes, eye);
+                    reference += visible[t];
+                }
+                referenceTime += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+                fill(kept.begin(), kept.end(), false);
+                for (size_t r = 0; r < counts.size(); r++)
+                {
+                    size_t first = (size_t)offsets[r] / sizeof(unsigned int) / 3;
+                    for (size_t t = first; t < first + counts[r] / 3; t++)
+                        kept[t] = true;
+                }
+                for (size_t t = 0; t < triangleCount; t++)
+                    missed += visible[t] && !kept[t];
+            }
+            printf("%10.1f %8.1f %12u %12u %10u %12.3f %12.3f\n", distances[d], aimOffsets[o], reference / 32, keptTriangles / 32, missed,
+                referenceTime * 1000 / 32, cullTime * 1000 / 32);
+            totalMissed += missed;
+        }
+    }
+    printf("\nreference and kept are per camera ; missed is summed over the 32 cameras\n");
+    if (totalMissed != 0)
+    {
+        printf("FAILED : %u visible triangles were culled\n", totalMissed);
+        return 1;
+    }
+    return 0;
+}
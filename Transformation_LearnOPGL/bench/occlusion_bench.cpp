@@ -0,0 +1,162 @@
+// Software occlusion culling (learnopengl/occlusion.h) without a window : a big sphere (the planet) in front of
+// the camera, and boxes (the rocks) scattered behind and around it. Times the occluder rasterization with one
+// band and with one band per hardware thread (4 on a single core, to check them), and the per box test. The banded
+// depth must match the single band one, and every box the buffer calls hidden is checked against the analytic
+// sphere, sampling points over the box faces. Exits with 1 if the depths differ or a box with a visible point was culled.
+// Usage : occlusion_bench [boxes] [sphereSegments]
+// Build : compile with -Iincludes (GLM headers on the include path) ; no GL function is called.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/occlusion.h>
+
+using namespace std;
+
+// UV sphere ; its triangles are inside the true sphere, so it never hides more than the sphere would
+static void makeSphere(int segments, float radius, vector<glm::vec3> &positions, vector<unsigned int> &indices)
+{
+    int rings = segments / 2;
+    for (int r = 0; r <= rings; r++)
+        for (int s = 0; s <= segments; s++)
+        {
+            float theta = 3.14159265f * r / rings, phi = 6.2831853f * s / segments;
+            positions.push_back(glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)) * radius);
+        }
+    for (int r = 0; r < rings; r++)
+        for (int s = 0; s < segments; s++)
+        {
+            unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+            indices.push_back(a); indices.push_back(a + 1); indices.push_back(b);
+            indices.push_back(a + 1); indices.push_back(b + 1); indices.push_back(b);
+        }
+}
+
+// the segment from eye to point goes through the sphere before reaching point
+static bool hiddenBySphere(const glm::vec3 &eye, const glm::vec3 &point, const glm::vec3 &center, float radius)
+{
+    glm::vec3 d = point - eye, m = eye - center;
+    float a = glm::dot(d, d), b = glm::dot(m, d), c = glm::dot(m, m) - radius * radius;
+    float discriminant = b * b - a * c;
+    if (discriminant < 0)
+        return false;
+    float t = (-b - sqrtf(discriminant)) / a;
+    return t > 0 && t < 1;
+}
+
+// some point of the box faces is not hidden (a 5 x 5 grid on each face)
+static bool boxVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::vec3 &eye, const glm::vec3 &center, float radius)
+{
+    for (int axis = 0; axis < 3; axis++)
+        for (int side = 0; side < 2; side++)
+            for (int i = 0; i < 5; i++)
+                for (int j = 0; j < 5; j++)
+                {
+                    glm::vec3 t;
+                    t[axis] = (float)side;
+                    t[(axis + 1) % 3] = i / 4.0f;
+                    t[(axis + 2) % 3] = j / 4.0f;
+                    if (!hiddenBySphere(eye, boundsMin + (boundsMax - boundsMin) * t, center, radius))
+                        return true;
+                }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    int boxCount = argc > 1 ? atoi(argv[1]) : 10000;
+    int segments = argc > 2 ? atoi(argv[2]) : 64;
+
+    glm::vec3 center(0.0f, 0.0f, -20.0f);
+    float radius = 6.0f;
+    vector<glm::vec3> positions;
+    vector<unsigned int> indices;
+    makeSphere(segments, radius, positions, indices);
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), center);
+
+    // boxes of 0.2 to 1 unit, from just behind the sphere to far away, a bit wider than the view
+    mt19937 random(1234);
+    uniform_real_distribution<float> depth(-100.0f, -27.0f), spread(-1.0f, 1.0f), size(0.2f, 1.0f);
+    vector<glm::vec3> boxMin(boxCount), boxMax(boxCount);
+    for (int i = 0; i < boxCount; i++)
+    {
+        float z = depth(random);
+        glm::vec3 c(spread(random) * -z * 0.5f, spread(random) * -z * 0.3f, z);
+        glm::vec3 half(size(random) * 0.5f);
+        boxMin[i] = c - half;
+        boxMax[i] = c + half;
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 200.0f);
+    unsigned int threads = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1;
+    printf("%d boxes, occluder of %zu triangles, %dx%d buffer, %u hardware threads\n\n", boxCount, indices.size() / 3,
+        OCCLUSION_WIDTH, OCCLUSION_HEIGHT, threads);
+    printf("%8s %8s %14s %14s %10s %10s\n", "camera", "bands", "rasterize ms", "test us/box", "occluded", "wrong");
+
+    unsigned int totalWrong = 0;
+    const unsigned int bandCounts[] = {1, threads > 1 ? threads : 4};
+    vector<vector<float> > singleBandDepth(4);
+    for (int b = 0; b < 2; b++)
+    {
+        OcclusionBuffer buffer(OCCLUSION_WIDTH, OCCLUSION_HEIGHT, bandCounts[b]);
+        // cameras sliding sideways : the sphere in the middle of the view, then near its edge
+        for (int c = 0; c < 4; c++)
+        {
+            glm::vec3 eye(c * 3.0f, c * 1.0f, 0.0f);
+            glm::mat4 viewProjection = projection * glm::lookAt(eye, eye + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+            const int runs = 50;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            for (int r = 0; r < runs; r++)
+            {
+                buffer.Clear();
+                buffer.AddOccluder(&positions[0], sizeof(glm::vec3), positions.size(), &indices[0], indices.size(), viewProjection * model);
+                buffer.Rasterize();
+            }
+            double rasterizeTime = chrono::duration<double>(chrono::steady_clock::now() - start).count() / runs;
+            if (b == 0)
+                singleBandDepth[c] = buffer.Depth();
+            else if (buffer.Depth() != singleBandDepth[c])
+            {
+                printf("FAILED : %u bands give another depth buffer than 1 band\n", buffer.Bands());
+                return 1;
+            }
+
+            vector<bool> visible(boxCount);
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < boxCount; i++)
+                visible[i] = buffer.IsVisible(boxMin[i], boxMax[i], viewProjection);
+            double testTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            // every box called hidden must be hidden by the true sphere
+            unsigned int occluded = 0, wrong = 0;
+            for (int i = 0; i < boxCount; i++)
+            {
+                if (visible[i])
+                    continue;
+                glm::vec4 p = viewProjection * glm::vec4((boxMin[i] + boxMax[i]) * 0.5f, 1.0f);
+                // off screen boxes are hidden too, but that is the frustum's business
+                if (fabsf(p.x) > p.w || fabsf(p.y) > p.w)
+                    continue;
+                occluded++;
+                wrong += boxVisible(boxMin[i], boxMax[i], eye, center, radius);
+            }
+            printf("%8d %8u %14.3f %14.3f %10u %10u\n", c, buffer.Bands(), rasterizeTime * 1000, testTime * 1e6 / boxCount, occluded, wrong);
+            totalWrong += wrong;
+        }
+    }
+    if (totalWrong != 0)
+    {
+        printf("\nFAILED : %u boxes with a visible point were culled\n", totalWrong);
+        return 1;
+    }
+    return 0;
+}
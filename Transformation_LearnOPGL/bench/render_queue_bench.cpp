@@ -0,0 +1,140 @@
+// Render queue (learnopengl/render_queue.h) without a window : a mixed scene of nanosuits (7 meshes, 7 texture sets,
+// float vertices), rocks (1 mesh, compressed vertices) and planets (1 mesh, float vertices), spawned in random order
+// and drawn one mesh at a time. Counts the program, texture set and vertex array changes of a frame drawn
+//  naive     : in container order, everything bound for every mesh (what Mesh::Draw did)
+//  tracked   : in container order, through a RenderStateTracker
+//  sorted    : radix sorted on the keys, through a RenderStateTracker
+// and times the key build and sort against std::stable_sort. Exits with 1 if the radix order differs from it.
+// Usage : render_queue_bench [rocks] [nanosuits] [planets] [frames]
+// Build : compile with -Iincludes (GLM headers on the include path) ; no GL function is called.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/render_queue.h>
+
+using namespace std;
+
+// one mesh to draw : the state it needs and its distance to the camera
+struct Draw {
+    unsigned int Program, Material, VertexArray;
+    float Depth;
+};
+
+const unsigned int PROGRAM = 3;
+const unsigned int FLOAT_ARENA = 1, COMPRESSED_ARENA = 2;
+const unsigned int NANOSUIT_MESHES = 7;
+const unsigned int ROCK_MATERIAL = NANOSUIT_MESHES + 1, PLANET_MATERIAL = NANOSUIT_MESHES + 2;
+const float FAR_DEPTH = 100.0f;
+
+static bool keyLess(const RenderPacket &a, const RenderPacket &b)
+{
+    return a.Key < b.Key;
+}
+
+static unsigned int countChanges(const vector<Draw> &draws, const RenderQueue *order)
+{
+    RenderStateTracker state;
+    for (size_t i = 0; i < draws.size(); i++)
+    {
+        const Draw &draw = draws[order ? (*order)[i].Item : i];
+        state.UseProgram(draw.Program);
+        state.BindMaterial(draw.Material);
+        state.BindVertexArray(draw.VertexArray);
+    }
+    return state.StateChanges;
+}
+
+int main(int argc, char *argv[])
+{
+    int rocks = argc > 1 ? atoi(argv[1]) : 10000;
+    int nanosuits = argc > 2 ? atoi(argv[2]) : 20;
+    int planets = argc > 3 ? atoi(argv[3]) : 4;
+    int frames = argc > 4 ? atoi(argv[4]) : 100;
+
+    // models in spawn order ; 0 rock, 1 nanosuit, 2 planet
+    vector<int> models;
+    models.insert(models.end(), rocks, 0);
+    models.insert(models.end(), nanosuits, 1);
+    models.insert(models.end(), planets, 2);
+    mt19937 random(7);
+    shuffle(models.begin(), models.end(), random);
+    uniform_real_distribution<float> distance(1.0f, FAR_DEPTH);
+
+    vector<Draw> draws;
+    for (size_t m = 0; m < models.size(); m++)
+    {
+        Draw draw;
+        draw.Program = PROGRAM;
+        draw.Depth = distance(random);
+        if (models[m] == 0)
+        {
+            draw.Material = ROCK_MATERIAL;
+            draw.VertexArray = COMPRESSED_ARENA;
+            draws.push_back(draw);
+        }
+        else if (models[m] == 1)
+        {
+            draw.VertexArray = FLOAT_ARENA;
+            for (unsigned int mesh = 0; mesh < NANOSUIT_MESHES; mesh++)
+            {
+                draw.Material = mesh + 1;
+                draws.push_back(draw);
+            }
+        }
+        else
+        {
+            draw.Material = PLANET_MATERIAL;
+            draw.VertexArray = FLOAT_ARENA;
+            draws.push_back(draw);
+        }
+    }
+    printf("%d rocks, %d nanosuits, %d planets : %zu meshes drawn, %d frames\n\n", rocks, nanosuits, planets, draws.size(), frames);
+
+    RenderQueue queue;
+    vector<RenderPacket> reference;
+    double radixTime = 0, stdTime = 0;
+    bool same = true;
+    for (int f = 0; f < frames; f++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        queue.Clear();
+        for (size_t i = 0; i < draws.size(); i++)
+            queue.Push(MakeSortKey(RENDER_PASS_OPAQUE, draws[i].Program, draws[i].Material, draws[i].VertexArray, draws[i].Depth, FAR_DEPTH), (unsigned int)i);
+        queue.Sort();
+        radixTime += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        reference.clear();
+        for (size_t i = 0; i < draws.size(); i++)
+        {
+            RenderPacket packet;
+            packet.Key = MakeSortKey(RENDER_PASS_OPAQUE, draws[i].Program, draws[i].Material, draws[i].VertexArray, draws[i].Depth, FAR_DEPTH);
+            packet.Item = (unsigned int)i;
+            reference.push_back(packet);
+        }
+        stable_sort(reference.begin(), reference.end(), keyLess);
+        stdTime += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        for (size_t i = 0; i < reference.size(); i++)
+            same = same && reference[i].Item == queue[i].Item;
+    }
+
+    printf("%10s %16s\n", "order", "changes/frame");
+    printf("%10s %16zu\n", "naive", draws.size() * 3);
+    printf("%10s %16u\n", "tracked", countChanges(draws, NULL));
+    printf("%10s %16u\n", "sorted", countChanges(draws, &queue));
+    printf("\nkeys + sort : radix %.3f ms, std::stable_sort %.3f ms\n", radixTime * 1000 / frames, stdTime * 1000 / frames);
+    if (!same)
+    {
+        printf("FAILED : the radix order differs from std::stable_sort\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#ifndef ASYNC_LOADER_H
+#define ASYNC_LOADER_H
+
+#include <learnopengl/model.h>
+#include <learnopengl/mpsc_queue.h>
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads models in the background : Assimp import and texture decoding run on worker threads,
+// finished models wait in a lock-free queue, and the render thread uploads them a few at a time
+// (Pump) so a big file like nanosuit.obj never stalls a frame.
+class AsyncModelLoader
+{
+public:
+    // 0 threads = one per hardware thread, minus the render thread
+    explicit AsyncModelLoader(unsigned int threadCount = 0) : stopping(false), pending(0), uploading(NULL), uploadStep(0)
+    {
+        if (threadCount == 0)
+            threadCount = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1;
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.push_back(std::thread(&AsyncModelLoader::workerLoop, this));
+    }
+
+    ~AsyncModelLoader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+
+        // drop whatever was loaded but never uploaded
+        for (unsigned int i = 0; i < requests.size(); i++)
+            delete requests[i];
+        if (uploading)
+            discard(uploading);
+        Job *job;
+        while (finished.Pop(job))
+            discard(job);
+    }
+
+    // queues path for loading ; the model shows up in Pump's vector once it is on the GPU.
+    // compress : quantized vertices, see CompressVertices in learnopengl/mesh.h
+    void Load(const string &path, glm::vec3 pos, glm::vec3 mscale, bool compress = false)
+    {
+        Job *job = new Job();
+        job->path = path;
+        job->pos = pos;
+        job->mscale = mscale;
+        job->compress = compress;
+        job->model = NULL;
+        job->ok = false;
+        pending++;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(job);
+        }
+        wakeUp.notify_one();
+    }
+
+    // render thread, once per frame : uploads finished models (textures first, then one mesh per step)
+    // until budgetSeconds is spent, and appends every model that is complete to models
+    void Pump(std::vector<Model> &models, double budgetSeconds)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (;;)
+        {
+            if (!uploading)
+            {
+                if (!finished.Pop(uploading))
+                    return;
+                if (!uploading->ok)
+                {
+                    discard(uploading);
+                    uploading = NULL;
+                    continue;
+                }
+                uploading->model = new Model(uploading->pos, uploading->mscale);
+                uploading->model->directory = uploading->data.directory;
+                uploading->model->Source = Model::SourceId(uploading->path, uploading->compress);
+                uploadStep = 0;
+            }
+
+            // at least one step per call, so a single huge texture cannot stall the queue
+            if (uploading->model->UploadStep(uploading->data, uploadStep))
+            {
+                models.push_back(*uploading->model);
+                discard(uploading);
+                uploading = NULL;
+            }
+
+            if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= budgetSeconds)
+                return;
+        }
+    }
+
+    // models requested and not yet handed out by Pump
+    unsigned int Pending() const { return pending; }
+
+private:
+    struct Job {
+        string path;
+        glm::vec3 pos;
+        glm::vec3 mscale;
+        bool compress;
+        ModelData data;
+        bool ok;
+        Model *model;
+    };
+
+    std::vector<std::thread> workers;
+    std::deque<Job*> requests; // guarded by mutex ; only touched when a load is requested
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping;
+    MPSCQueue<Job*> finished; // workers push, the render thread pops ; the destructor discards what is left
+    std::atomic<unsigned int> pending;
+
+    // render thread only
+    Job *uploading;
+    size_t uploadStep;
+
+    void discard(Job *job)
+    {
+        FreeModelData(job->data);
+        delete job->model;
+        delete job;
+        pending--;
+    }
+
+    void workerLoop()
+    {
+        for (;;)
+        {
+            Job *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this]() { return stopping || !requests.empty(); });
+                if (stopping)
+                    return;
+                job = requests.front();
+                requests.pop_front();
+            }
+            job->ok = Model::LoadModelData(job->path, job->data, job->compress);
+            finished.Push(job);
+        }
+    }
+
+    AsyncModelLoader(const AsyncModelLoader &);
+    AsyncModelLoader &operator=(const AsyncModelLoader &);
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef FRAME_CONSTANTS_H
+#define FRAME_CONSTANTS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_state.h>
+
+#include <cstddef>
+
+// Per-frame constants shared by every program : one uniform buffer, uploaded once per frame and bound at
+// FRAME_CONSTANTS_BINDING, read by the std140 block FrameConstants of the shaders. The Shader constructors point
+// the block of each program at that binding, so the camera and the lights are set once for all of them and
+// per-object uniforms are the only ones a draw sends.
+//
+// GLSL side, the same in every stage that reads it (GLSL 3.30 has no layout(binding)) :
+//     struct Light { vec3 position; vec3 ambient; vec3 diffuse; vec3 specular; };
+//     layout (std140) uniform FrameConstants
+//     {
+//         mat4 view; mat4 projection; mat4 viewProjection;
+//         vec3 viewPos; int lightCount;
+//         Light lights[FRAME_CONSTANTS_MAX_LIGHTS];
+//     };
+
+const GLuint FRAME_CONSTANTS_BINDING = 0;
+const int FRAME_CONSTANTS_MAX_LIGHTS = 4;
+
+// std140 : every vec3 of a light starts a new 16-byte slot, w is padding
+struct FrameLight {
+    glm::vec4 Position;
+    glm::vec4 Ambient;
+    glm::vec4 Diffuse;
+    glm::vec4 Specular;
+};
+
+// std140 : ViewPos ends at 204 and LightCount fills the rest of its slot
+struct FrameConstants {
+    glm::mat4 View;
+    glm::mat4 Projection;
+    glm::mat4 ViewProjection;
+    glm::vec3 ViewPos;
+    int LightCount;
+    FrameLight Lights[FRAME_CONSTANTS_MAX_LIGHTS];
+};
+
+static_assert(offsetof(FrameConstants, ViewPos) == 192 && offsetof(FrameConstants, LightCount) == 204 &&
+    offsetof(FrameConstants, Lights) == 208 && sizeof(FrameLight) == 64, "FrameConstants does not match the std140 block");
+
+// points the program's FrameConstants block, if it has one, at FRAME_CONSTANTS_BINDING. The binding is program
+// state and a program loaded from its binary (learnopengl/program_cache.h) starts without it
+inline void BindFrameConstantsBlock(GLuint program)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(program, "FrameConstants");
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, blockIndex, FRAME_CONSTANTS_BINDING);
+}
+
+class FrameConstantsBuffer
+{
+public:
+    FrameConstantsBuffer() : buffer(0) {}
+
+    // deletes the buffer ; call while the context is current, before it is destroyed. The destructor leaves it
+    // to the context, which may already be gone by then
+    void Release()
+    {
+        if (buffer != 0)
+            GLState().DeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+    // once per frame, before the first draw ; the first call creates the buffer and binds it
+    void Upload(const FrameConstants &constants)
+    {
+        if (buffer == 0)
+        {
+            glGenBuffers(1, &buffer);
+            GLState().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+            // also binds the generic GL_UNIFORM_BUFFER point, to the buffer the cache already has there
+            glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, buffer);
+        }
+        GLState().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+        // a whole new store : the draws of the last frame may still read the old one
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), &constants, GL_DYNAMIC_DRAW);
+    }
+
+private:
+    GLuint buffer;
+};
+
+#endif
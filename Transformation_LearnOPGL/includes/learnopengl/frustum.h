@@ -0,0 +1,178 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <learnopengl/mesh.h>
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+// View frustum culling of whole models : the render loop puts every model's world bounding sphere in a
+// SphereBatch, a structure of arrays, so one SIMD register tests the same plane against 4 (SSE) or
+// 8 (AVX, when built with /arch:AVX or -mavx) spheres at once. Header-only, for this tree ; Transformations
+// culls its own way, with a thread pool, in sources/frustumcull.cpp.
+
+// the six planes of a clip matrix (Gribb & Hartmann), normalized : a point p is inside when dot(plane, vec4(p, 1)) >= 0 for all.
+// With clip = projection * view the planes are in world space, with projection * view * model in model space.
+inline void ExtractFrustumPlanes(const glm::mat4 &clip, glm::vec4 planes[6])
+{
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+        row[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+    planes[0] = row[3] + row[0];
+    planes[1] = row[3] - row[0];
+    planes[2] = row[3] + row[1];
+    planes[3] = row[3] - row[1];
+    planes[4] = row[3] + row[2];
+    planes[5] = row[3] - row[2];
+    for (int i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+// sphere centered on the bounding box of the vertices that holds all of them ; not the smallest one, but close for most meshes
+inline void BoundingSphere(const vector<Vertex> &vertices, glm::vec3 &center, float &radius)
+{
+    center = glm::vec3(0.0f);
+    radius = 0.0f;
+    if (vertices.empty())
+        return;
+    glm::vec3 boundsMin = vertices[0].Position, boundsMax = boundsMin;
+    for (unsigned int i = 1; i < vertices.size(); i++)
+    {
+        boundsMin = glm::min(boundsMin, vertices[i].Position);
+        boundsMax = glm::max(boundsMax, vertices[i].Position);
+    }
+    center = (boundsMin + boundsMax) * 0.5f;
+    float radius2 = 0.0f;
+    for (unsigned int i = 0; i < vertices.size(); i++)
+        radius2 = glm::max(radius2, glm::dot(vertices[i].Position - center, vertices[i].Position - center));
+    radius = sqrtf(radius2);
+}
+
+// grows the sphere (center, radius) until it also holds (otherCenter, otherRadius)
+inline void MergeSpheres(glm::vec3 &center, float &radius, const glm::vec3 &otherCenter, float otherRadius)
+{
+    float distance = glm::length(otherCenter - center);
+    if (distance + otherRadius <= radius)
+        return;
+    if (distance + radius <= otherRadius)
+    {
+        center = otherCenter;
+        radius = otherRadius;
+        return;
+    }
+    float merged = (distance + radius + otherRadius) * 0.5f;
+    center += (otherCenter - center) * ((merged - radius) / distance);
+    radius = merged;
+}
+
+// how far matrix can stretch a length, at most : sqrt of the largest absolute row sum of M^T M (upper 3x3)
+inline float MaxScale(const glm::mat4 &matrix)
+{
+    glm::vec3 axes[3] = {glm::vec3(matrix[0]), glm::vec3(matrix[1]), glm::vec3(matrix[2])};
+    float largest = 0.0f;
+    for (int i = 0; i < 3; i++)
+    {
+        float row = 0.0f;
+        for (int j = 0; j < 3; j++)
+            row += fabsf(glm::dot(axes[i], axes[j]));
+        largest = glm::max(largest, row);
+    }
+    return sqrtf(largest);
+}
+
+struct CullStats {
+    unsigned int Visible;
+    unsigned int Culled;
+};
+
+// world space bounding spheres, one per instance
+class SphereBatch
+{
+public:
+    vector<float> X, Y, Z, Radius;
+
+    size_t Size() const { return X.size(); }
+    void Resize(size_t count) { X.resize(count); Y.resize(count); Z.resize(count); Radius.resize(count); }
+    void Set(size_t i, const glm::vec3 &center, float radius) { X[i] = center.x; Y[i] = center.y; Z[i] = center.z; Radius[i] = radius; }
+
+    // visible[i] = 1 when sphere i touches the frustum of viewProjection, 0 when it is entirely outside one plane
+    CullStats Cull(const glm::mat4 &viewProjection, vector<unsigned char> &visible) const
+    {
+        glm::vec4 planes[6];
+        ExtractFrustumPlanes(viewProjection, planes);
+        size_t count = Size();
+        visible.resize(count);
+        CullStats stats;
+        stats.Visible = 0;
+        size_t i = 0;
+#if defined(FRUSTUM_AVX)
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 x = _mm256_loadu_ps(&X[i]), y = _mm256_loadu_ps(&Y[i]), z = _mm256_loadu_ps(&Z[i]);
+            __m256 minusRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&Radius[i]));
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < 6; p++)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(planes[p].x)), _mm256_mul_ps(y, _mm256_set1_ps(planes[p].y))),
+                    _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(planes[p].z)), _mm256_set1_ps(planes[p].w)));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, minusRadius, _CMP_GE_OQ));
+            }
+            int mask = _mm256_movemask_ps(inside);
+            for (int k = 0; k < 8; k++)
+                visible[i + k] = (mask >> k) & 1;
+            stats.Visible += bitCount(mask);
+        }
+#elif defined(FRUSTUM_SSE)
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(&X[i]), y = _mm_loadu_ps(&Y[i]), z = _mm_loadu_ps(&Z[i]);
+            __m128 minusRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&Radius[i]));
+            __m128 inside = _mm_cmpeq_ps(minusRadius, minusRadius); // all ones, radii are never NaN
+            for (int p = 0; p < 6; p++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(planes[p].x)), _mm_mul_ps(y, _mm_set1_ps(planes[p].y))),
+                    _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(planes[p].z)), _mm_set1_ps(planes[p].w)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, minusRadius));
+            }
+            int mask = _mm_movemask_ps(inside);
+            for (int k = 0; k < 4; k++)
+                visible[i + k] = (mask >> k) & 1;
+            stats.Visible += bitCount(mask);
+        }
+#endif
+        // the tail, one sphere at a time (everything without SSE)
+        for (; i < count; i++)
+        {
+            bool inside = true;
+            for (int p = 0; p < 6; p++)
+                inside = inside && (planes[p].x * X[i] + planes[p].y * Y[i]) + (planes[p].z * Z[i] + planes[p].w) >= -Radius[i];
+            visible[i] = inside ? 1 : 0;
+            stats.Visible += inside ? 1 : 0;
+        }
+        stats.Culled = (unsigned int)count - stats.Visible;
+        return stats;
+    }
+
+private:
+    static unsigned int bitCount(int mask)
+    {
+        unsigned int bits = 0;
+        for (; mask; mask &= mask - 1)
+            bits++;
+        return bits;
+    }
+};
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+using namespace std;
+
+// Merged geometry : every mesh of one vertex format lives in the same vertex buffer and the same element buffer,
+// behind a single vertex array, as a range of each (see Mesh::range). Indices stay relative to the mesh's first
+// vertex and are drawn with a base vertex, so a range can move without rewriting them. Freed ranges go back to a
+// free list ; when the holes they leave grow past a quarter of a buffer, Compact packs the live ranges again.
+
+// starting sizes of the buffers, in vertices and in indices ; they double when full
+const size_t GEOMETRY_ARENA_VERTICES = 1 << 16;
+const size_t GEOMETRY_ARENA_INDICES = 1 << 18;
+
+// first fit allocator over [0, Capacity()), in elements
+class RangeAllocator
+{
+public:
+    RangeAllocator() : capacity(0), used(0) {}
+
+    size_t Capacity() const { return capacity; }
+    size_t Used() const { return used; }
+
+    // false when no free block holds size elements
+    bool Allocate(size_t size, size_t &offset)
+    {
+        offset = 0;
+        if (size == 0)
+            return true;
+        for (size_t i = 0; i < free.size(); i++)
+        {
+            if (free[i].Size < size)
+                continue;
+            offset = free[i].Offset;
+            free[i].Offset += size;
+            free[i].Size -= size;
+            if (free[i].Size == 0)
+                free.erase(free.begin() + i);
+            used += size;
+            return true;
+        }
+        return false;
+    }
+
+    // gives back a block, merged with the free blocks around it
+    void Free(size_t offset, size_t size)
+    {
+        if (size == 0)
+            return;
+        used -= size;
+        insert(offset, size);
+    }
+
+    // more room at the end
+    void Grow(size_t newCapacity)
+    {
+        if (newCapacity > capacity)
+            insert(capacity, newCapacity - capacity);
+        capacity = max(capacity, newCapacity);
+    }
+
+    // largest block Allocate can hand out
+    size_t Largest() const
+    {
+        size_t largest = 0;
+        for (size_t i = 0; i < free.size(); i++)
+            largest = max(largest, free[i].Size);
+        return largest;
+    }
+
+    // end of the last block in use : the free block at the end, if any, starts there
+    size_t End() const
+    {
+        if (!free.empty() && free.back().Offset + free.back().Size == capacity)
+            return free.back().Offset;
+        return capacity;
+    }
+
+    // free room before the last block in use : what packing would give back to the end
+    size_t Holes() const { return End() - used; }
+
+    // the blocks in use were moved to [0, Used())
+    void Pack()
+    {
+        free.clear();
+        if (used < capacity)
+            free.push_back(Block(used, capacity - used));
+    }
+
+private:
+    struct Block {
+        size_t Offset, Size;
+        Block(size_t offset, size_t size) : Offset(offset), Size(size) {}
+    };
+
+    vector<Block> free; // sorted by offset, never two touching
+    size_t capacity, used;
+
+    void insert(size_t offset, size_t size)
+    {
+        size_t i = 0;
+        while (i < free.size() && free[i].Offset < offset)
+            i++;
+        if (i > 0 && free[i - 1].Offset + free[i - 1].Size == offset)
+        {
+            free[i - 1].Size += size;
+            if (i < free.size() && offset + size == free[i].Offset)
+            {
+                free[i - 1].Size += free[i].Size;
+                free.erase(free.begin() + i);
+            }
+        }
+        else if (i < free.size() && offset + size == free[i].Offset)
+        {
+            free[i].Offset = offset;
+            free[i].Size += size;
+        }
+        else
+            free.insert(free.begin() + i, Block(offset, size));
+    }
+};
+
+// a mesh's share of an arena : vertices [BaseVertex, BaseVertex + VertexCount), indices [FirstIndex, FirstIndex + IndexCount)
+struct ArenaAllocation {
+    unsigned int BaseVertex, VertexCount;
+    unsigned int FirstIndex, IndexCount;
+    size_t Slot; // in the arena's list of live ranges
+};
+
+class GeometryArena
+{
+public:
+    // times Compact ran since the arena was created
+    unsigned int Compactions;
+
+    // vertexSize : bytes per vertex ; setupAttributes : the glVertexAttribPointer calls of the format, made with the
+    // vertex array and the vertex buffer bound, offsets from the start of a vertex
+    GeometryArena(size_t vertexSize, void (*setupAttributes)())
+        : Compactions(0), vertexSize(vertexSize), setupAttributes(setupAttributes), vertexArray(0), vertexBuffer(0), indexBuffer(0) {}
+
+    // the GL objects go with the context : the arenas are static and outlive it, so nothing is deleted here
+
+    // the vertex array of every mesh in the arena ; it stays the same when the buffers grow or are compacted
+    GLuint VertexArray()
+    {
+        if (vertexArray == 0)
+            glGenVertexArrays(1, &vertexArray);
+        return vertexArray;
+    }
+
+    size_t VertexCapacity() const { return vertices.Capacity(); }
+    size_t VerticesUsed() const { return vertices.Used(); }
+    size_t IndexCapacity() const { return indices.Capacity(); }
+    size_t IndicesUsed() const { return indices.Used(); }
+
+    // copies a mesh in and returns its range ; the range goes back to the free list when the last copy of the
+    // pointer is released, so the meshes sharing it (copies of a model) keep it alive. Render thread only
+    shared_ptr<ArenaAllocation> Allocate(const void *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount)
+    {
+        // packing first when the room is there but in pieces ; the new range is not live yet, so it must not happen in between
+        if (fragmented(vertices, vertexCount) || fragmented(indices, indexCount))
+            Compact();
+        size_t baseVertex, firstIndex;
+        if (!reserve(vertices, vertexCount, baseVertex))
+            vertexCount = indexCount = 0;
+        else if (!reserve(indices, indexCount, firstIndex))
+        {
+            vertices.Free(baseVertex, vertexCount);
+            vertexCount = indexCount = 0;
+        }
+
+        ArenaAllocation *allocation = new ArenaAllocation;
+        allocation->BaseVertex = (unsigned int)baseVertex;
+        allocation->VertexCount = (unsigned int)vertexCount;
+        allocation->FirstIndex = (unsigned int)firstIndex;
+        allocation->IndexCount = (unsigned int)indexCount; // 0 when the arena had no room, see reserve
+        allocation->Slot = live.size();
+        live.push_back(allocation);
+
+        // through the copy target : binding the element buffer would change whatever vertex array is bound
+        if (vertexCount > 0)
+        {
+            GLState().BindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, baseVertex * vertexSize, vertexCount * vertexSize, vertexData);
+        }
+        if (indexCount > 0)
+        {
+            GLState().BindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, firstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int), indexData);
+        }
+        return shared_ptr<ArenaAllocation>(allocation, [this](ArenaAllocation *freed) { release(freed); });
+    }
+
+    // compacts when the holes left by freed meshes pass a quarter of either buffer ; call once per frame
+    bool CompactIfFragmented()
+    {
+        if (vertices.Holes() * 4 <= vertices.Capacity() && indices.Holes() * 4 <= indices.Capacity())
+            return false;
+        Compact();
+        return true;
+    }
+
+    // moves every live range to the start of new buffers of the same size, in the order they were allocated
+    void Compact()
+    {
+        GLuint packedVertices = createBuffer(vertices.Capacity() * vertexSize);
+        GLuint packedIndices = createBuffer(indices.Capacity() * sizeof(unsigned int));
+        size_t vertexEnd = 0, indexEnd = 0;
+        for (size_t i = 0; i < live.size(); i++)
+        {
+            ArenaAllocation &range = *live[i];
+            copyBuffer(vertexBuffer, packedVertices, range.BaseVertex * vertexSize, vertexEnd * vertexSize, range.VertexCount * vertexSize);
+            copyBuffer(indexBuffer, packedIndices, range.FirstIndex * sizeof(unsigned int), indexEnd * sizeof(unsigned int), range.IndexCount * sizeof(unsigned int));
+            range.BaseVertex = (unsigned int)vertexEnd;
+            range.FirstIndex = (unsigned int)indexEnd;
+            vertexEnd += range.VertexCount;
+            indexEnd += range.IndexCount;
+        }
+        GLState().DeleteBuffers(1, &vertexBuffer);
+        GLState().DeleteBuffers(1, &indexBuffer);
+        vertexBuffer = packedVertices;
+        indexBuffer = packedIndices;
+        vertices.Pack();
+        indices.Pack();
+        attachBuffers();
+        Compactions++;
+    }
+
+private:
+    size_t vertexSize;
+    void (*setupAttributes)();
+    GLuint vertexArray, vertexBuffer, indexBuffer;
+    RangeAllocator vertices, indices;
+    vector<ArenaAllocation*> live;
+
+    // true when count elements fit in allocator's free room, but in no single block of it
+    static bool fragmented(const RangeAllocator &allocator, size_t count)
+    {
+        return allocator.Largest() < count && allocator.Capacity() - allocator.Used() >= count;
+    }
+
+    // room for count elements in allocator, growing the buffer when no free block holds them. The growth starts
+    // from the end of the last block in use, not from Used() : the holes before it are no help to a large range.
+    // false, with an error, only when the buffer could not grow enough
+    bool reserve(RangeAllocator &allocator, size_t count, size_t &offset)
+    {
+        if (allocator.Allocate(count, offset))
+            return true;
+        bool isVertices = &allocator == &vertices;
+        size_t elementSize = isVertices ? vertexSize : sizeof(unsigned int);
+        size_t capacity = max(allocator.Capacity() == 0 ? (isVertices ? GEOMETRY_ARENA_VERTICES : GEOMETRY_ARENA_INDICES) : allocator.Capacity() * 2,
+            allocator.End() + count);
+        GLuint &buffer = isVertices ? vertexBuffer : indexBuffer;
+        GLuint grown = createBuffer(capacity * elementSize);
+        if (buffer != 0)
+        {
+            copyBuffer(buffer, grown, 0, 0, allocator.Capacity() * elementSize);
+            GLState().DeleteBuffers(1, &buffer);
+        }
+        buffer = grown;
+        allocator.Grow(capacity);
+        attachBuffers();
+        if (allocator.Allocate(count, offset))
+            return true;
+        cout << "ERROR::GEOMETRY_ARENA:: no room for " << count << (isVertices ? " vertices" : " indices") << " after growing to "
+             << capacity << " : the mesh is left out" << endl;
+        return false;
+    }
+
+    // the vertex array reads the current buffers
+    void attachBuffers()
+    {
+        GLState().BindVertexArray(VertexArray());
+        if (vertexBuffer != 0)
+        {
+            GLState().BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+            setupAttributes();
+        }
+        if (indexBuffer != 0)
+            GLState().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        GLState().BindVertexArray(0);
+    }
+
+    void release(ArenaAllocation *range)
+    {
+        vertices.Free(range->BaseVertex, range->VertexCount);
+        indices.Free(range->FirstIndex, range->IndexCount);
+        // keeps live in allocation order, which Compact preserves
+        live.erase(live.begin() + range->Slot);
+        for (size_t i = range->Slot; i < live.size(); i++)
+            live[i]->Slot = i;
+        delete range;
+    }
+
+    static GLuint createBuffer(size_t bytes)
+    {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        GLState().BindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+        return buffer;
+    }
+
+    static void copyBuffer(GLuint from, GLuint to, size_t fromOffset, size_t toOffset, size_t bytes)
+    {
+        if (bytes == 0)
+            return;
+        GLState().BindBuffer(GL_COPY_READ_BUFFER, from);
+        GLState().BindBuffer(GL_COPY_WRITE_BUFFER, to);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, fromOffset, toOffset, bytes);
+    }
+};
+
+#endif
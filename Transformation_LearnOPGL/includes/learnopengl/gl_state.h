@@ -0,0 +1,284 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <unordered_map>
+using namespace std;
+
+// Shadow of the GL state the renderer sets : every call compares with the last value set through the cache and
+// only reaches the driver when it differs. The learnopengl headers bind through GLState(), so the shadow stays
+// true ; after code that sets state behind its back, call Invalidate. Deleting through the cache forgets the
+// bindings of the deleted names, which GL unbinds and may hand out again.
+//
+// Tracked : program, active unit, GL_TEXTURE_2D per unit, the buffer targets of bufferSlot, vertex array, the
+// enabled attributes of each vertex array, GL_BLEND / GL_DEPTH_TEST / GL_CULL_FACE, blend function, depth function
+// and mask, cull face. Anything else passes straight through and counts as issued.
+
+// texture units shadowed ; higher units pass through
+const unsigned int GL_STATE_TEXTURE_UNITS = 16;
+
+class GLStateCache
+{
+public:
+    // calls that reached GL and calls dropped as no-ops since ResetCounters
+    unsigned int Issued;
+    unsigned int Filtered;
+
+    GLStateCache() : Issued(0), Filtered(0) { Invalidate(); }
+
+    void ResetCounters()
+    {
+        Issued = 0;
+        Filtered = 0;
+    }
+
+    // forgets everything : the next call of each kind reaches GL
+    void Invalidate()
+    {
+        for (int i = 0; i < SHADOWS; i++)
+            known[i] = false;
+        attribs.clear();
+    }
+
+    void UseProgram(GLuint program)
+    {
+        if (update(PROGRAM, program))
+            glUseProgram(program);
+    }
+
+    void ActiveTexture(GLenum unit)
+    {
+        if (update(ACTIVE_TEXTURE, unit))
+            glActiveTexture(unit);
+    }
+
+    // binds on the active unit
+    void BindTexture(GLenum target, GLuint texture)
+    {
+        GLuint unit = known[ACTIVE_TEXTURE] ? value[ACTIVE_TEXTURE] - GL_TEXTURE0 : GL_STATE_TEXTURE_UNITS;
+        if (target != GL_TEXTURE_2D || unit >= GL_STATE_TEXTURE_UNITS)
+            Issued++;
+        else if (!update(TEXTURE_UNIT_0 + unit, texture))
+            return;
+        glBindTexture(target, texture);
+    }
+
+    void BindBuffer(GLenum target, GLuint buffer)
+    {
+        int slot = bufferSlot(target);
+        if (slot < 0)
+            Issued++;
+        else if (!update(slot, buffer))
+            return;
+        glBindBuffer(target, buffer);
+    }
+
+    void BindVertexArray(GLuint vertexArray)
+    {
+        if (!update(VERTEX_ARRAY, vertexArray))
+            return;
+        glBindVertexArray(vertexArray);
+        // the element buffer binding belongs to the vertex array
+        known[ELEMENT_ARRAY_BUFFER] = false;
+    }
+
+    // on the bound vertex array
+    void EnableVertexAttribArray(GLuint index)
+    {
+        if (updateAttrib(index, true))
+            glEnableVertexAttribArray(index);
+    }
+
+    void DisableVertexAttribArray(GLuint index)
+    {
+        if (updateAttrib(index, false))
+            glDisableVertexAttribArray(index);
+    }
+
+    void Enable(GLenum capability)
+    {
+        int slot = capabilitySlot(capability);
+        if (slot < 0)
+            Issued++;
+        else if (!update(slot, GL_TRUE))
+            return;
+        glEnable(capability);
+    }
+
+    void Disable(GLenum capability)
+    {
+        int slot = capabilitySlot(capability);
+        if (slot < 0)
+            Issued++;
+        else if (!update(slot, GL_FALSE))
+            return;
+        glDisable(capability);
+    }
+
+    void BlendFunc(GLenum source, GLenum destination)
+    {
+        // one call sets both values
+        if (known[BLEND_SOURCE] && value[BLEND_SOURCE] == source && value[BLEND_DESTINATION] == destination)
+        {
+            Filtered++;
+            return;
+        }
+        value[BLEND_SOURCE] = source;
+        value[BLEND_DESTINATION] = destination;
+        known[BLEND_SOURCE] = known[BLEND_DESTINATION] = true;
+        Issued++;
+        glBlendFunc(source, destination);
+    }
+
+    void DepthFunc(GLenum function)
+    {
+        if (update(DEPTH_FUNCTION, function))
+            glDepthFunc(function);
+    }
+
+    void DepthMask(GLboolean mask)
+    {
+        if (update(DEPTH_MASK, mask))
+            glDepthMask(mask);
+    }
+
+    void CullFace(GLenum mode)
+    {
+        if (update(CULL_MODE, mode))
+            glCullFace(mode);
+    }
+
+    void DeleteProgram(GLuint program)
+    {
+        // a program in use is only flagged for deletion and stays bound : forgetting it is enough
+        if (known[PROGRAM] && value[PROGRAM] == program)
+            known[PROGRAM] = false;
+        glDeleteProgram(program);
+    }
+
+    void DeleteTextures(GLsizei count, const GLuint *textures)
+    {
+        for (GLsizei i = 0; i < count; i++)
+            for (unsigned int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++)
+                unbind(TEXTURE_UNIT_0 + unit, textures[i]);
+        glDeleteTextures(count, textures);
+    }
+
+    void DeleteBuffers(GLsizei count, const GLuint *buffers)
+    {
+        for (GLsizei i = 0; i < count; i++)
+            for (int slot = ARRAY_BUFFER; slot <= DRAW_INDIRECT_BUFFER; slot++)
+                unbind(slot, buffers[i]);
+        glDeleteBuffers(count, buffers);
+    }
+
+    void DeleteVertexArrays(GLsizei count, const GLuint *vertexArrays)
+    {
+        for (GLsizei i = 0; i < count; i++)
+        {
+            if (known[VERTEX_ARRAY] && value[VERTEX_ARRAY] == vertexArrays[i])
+            {
+                value[VERTEX_ARRAY] = 0;
+                known[ELEMENT_ARRAY_BUFFER] = false;
+            }
+            attribs.erase(vertexArrays[i]);
+        }
+        glDeleteVertexArrays(count, vertexArrays);
+    }
+
+private:
+    enum Shadow {
+        PROGRAM, ACTIVE_TEXTURE, VERTEX_ARRAY,
+        ARRAY_BUFFER, ELEMENT_ARRAY_BUFFER, COPY_READ_BUFFER, COPY_WRITE_BUFFER, UNIFORM_BUFFER, DRAW_INDIRECT_BUFFER,
+        BLEND, DEPTH_TEST, CULL_FACE, BLEND_SOURCE, BLEND_DESTINATION, DEPTH_FUNCTION, DEPTH_MASK, CULL_MODE,
+        TEXTURE_UNIT_0,
+        SHADOWS = TEXTURE_UNIT_0 + GL_STATE_TEXTURE_UNITS
+    };
+
+    // enabled attributes of one vertex array : bit i is attribute i, meaningful where known has it
+    struct AttribShadow {
+        unsigned int Enabled;
+        unsigned int Known;
+        AttribShadow() : Enabled(0), Known(0) {}
+    };
+
+    GLuint value[SHADOWS];
+    bool known[SHADOWS];
+    unordered_map<GLuint, AttribShadow> attribs; // by vertex array
+
+    // true when v is new : the caller issues the call. Counts either way
+    bool update(int slot, GLuint v)
+    {
+        if (known[slot] && value[slot] == v)
+        {
+            Filtered++;
+            return false;
+        }
+        value[slot] = v;
+        known[slot] = true;
+        Issued++;
+        return true;
+    }
+
+    bool updateAttrib(GLuint index, bool enable)
+    {
+        if (!known[VERTEX_ARRAY] || index >= 32)
+        {
+            Issued++;
+            return true;
+        }
+        AttribShadow &shadow = attribs[value[VERTEX_ARRAY]];
+        unsigned int bit = 1u << index;
+        if ((shadow.Known & bit) && ((shadow.Enabled & bit) != 0) == enable)
+        {
+            Filtered++;
+            return false;
+        }
+        shadow.Known |= bit;
+        shadow.Enabled = enable ? shadow.Enabled | bit : shadow.Enabled & ~bit;
+        Issued++;
+        return true;
+    }
+
+    // a deleted name bound somewhere reads as 0 afterwards
+    void unbind(int slot, GLuint name)
+    {
+        if (known[slot] && value[slot] == name)
+            value[slot] = 0;
+    }
+
+    static int bufferSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER: return ARRAY_BUFFER;
+        case GL_ELEMENT_ARRAY_BUFFER: return ELEMENT_ARRAY_BUFFER;
+        case GL_COPY_READ_BUFFER: return COPY_READ_BUFFER;
+        case GL_COPY_WRITE_BUFFER: return COPY_WRITE_BUFFER;
+        case GL_UNIFORM_BUFFER: return UNIFORM_BUFFER;
+        case GL_DRAW_INDIRECT_BUFFER: return DRAW_INDIRECT_BUFFER;
+        }
+        return -1;
+    }
+
+    static int capabilitySlot(GLenum capability)
+    {
+        switch (capability)
+        {
+        case GL_BLEND: return BLEND;
+        case GL_DEPTH_TEST: return DEPTH_TEST;
+        case GL_CULL_FACE: return CULL_FACE;
+        }
+        return -1;
+    }
+};
+
+// the one cache of the render thread's context
+inline GLStateCache &GLState()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/model.h>
+#include <learnopengl/render_queue.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Submission of the visible set : every mesh drawn becomes one or more indirect draw commands over its geometry
+// arena (learnopengl/geometry_arena.h), each instance reading its model matrix and position decoding from one
+// instance buffer streamed for the whole frame. Repeated models are grouped by the mesh set they share (see
+// Model(const Model &, ...)), and every group of INSTANCING_MIN_GROUP models or more takes one command per mesh and level of
+// detail ; smaller groups take one command per mesh, or per range left by its meshlet culling. The meshes go
+// through a RenderQueue (learnopengl/render_queue.h) keyed on material, vertex array and depth, and each run
+// sharing a material and a vertex array is one glMultiDrawElementsIndirect (GL 4.3), or one
+// glDrawElementsInstancedBaseVertex per command when the context is older.
+const unsigned int INSTANCING_MIN_GROUP = 2;
+
+// attribute locations of the per instance data : four for the model matrix (one per column), then the position
+// scale and offset of the mesh drawn (see cg_ufpel.vs)
+const unsigned int INSTANCE_MATRIX_LOCATION = 5;
+const unsigned int INSTANCE_SCALE_LOCATION = 9;
+const unsigned int INSTANCE_OFFSET_LOCATION = 10;
+
+// one instance : its model matrix, and the Mesh::positionScale and positionOffset of the mesh drawn
+struct InstanceData {
+    glm::mat4 Model;
+    glm::vec4 PositionScale;
+    glm::vec4 PositionOffset;
+};
+
+// the command layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint Count;
+    GLuint InstanceCount;
+    GLuint FirstIndex;
+    GLint BaseVertex;
+    GLuint BaseInstance;
+};
+
+class InstanceRenderer
+{
+public:
+    // GL draw calls, the commands they carried, the program, texture set and vertex array changes, and the
+    // models drawn through instancing by the last Submit
+    unsigned int DrawCalls;
+    unsigned int Commands;
+    unsigned int StateChanges;
+    unsigned int InstancedModels;
+
+    InstanceRenderer() : DrawCalls(0), Commands(0), StateChanges(0), InstancedModels(0), instanceBuffer(0), commandBuffer(0) {}
+
+    // deletes the buffers ; call while the context is current, before it is destroyed. The destructor leaves them
+    // to the context, which may already be gone by then
+    void Release()
+    {
+        if (instanceBuffer != 0)
+            GLState().DeleteBuffers(1, &instanceBuffer);
+        if (commandBuffer != 0)
+            GLState().DeleteBuffers(1, &commandBuffer);
+        instanceBuffer = commandBuffer = 0;
+        boundArrays.clear();
+    }
+
+    // starts a frame : no model queued
+    void Begin()
+    {
+        for (size_t i = 0; i < used.size(); i++)
+            groups[used[i]].clear();
+        used.clear();
+    }
+
+    // queues a visible model ; it must stay alive and in place until Submit
+    void Add(Model &model)
+    {
+        // a mesh set keeps its group for good : the lookup finds it without allocating, frame after frame
+        unordered_map<const vector<Mesh>*, size_t>::iterator found = groupOf.find(model.meshes.get());
+        if (found == groupOf.end())
+        {
+            found = groupOf.insert(make_pair(model.meshes.get(), groups.size())).first;
+            groups.push_back(vector<Model*>());
+        }
+        vector<Model*> &group = groups[found->second];
+        if (group.empty())
+            used.push_back(found->second);
+        group.push_back(&model);
+    }
+
+    // picks the levels of detail and draws everything queued since Begin ; shader is in use, with view and projection set.
+    // farDepth : the projection's far plane, the depth range of the sort keys
+    void Submit(Shader &shader, const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition, float pixelsPerUnit, float farDepth)
+    {
+        DrawCalls = 0;
+        Commands = 0;
+        StateChanges = 0;
+        InstancedModels = 0;
+        instances.clear();
+        pending.clear();
+        packets.clear();
+
+        for (size_t g = 0; g < used.size(); g++)
+        {
+            vector<Model*> &group = groups[used[g]];
+            if (group.size() < INSTANCING_MIN_GROUP)
+            {
+                for (size_t i = 0; i < group.size(); i++)
+                    queueSingle(*group[i], viewProjection, cameraPosition, pixelsPerUnit);
+                continue;
+            }
+            InstancedModels += (unsigned int)group.size();
+            for (size_t i = 0; i < group.size(); i++)
+                group[i]->SelectLod(cameraPosition, pixelsPerUnit);
+            queueGroup(group, cameraPosition);
+        }
+        if (packets.empty())
+            return;
+
+        // meshes sharing textures and a vertex array side by side, front to back, their commands in that order
+        queue.Clear();
+        for (size_t i = 0; i < packets.size(); i++)
+            queue.Push(MakeSortKey(RENDER_PASS_OPAQUE, shader.ID, packets[i].Source->material, packets[i].Source->VAO, packets[i].Depth, farDepth), (unsigned int)i);
+        queue.Sort();
+        sorted.resize(packets.size());
+        commands.clear();
+        for (size_t i = 0; i < queue.Size(); i++)
+        {
+            sorted[i] = packets[queue[i].Item];
+            size_t first = commands.size();
+            commands.insert(commands.end(), pending.begin() + sorted[i].First, pending.begin() + sorted[i].First + sorted[i].Count);
+            sorted[i].First = first;
+        }
+        Commands = (unsigned int)commands.size();
+
+        // one upload each ; glBufferData hands the driver a new store, so last frame's draws are not waited on
+        if (instanceBuffer == 0)
+            glGenBuffers(1, &instanceBuffer);
+        GLState().BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), &instances[0], GL_STREAM_DRAW);
+        bool indirect = GLAD_GL_VERSION_4_3 != 0;
+        if (indirect)
+        {
+            if (commandBuffer == 0)
+                glGenBuffers(1, &commandBuffer);
+            GLState().BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0], GL_STREAM_DRAW);
+        }
+
+        shader.setBool("instanced", true);
+        // the shader is already in use : the walk only changes textures and vertex arrays
+        state.Reset();
+        state.UseProgram(shader.ID);
+        boundArrays.clear();
+        for (size_t start = 0; start < sorted.size();)
+        {
+            const Mesh &mesh = *sorted[start].Source;
+            size_t end = start + 1;
+            while (end < sorted.size() && sorted[end].Source->material == mesh.material && sorted[end].Source->VAO == mesh.VAO)
+                end++;
+            size_t first = sorted[start].First;
+            size_t count = sorted[end - 1].First + sorted[end - 1].Count - first;
+            if (state.BindMaterial(mesh.material))
+                mesh.bindTextures(shader);
+            if (state.BindVertexArray(mesh.VAO))
+                GLState().BindVertexArray(mesh.VAO);
+            if (indirect)
+            {
+                // the base instance of each command picks its data : the pointers start at the buffer start
+                if (find(boundArrays.begin(), boundArrays.end(), mesh.VAO) == boundArrays.end())
+                {
+                    bindInstances(0);
+                    boundArrays.push_back(mesh.VAO);
+                }
+                glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawElementsIndirectCommand)), (GLsizei)count, 0);
+                DrawCalls++;
+            }
+            else
+            {
+                // GL 3.3 has no base instance : the attribute offsets pick the first instance
+                for (size_t i = first; i < first + count; i++)
+                {
+                    const DrawElementsIndirectCommand &command = commands[i];
+                    bindInstances(command.BaseInstance);
+                    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.Count, GL_UNSIGNED_INT, (void*)(command.FirstIndex * sizeof(unsigned int)),
+                        command.InstanceCount, command.BaseVertex);
+                }
+                DrawCalls += (unsigned int)count;
+            }
+            start = end;
+        }
+        StateChanges = state.StateChanges;
+        shader.setBool("instanced", false);
+    }
+
+private:
+    // the commands of one mesh : pending (then commands, once sorted) [First, First + Count) ; Depth is the distance
+    // from the camera to the model, the nearest one for a group
+    struct Packet {
+        const Mesh *Source;
+        size_t First;
+        size_t Count;
+        float Depth;
+    };
+
+    vector<vector<Model*> > groups;
+    unordered_map<const vector<Mesh>*, size_t> groupOf; // index in groups of each mesh set
+    vector<size_t> used; // groups with a model this frame
+    vector<InstanceData> instances;
+    vector<DrawElementsIndirectCommand> pending, commands;
+    vector<Packet> packets, sorted;
+    RenderQueue queue;
+    RenderStateTracker state;
+    vector<size_t> levelStart;
+    vector<GLuint> boundArrays; // vertex arrays whose instance attributes point at this frame's buffer
+    GLuint instanceBuffer, commandBuffer;
+
+    // one instance for each mesh of the model, and a command for each range its meshlet culling left
+    void queueSingle(Model &model, const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition, float pixelsPerUnit)
+    {
+        model.SelectLod(cameraPosition, pixelsPerUnit);
+        model.Cull(viewProjection, cameraPosition);
+        float depth = glm::length(glm::vec3(model.Matrix[3]) - cameraPosition);
+        for (size_t m = 0; m < model.meshes->size(); m++)
+        {
+            const Mesh &mesh = (*model.meshes)[m];
+            MeshDrawState &state = model.meshStates[m];
+            GLuint instance = (GLuint)instances.size();
+            instances.push_back(instanceOf(model.Matrix, mesh));
+            Packet packet;
+            packet.Source = &mesh;
+            packet.First = pending.size();
+            packet.Depth = depth;
+            if (state.culled)
+            {
+                for (size_t i = 0; i < state.drawCounts.size(); i++)
+                    addCommand(mesh, (GLuint)state.drawCounts[i], 1, (GLuint)((size_t)state.drawOffsets[i] / sizeof(unsigned int)), instance);
+                state.culled = false;
+            }
+            else
+                addCommand(mesh, mesh.lods[state.lod].IndexCount, 1, mesh.lods[state.lod].FirstIndex, instance);
+            packet.Count = pending.size() - packet.First;
+            if (packet.Count > 0)
+                packets.push_back(packet);
+        }
+    }
+
+    // the group's instances, sorted by level for every mesh (a counting sort), and one command per level in use.
+    // The models share their meshes : the first one's are drawn
+    void queueGroup(const vector<Model*> &group, const glm::vec3 &cameraPosition)
+    {
+        Model &first = *group[0];
+        float depth = glm::length(glm::vec3(first.Matrix[3]) - cameraPosition);
+        for (size_t i = 1; i < group.size(); i++)
+            depth = glm::min(depth, glm::length(glm::vec3(group[i]->Matrix[3]) - cameraPosition));
+        for (size_t m = 0; m < first.meshes->size(); m++)
+        {
+            const Mesh &mesh = (*first.meshes)[m];
+            size_t levels = mesh.lods.size();
+            levelStart.assign(levels + 1, 0);
+            for (size_t i = 0; i < group.size(); i++)
+                levelStart[group[i]->meshStates[m].lod + 1]++;
+            size_t base = instances.size();
+            Packet packet;
+            packet.Source = &mesh;
+            packet.First = pending.size();
+            packet.Depth = depth;
+            for (size_t level = 0; level < levels; level++)
+            {
+                if (levelStart[level + 1] > 0)
+                    addCommand(mesh, mesh.lods[level].IndexCount, (GLuint)levelStart[level + 1], mesh.lods[level].FirstIndex, (GLuint)(base + levelStart[level]));
+                levelStart[level + 1] += levelStart[level];
+            }
+            instances.resize(base + group.size());
+            for (size_t i = 0; i < group.size(); i++)
+                instances[base + levelStart[group[i]->meshStates[m].lod]++] = instanceOf(group[i]->Matrix, mesh);
+            packet.Count = pending.size() - packet.First;
+            if (packet.Count > 0)
+                packets.push_back(packet);
+        }
+    }
+
+    // firstIndex is relative to the mesh, moved here to its range of the arena
+    void addCommand(const Mesh &mesh, GLuint count, GLuint instanceCount, GLuint firstIndex, GLuint baseInstance)
+    {
+        if (count == 0)
+            return;
+        DrawElementsIndirectCommand command;
+        command.Count = count;
+        command.InstanceCount = instanceCount;
+        command.FirstIndex = mesh.range->FirstIndex + firstIndex;
+        command.BaseVertex = (GLint)mesh.range->BaseVertex;
+        command.BaseInstance = baseInstance;
+        pending.push_back(command);
+    }
+
+    // the instance attributes of the bound vertex array read instanceBuffer from instance first on
+    void bindInstances(size_t first)
+    {
+        GLState().BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        size_t offset = first * sizeof(InstanceData);
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            GLState().EnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + column);
+            glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                (void*)(offset + offsetof(InstanceData, Model) + column * sizeof(glm::vec4)));
+            glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + column, 1);
+        }
+        GLState().EnableVertexAttribArray(INSTANCE_SCALE_LOCATION);
+        glVertexAttribPointer(INSTANCE_SCALE_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, PositionScale)));
+        glVertexAttribDivisor(INSTANCE_SCALE_LOCATION, 1);
+        GLState().EnableVertexAttribArray(INSTANCE_OFFSET_LOCATION);
+        glVertexAttribPointer(INSTANCE_OFFSET_LOCATION, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, PositionOffset)));
+        glVertexAttribDivisor(INSTANCE_OFFSET_LOCATION, 1);
+    }
+
+    static InstanceData instanceOf(const glm::mat4 &matrix, const Mesh &mesh)
+    {
+        InstanceData data;
+        data.Model = matrix;
+        data.PositionScale = glm::vec4(mesh.positionScale.x, mesh.positionScale.y, mesh.positionScale.z, 0.0f);
+        data.PositionOffset = glm::vec4(mesh.positionOffset.x, mesh.positionOffset.y, mesh.positionOffset.z, 0.0f);
+        return data;
+    }
+};
+
+#endif
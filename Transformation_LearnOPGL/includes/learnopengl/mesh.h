@@ -5,11 +5,17 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/geometry_arena.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <fstream>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <iostream>
 #include <vector>
@@ -28,43 +34,370 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// Optional 16-byte vertex (Vertex is 56) :
+//  Position  : xyz 16-bit unsigned normalized inside the mesh bounding box, w = tangent angle around the normal
+//  Normal    : GL_INT_2_10_10_10_REV signed normalized, w = bitangent sign
+//  TexCoords : half floats
+// The tangent is rebuilt from the normal and its angle : cos(angle) * b1 + sin(angle) * b2, b1 and b2 from TangentBasis,
+// the angle in turns. The bitangent is sign * cross(normal, tangent). A shader that needs the frame must decode it so
+struct CompressedVertex {
+    unsigned short Position[4];
+    unsigned int Normal;
+    unsigned short TexCoords[2];
+};
+
+// Largest difference between the Vertex attributes and what the shader decodes from a CompressedVertex
+struct QuantizationError {
+    float Position;  // model units
+    float Normal;    // degrees
+    float Tangent;   // degrees, includes making the tangent orthogonal to the normal
+    float Bitangent; // degrees
+    float TexCoords; // texture coordinate units
+};
+
+// Orthonormal basis around unit vector n, branchless (Duff et al. 2017)
+inline void TangentBasis(const glm::vec3 &n, glm::vec3 &b1, glm::vec3 &b2)
+{
+    float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+    float a = -1.0f / (sign + n.z);
+    float b = n.x * n.y * a;
+    b1 = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+    b2 = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+}
+
+// angle in degrees between two directions, 0 if either is degenerate
+inline float AngleBetween(const glm::vec3 &a, const glm::vec3 &b)
+{
+    float lengths = glm::length(a) * glm::length(b);
+    if (lengths <= 0.0f)
+        return 0.0f;
+    return glm::degrees(acosf(std::min(std::max(glm::dot(a, b) / lengths, -1.0f), 1.0f)));
+}
+
+// Quantizes vertices (bounds are computed here) and measures what the quantization costs
+inline void CompressVertices(const vector<Vertex> &vertices, vector<CompressedVertex> &out, glm::vec3 &boundsMin, glm::vec3 &boundsMax, QuantizationError &error)
+{
+    const float TWO_PI = 6.28318530718f;
+    error.Position = error.Normal = error.Tangent = error.Bitangent = error.TexCoords = 0.0f;
+    out.resize(vertices.size());
+    if (vertices.empty())
+    {
+        boundsMin = boundsMax = glm::vec3(0.0f);
+        return;
+    }
+
+    boundsMin = boundsMax = vertices[0].Position;
+    for (unsigned int i = 1; i < vertices.size(); i++)
+    {
+        boundsMin = glm::min(boundsMin, vertices[i].Position);
+        boundsMax = glm::max(boundsMax, vertices[i].Position);
+    }
+    glm::vec3 extent = boundsMax - boundsMin;
+
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+        const Vertex &v = vertices[i];
+        CompressedVertex &c = out[i];
+
+        glm::vec3 position;
+        for (int k = 0; k < 3; k++)
+        {
+            c.Position[k] = glm::packUnorm1x16(extent[k] > 0.0f ? (v.Position[k] - boundsMin[k]) / extent[k] : 0.0f);
+            position[k] = boundsMin[k] + glm::unpackUnorm1x16(c.Position[k]) * extent[k];
+        }
+        error.Position = std::max(error.Position, glm::length(position - v.Position));
+
+        // the tangent frame is built from the normal the shader will see, not the exact one
+        float handedness = glm::dot(glm::cross(v.Normal, v.Tangent), v.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        c.Normal = glm::packSnorm3x10_1x2(glm::vec4(v.Normal, handedness));
+        glm::vec4 decoded = glm::unpackSnorm3x10_1x2(c.Normal);
+        glm::vec3 normal(decoded.x, decoded.y, decoded.z);
+        error.Normal = std::max(error.Normal, AngleBetween(v.Normal, normal));
+        if (glm::length(normal) > 0.0f)
+            normal = glm::normalize(normal);
+
+        glm::vec3 b1, b2;
+        TangentBasis(normal, b1, b2);
+        float angle = atan2f(glm::dot(v.Tangent, b2), glm::dot(v.Tangent, b1));
+        if (angle < 0.0f)
+            angle += TWO_PI;
+        c.Position[3] = glm::packUnorm1x16(angle / TWO_PI);
+        angle = glm::unpackUnorm1x16(c.Position[3]) * TWO_PI;
+        glm::vec3 tangent = cosf(angle) * b1 + sinf(angle) * b2;
+        error.Tangent = std::max(error.Tangent, AngleBetween(v.Tangent, tangent));
+        error.Bitangent = std::max(error.Bitangent, AngleBetween(v.Bitangent, decoded.w * glm::cross(normal, tangent)));
+
+        for (int k = 0; k < 2; k++)
+        {
+            c.TexCoords[k] = glm::packHalf1x16(v.TexCoords[k]);
+            error.TexCoords = std::max(error.TexCoords, fabsf(glm::unpackHalf1x16(c.TexCoords[k]) - v.TexCoords[k]));
+        }
+    }
+}
+
+// One level of detail (see learnopengl/simplify.h) : a range of the element buffer, and the error its
+// simplification reached, relative to the mesh bounding box diagonal
+struct MeshLod {
+    unsigned int FirstIndex;
+    unsigned int IndexCount;
+    float Error;
+};
+
+// A cluster of at most 64 vertices and 124 triangles of the full level (see learnopengl/meshlet.h)
+struct Meshlet {
+    unsigned int FirstIndex;    // its triangles are indices FirstIndex .. FirstIndex + TriangleCount * 3
+    unsigned int TriangleCount;
+    unsigned int VertexCount;   // distinct vertices
+    // bounding sphere, model space
+    glm::vec3 Center;
+    float Radius;
+    // backface cone : every triangle faces away from a camera at c when dot(normalize(ConeApex - c), ConeAxis) >= ConeCutoff.
+    // ConeCutoff is 1 and ConeAxis 0 when the triangles face too many ways for the test to ever pass
+    glm::vec3 ConeApex;
+    glm::vec3 ConeAxis;
+    float ConeCutoff;
+};
+
+// a level is good enough while its error covers less than this many pixels on screen
+const float LOD_PIXEL_ERROR = 1.0f;
+// a coarser level is only taken once its error is below this fraction of LOD_PIXEL_ERROR,
+// so a mesh sitting at the switch distance does not flicker between two levels
+const float LOD_HYSTERESIS = 0.7f;
+
+// attribute pointers of the two vertex formats, for their geometry arenas
+inline void SetupVertexAttributes()
+{
+    // A great thing about structs is that their memory layout is sequential for all its items.
+    // The effect is that the buffer translates perfectly to glm::vec3/2 arrays which again translate to 3/2 floats.
+    // vertex Positions
+    GLState().EnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    // vertex normals
+    GLState().EnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    // vertex texture coords
+    GLState().EnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    // vertex tangent
+    GLState().EnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+    // vertex bitangent
+    GLState().EnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+}
+
+// the vertex fetch normalizes the integers, the shader decodes the rest. Tangent and bitangent (locations 3
+// and 4) are not stored, they come out of the position w and normal w.
+inline void SetupCompressedVertexAttributes()
+{
+    // vertex Positions, tangent angle in w
+    GLState().EnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompressedVertex), (void*)offsetof(CompressedVertex, Position));
+    // vertex normals, bitangent sign in w
+    GLState().EnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompressedVertex), (void*)offsetof(CompressedVertex, Normal));
+    // vertex texture coords
+    GLState().EnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompressedVertex), (void*)offsetof(CompressedVertex, TexCoords));
+}
+
+// every Mesh of Vertex, and every Mesh of CompressedVertex, shares one arena (learnopengl/geometry_arena.h)
+inline GeometryArena &VertexArena()
+{
+    static GeometryArena arena(sizeof(Vertex), SetupVertexAttributes);
+    return arena;
+}
+
+inline GeometryArena &CompressedVertexArena()
+{
+    static GeometryArena arena(sizeof(CompressedVertex), SetupCompressedVertexAttributes);
+    return arena;
+}
+
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// What one model does with a Mesh it shares with others (see Model) : the Mesh holds the geometry, this the
+// choices made for that model's draw
+struct MeshDrawState {
+    // index in Mesh::lods ; see Mesh::SelectLod
+    unsigned int lod;
+    // CullMeshlets (learnopengl/meshlet.h) fills drawCounts and drawOffsets with the index ranges left, and sets
+    // culled so the next Draw uses them instead of lods[lod]
+    vector<GLsizei> drawCounts;
+    vector<const void*> drawOffsets;
+    vector<GLint> drawBaseVertices; // range->BaseVertex for each of drawCounts
+    bool culled;
+
+    MeshDrawState() : lod(0), culled(false) {}
+};
+
+// number of a texture set (ids and sampler types, in order), from 1 in order of first use ; meshes with the same
+// number bind the same textures (see InstanceRenderer). Render thread only
+inline unsigned int MaterialId(const vector<Texture> &textures)
+{
+    static map<string, unsigned int> ids;
+    string key;
+    for (unsigned int i = 0; i < textures.size(); i++)
+        key += to_string(textures[i].id) + ":" + textures[i].type + ";";
+    unsigned int &id = ids[key];
+    if (id == 0)
+        id = (unsigned int)ids.size();
+    return id;
+}
+
 class Mesh {
 public:
     /*  Mesh Data  */
     vector<Vertex> vertices;
     vector<unsigned int> indices;
     vector<Texture> textures;
+    unsigned int material; // MaterialId(textures)
+    // sampler of each texture, texture_diffuseN, texture_specularN, ... numbered from 1 by type, and its hash
+    vector<string> samplers;
+    vector<unsigned int> samplerHashes;
+    // the vertex array of the mesh's arena, and where the mesh lives in its buffers ; copies of the mesh share
+    // the range, which compaction may move (indices are relative to range->BaseVertex)
     unsigned int VAO;
+    shared_ptr<ArenaAllocation> range;
+    // compressed meshes decode their positions with these in the shader ; (1,1,1) and (0,0,0) otherwise
+    bool compressed;
+    glm::vec3 positionScale;
+    glm::vec3 positionOffset;
+    // levels of detail in indices, the full mesh first ; Draw uses the one of its MeshDrawState (see SelectLod)
+    vector<MeshLod> lods;
+    glm::vec3 boundsMin, boundsMax;
+    // bounding sphere for frustum culling ; the box's own sphere unless the loader sets a tighter one (see BoundingSphere)
+    glm::vec3 sphereCenter;
+    float sphereRadius;
+    // clusters of the full level, for CullMeshlets (learnopengl/meshlet.h)
+    vector<Meshlet> meshlets;
 
     /*  Functions  */
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor ; without lods, indices is a single level
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, vector<MeshLod> lods = vector<MeshLod>(), vector<Meshlet> meshlets = vector<Meshlet>())
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        material = MaterialId(textures);
+        setupSamplers();
+        compressed = false;
+        positionScale = glm::vec3(1.0f);
+        positionOffset = glm::vec3(0.0f);
+        boundsMin = boundsMax = vertices.empty() ? glm::vec3(0.0f) : vertices[0].Position;
+        for (unsigned int i = 1; i < vertices.size(); i++)
+        {
+            boundsMin = glm::min(boundsMin, vertices[i].Position);
+            boundsMax = glm::max(boundsMax, vertices[i].Position);
+        }
+        sphereCenter = (boundsMin + boundsMax) * 0.5f;
+        sphereRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+        setupLods(lods, meshlets);
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
 
-    // render the mesh
-    void Draw(Shader shader) 
+    // a mesh of CompressedVertex, quantized inside boundsMin..boundsMax (see CompressVertices)
+    Mesh(const vector<CompressedVertex> &vertices, glm::vec3 boundsMin, glm::vec3 boundsMax, vector<unsigned int> indices, vector<Texture> textures,
+        vector<MeshLod> lods = vector<MeshLod>(), vector<Meshlet> meshlets = vector<Meshlet>())
+    {
+        this->indices = indices;
+        this->textures = textures;
+        material = MaterialId(textures);
+        setupSamplers();
+        compressed = true;
+        positionScale = boundsMax - boundsMin;
+        positionOffset = boundsMin;
+        this->boundsMin = boundsMin;
+        this->boundsMax = boundsMax;
+        sphereCenter = (boundsMin + boundsMax) * 0.5f;
+        sphereRadius = glm::length(boundsMax - boundsMin) * 0.5f;
+        setupLods(lods, meshlets);
+
+        setupCompressedMesh(vertices);
+    }
+
+    // picks the coarsest level whose error stays under LOD_PIXEL_ERROR once projected. model : the mesh's model matrix ;
+    // pixelsPerUnit : pixels covered by one world unit at distance 1 (projection[1][1] * viewport height / 2).
+    // Updates state.lod, the level the model drew last frame
+    void SelectLod(const glm::mat4 &model, const glm::vec3 &cameraPosition, float pixelsPerUnit, MeshDrawState &state) const
+    {
+        if (lods.size() < 2)
+            return;
+        // world size of the mesh : its bounding box diagonal, scaled like the model
+        float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        float size = glm::length(boundsMax - boundsMin) * scale;
+        glm::vec3 center = glm::vec3(model * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+        // distance to the nearest point of the bounding sphere, the camera may be inside it
+        float distance = glm::max(glm::length(center - cameraPosition) - size * 0.5f, 0.001f);
+        float projectedSize = size * pixelsPerUnit / distance;
+
+        // errors are relative to the diagonal : Error * projectedSize is in pixels
+        unsigned int &lod = state.lod;
+        while (lod > 0 && lods[lod].Error * projectedSize > LOD_PIXEL_ERROR)
+            lod--;
+        while (lod + 1 < lods.size() && lods[lod + 1].Error * projectedSize < LOD_PIXEL_ERROR * LOD_HYSTERESIS)
+            lod++;
+    }
+
+    // render the mesh as state selected it
+    void Draw(const Shader &shader, MeshDrawState &state) const
+    {
+        bindTextures(shader);
+        shader.setVec3("positionScale", positionScale);
+        shader.setVec3("positionOffset", positionOffset);
+
+        // draw mesh
+        GLState().BindVertexArray(VAO);
+        if (state.culled)
+        {
+            if (!state.drawCounts.empty())
+            {
+                // the ranges are relative to the mesh : moved to its place in the arena
+                state.drawBaseVertices.assign(state.drawCounts.size(), (GLint)range->BaseVertex);
+                for (size_t i = 0; i < state.drawOffsets.size(); i++)
+                    state.drawOffsets[i] = (const char*)state.drawOffsets[i] + range->FirstIndex * sizeof(unsigned int);
+                glMultiDrawElementsBaseVertex(GL_TRIANGLES, &state.drawCounts[0], GL_UNSIGNED_INT, &state.drawOffsets[0],
+                    (GLsizei)state.drawCounts.size(), &state.drawBaseVertices[0]);
+            }
+            state.culled = false;
+        }
+        else
+            glDrawElementsBaseVertex(GL_TRIANGLES, lods[state.lod].IndexCount, GL_UNSIGNED_INT,
+                (void*)((range->FirstIndex + lods[state.lod].FirstIndex) * sizeof(unsigned int)), range->BaseVertex);
+        // left bound : the next Draw of the same arena finds its vertex array and textures in place
+    }
+
+    // samplers texture_diffuseN, texture_specularN, ... on units 0, 1, ...
+    void bindTextures(const Shader &shader) const
+    {
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            GLState().ActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            shader.setInt(UniformName(samplerHashes[i], samplers[i].c_str()), i);
+            // and finally bind the texture
+            GLState().BindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+    }
+
+private:
+    // the sampler names are built here once, so binding the textures builds no string
+    void setupSamplers()
     {
-        // bind appropriate textures
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
+        samplers.clear();
+        samplerHashes.clear();
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -76,64 +409,49 @@ public:
 				number = std::to_string(normalNr++); // transfer unsigned int to stream
              else if(name == "texture_height")
 			    number = std::to_string(heightNr++); // transfer unsigned int to stream
+            samplers.push_back(name + number);
+            samplerHashes.push_back(UniformHash(samplers.back().c_str()));
+        }
+    }
 
-													 // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    void setupLods(const vector<MeshLod> &chain, const vector<Meshlet> &clusters)
+    {
+        lods = chain;
+        meshlets = clusters;
+        if (lods.empty())
+        {
+            MeshLod full;
+            full.FirstIndex = 0;
+            full.IndexCount = (unsigned int)indices.size();
+            full.Error = 0.0f;
+            lods.push_back(full);
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+    }
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // copies the mesh into the arena of its format
+    void setupMesh()
+    {
+        range = VertexArena().Allocate(vertices.empty() ? NULL : &vertices[0], vertices.size(), indices.empty() ? NULL : &indices[0], indices.size());
+        VAO = VertexArena().VertexArray();
+        dropIfLeftOut();
     }
 
-private:
-    /*  Render data  */
-    unsigned int VBO, EBO;
+    void setupCompressedMesh(const vector<CompressedVertex> &vertices)
+    {
+        range = CompressedVertexArena().Allocate(vertices.empty() ? NULL : &vertices[0], vertices.size(), indices.empty() ? NULL : &indices[0], indices.size());
+        VAO = CompressedVertexArena().VertexArray();
+        dropIfLeftOut();
+    }
 
-    /*  Functions    */
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    // the arena had no room for the mesh (an empty range) : it draws nothing rather than someone else's indices
+    void dropIfLeftOut()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+        if (range->IndexCount == indices.size())
+            return;
+        lods.assign(1, MeshLod());
+        lods[0].FirstIndex = lods[0].IndexCount = 0;
+        lods[0].Error = 0.0f;
+        meshlets.clear();
     }
 };
 #endif
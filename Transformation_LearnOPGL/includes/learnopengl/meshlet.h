@@ -0,0 +1,228 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/frustum.h>
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+using namespace std;
+
+// Cluster culling : Model::processMesh splits the full level of a mesh into meshlets, small clusters of
+// triangles that are stored one after the other in the element buffer. Every frame, CullMeshlets drops the
+// clusters outside the frustum or facing away from the camera and merges what is left into index ranges,
+// drawn by Mesh::Draw with a single glMultiDrawElements.
+
+// cluster limits : 64 vertices and 124 triangles, so a cluster fits the usual mesh shader output sizes
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+// bounding sphere and normal cone of the triangles at indices[first .. first + count * 3]
+inline void ComputeMeshletBounds(Meshlet &meshlet, const vector<unsigned int> &indices, const vector<Vertex> &vertices)
+{
+    const unsigned int *triangles = &indices[meshlet.FirstIndex];
+    unsigned int count = meshlet.TriangleCount;
+
+    glm::vec3 boundsMin = vertices[triangles[0]].Position, boundsMax = boundsMin;
+    for (unsigned int i = 1; i < count * 3; i++)
+    {
+        boundsMin = glm::min(boundsMin, vertices[triangles[i]].Position);
+        boundsMax = glm::max(boundsMax, vertices[triangles[i]].Position);
+    }
+    meshlet.Center = (boundsMin + boundsMax) * 0.5f;
+    meshlet.Radius = 0.0f;
+    for (unsigned int i = 0; i < count * 3; i++)
+        meshlet.Radius = glm::max(meshlet.Radius, glm::length(vertices[triangles[i]].Position - meshlet.Center));
+
+    // the cone axis is the mean normal, its opening the widest normal around it
+    vector<glm::vec3> normals(count);
+    glm::vec3 sum(0.0f);
+    for (unsigned int t = 0; t < count; t++)
+    {
+        const glm::vec3 &a = vertices[triangles[t * 3]].Position;
+        glm::vec3 normal = glm::cross(vertices[triangles[t * 3 + 1]].Position - a, vertices[triangles[t * 3 + 2]].Position - a);
+        float length = glm::length(normal);
+        normals[t] = length > 0 ? normal / length : glm::vec3(0.0f);
+        sum += normals[t];
+    }
+    meshlet.ConeApex = meshlet.Center;
+    meshlet.ConeAxis = glm::vec3(0.0f);
+    meshlet.ConeCutoff = 1.0f;
+    float sumLength = glm::length(sum);
+    if (sumLength <= 0)
+        return;
+    glm::vec3 axis = sum / sumLength;
+    float minDot = 1.0f;
+    for (unsigned int t = 0; t < count; t++)
+        if (normals[t] != glm::vec3(0.0f))
+            minDot = glm::min(minDot, glm::dot(normals[t], axis));
+    // a cone of 90 degrees or more : some triangle faces every camera position
+    if (minDot <= 0.1f)
+        return;
+
+    // the apex is moved back along the axis until every triangle plane is in front of it,
+    // so the test holds for a camera close to the cluster (Zeux, "Optimizing mesh shaders")
+    float maxT = 0.0f;
+    for (unsigned int t = 0; t < count; t++)
+    {
+        float facing = glm::dot(axis, normals[t]);
+        if (facing <= 0)
+            continue;
+        float t0 = glm::dot(meshlet.Center - vertices[triangles[t * 3]].Position, normals[t]) / facing;
+        maxT = glm::max(maxT, t0);
+    }
+    meshlet.ConeApex = meshlet.Center - axis * maxT;
+    meshlet.ConeAxis = axis;
+    meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+// reorders the triangles of indices[0 .. indexCount] (a cache-ordered triangle list) into meshlets : each cluster
+// grows from a seed triangle by adding the neighbour that needs the fewest new vertices, then the one closest to
+// the cluster's normal, until a limit is reached. The triangle set is unchanged.
+inline void BuildMeshlets(vector<unsigned int> &indices, size_t indexCount, const vector<Vertex> &vertices, vector<Meshlet> &meshlets,
+    unsigned int maxVertices = MESHLET_MAX_VERTICES, unsigned int maxTriangles = MESHLET_MAX_TRIANGLES)
+{
+    meshlets.clear();
+    size_t triangleCount = indexCount / 3;
+    size_t vertexCount = vertices.size();
+    if (triangleCount == 0)
+        return;
+
+    // triangles around each vertex
+    vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        offsets[indices[i] + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] += offsets[v];
+    vector<unsigned int> adjacency(triangleCount * 3);
+    vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+    vector<glm::vec3> normals(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        const glm::vec3 &a = vertices[indices[t * 3]].Position;
+        glm::vec3 normal = glm::cross(vertices[indices[t * 3 + 1]].Position - a, vertices[indices[t * 3 + 2]].Position - a);
+        float length = glm::length(normal);
+        normals[t] = length > 0 ? normal / length : glm::vec3(0.0f);
+    }
+
+    vector<bool> emitted(triangleCount, false);
+    vector<unsigned int> inMeshlet(vertexCount, 0); // meshlet number + 1 of the meshlet currently using the vertex
+    vector<unsigned int> result;
+    result.reserve(triangleCount * 3);
+    vector<unsigned int> clusterVertices;
+    size_t seed = 0;
+    size_t done = 0;
+    while (done < triangleCount)
+    {
+        Meshlet meshlet;
+        meshlet.FirstIndex = (unsigned int)result.size();
+        meshlet.TriangleCount = 0;
+        unsigned int tag = (unsigned int)meshlets.size() + 1;
+        clusterVertices.clear();
+        glm::vec3 normalSum(0.0f);
+
+        // the next triangle in cache order starts the cluster
+        while (emitted[seed])
+            seed++;
+        size_t next = seed;
+        for (;;)
+        {
+            emitted[next] = true;
+            done++;
+            meshlet.TriangleCount++;
+            normalSum += normals[next];
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int v = indices[next * 3 + k];
+                result.push_back(v);
+                if (inMeshlet[v] != tag)
+                {
+                    inMeshlet[v] = tag;
+                    clusterVertices.push_back(v);
+                }
+            }
+            if (meshlet.TriangleCount >= maxTriangles)
+                break;
+
+            // best neighbour : fewest new vertices, then the normal closest to the cluster's
+            size_t best = triangleCount;
+            int bestNew = 4;
+            float bestDot = -2.0f;
+            for (size_t i = 0; i < clusterVertices.size(); i++)
+            {
+                unsigned int v = clusterVertices[i];
+                for (unsigned int j = offsets[v]; j < offsets[v + 1]; j++)
+                {
+                    unsigned int t = adjacency[j];
+                    if (emitted[t])
+                        continue;
+                    int newVertices = (inMeshlet[indices[t * 3]] != tag) + (inMeshlet[indices[t * 3 + 1]] != tag) + (inMeshlet[indices[t * 3 + 2]] != tag);
+                    float facing = glm::dot(normals[t], normalSum);
+                    if (newVertices < bestNew || (newVertices == bestNew && facing > bestDot))
+                    {
+                        best = t;
+                        bestNew = newVertices;
+                        bestDot = facing;
+                    }
+                }
+            }
+            if (best == triangleCount || clusterVertices.size() + bestNew > maxVertices)
+                break;
+            next = best;
+        }
+        meshlet.VertexCount = (unsigned int)clusterVertices.size();
+        meshlets.push_back(meshlet);
+    }
+
+    copy(result.begin(), result.end(), indices.begin());
+    for (size_t i = 0; i < meshlets.size(); i++)
+        ComputeMeshletBounds(meshlets[i], indices, vertices);
+}
+
+// true when the meshlet may have a visible triangle : camera and planes in model space
+inline bool MeshletVisible(const Meshlet &meshlet, const glm::vec4 planes[6], const glm::vec3 &camera)
+{
+    for (int i = 0; i < 6; i++)
+        if (glm::dot(glm::vec3(planes[i]), meshlet.Center) + planes[i].w < -meshlet.Radius)
+            return false;
+    glm::vec3 toApex = meshlet.ConeApex - camera;
+    float distance = glm::length(toApex);
+    return distance <= 0 || glm::dot(toApex, meshlet.ConeAxis) < meshlet.ConeCutoff * distance;
+}
+
+// culls meshlets against the frustum and their normal cones, and appends the survivors as element buffer ranges
+// (GLuint indices), neighbours merged into one range. Returns the triangles kept.
+inline unsigned int CullMeshlets(const vector<Meshlet> &meshlets, const glm::mat4 &model, const glm::mat4 &viewProjection,
+    const glm::vec3 &cameraPosition, vector<GLsizei> &counts, vector<const void*> &offsets)
+{
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(viewProjection * model, planes);
+    // facing is kept by affine maps : the test is done in model space
+    glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+
+    unsigned int kept = 0;
+    size_t rangeEnd = (size_t)-1; // index just past the last range
+    for (size_t i = 0; i < meshlets.size(); i++)
+    {
+        const Meshlet &meshlet = meshlets[i];
+        if (!MeshletVisible(meshlet, planes, camera))
+            continue;
+        kept += meshlet.TriangleCount;
+        if (meshlet.FirstIndex == rangeEnd)
+            counts.back() += meshlet.TriangleCount * 3;
+        else
+        {
+            counts.push_back(meshlet.TriangleCount * 3);
+            offsets.push_back((const void*)(meshlet.FirstIndex * sizeof(unsigned int)));
+        }
+        rangeEnd = meshlet.FirstIndex + meshlet.TriangleCount * 3;
+    }
+    return kept;
+}
+
+#endif
@@ -13,6 +13,11 @@
 #include <glm/gtx/vector_angle.hpp>
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/vertex_cache.h>
+#include <learnopengl/simplify.h>
+#include <learnopengl/meshlet.h>
+#include <learnopengl/frustum.h>
+#include <learnopengl/occlusion.h>
 
 #include <string>
 #include <fstream>
@@ -44,12 +49,64 @@ const float ROTATION_SPEED = glm::radians(60.0f);
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 
+// A texture decoded in memory, ready for glTexImage2D
+struct TextureData {
+    string type;
+    string path;
+    int width, height, nrComponents;
+    unsigned char *pixels; // stbi_load result, NULL if the file could not be decoded
+};
+
+// A mesh before it is uploaded : its textures are indices into ModelData::textures.
+// A compressed mesh keeps its vertices in compressedVertices only (see CompressVertices).
+// indices holds every level of detail, lods tells where each one starts (see BuildLodChain) ;
+// the full level is stored cluster by cluster (see BuildMeshlets).
+struct MeshData {
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    vector<MeshLod> lods;
+    vector<Meshlet> meshlets;
+    vector<unsigned int> textures;
+    vector<CompressedVertex> compressedVertices;
+    glm::vec3 boundsMin, boundsMax;
+    glm::vec3 sphereCenter;
+    float sphereRadius;
+    QuantizationError error;
+};
+
+// Everything Assimp and stb_image give us for one file. Building it needs no GL context,
+// so it can be done on a worker thread (see learnopengl/async_loader.h).
+struct ModelData {
+    string directory;
+    vector<MeshData> meshes;
+    vector<TextureData> textures;
+    bool compressed;
+};
+
+// decodes directory/path into data (no GL calls)
+bool DecodeTexture(const char *path, const string &directory, TextureData &data);
+// uploads a decoded texture, frees its pixels and returns the GL texture
+unsigned int UploadTexture(TextureData &data, bool gamma = false);
+void FreeModelData(ModelData &data);
+
 class Model 
 {
 public:
     /*  Model Data */
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
-    vector<Mesh> meshes;
+    // textures and meshes, shared by every instance of the model (see Model(const Model &, ...)) and left as they
+    // are once loaded ; what changes per model is in meshStates
+    shared_ptr<const vector<Texture> > textures_loaded = make_shared<const vector<Texture> >();	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    shared_ptr<const vector<Mesh> > meshes = make_shared<const vector<Mesh> >();
+    // the level of detail and culled ranges of each mesh, for this model
+    vector<MeshDrawState> meshStates;
+    // bounding sphere of all the meshes, in model space ; see WorldBounds
+    glm::vec3 SphereCenter = glm::vec3(0.0f);
+    float SphereRadius = 0.0f;
+    // drawn into the OcclusionBuffer each frame (see AddOccluder) ; meant for the few big models that hide others
+    bool Occluder = false;
+    // the same number for every model loaded from the same file with the same vertex format, to find one to
+    // instance. 0 for a model not loaded from a file
+    unsigned int Source = 0;
     string directory;
     bool gammaCorrection;
 
@@ -443,9 +500,204 @@ public:
 		glm::mat4 scale_m = glm::scale(glm::mat4(1.0f), mscale);
 		Matrix = Matrix * scale_m;
     }
-	Model(string const &path,glm::vec3 pos = glm::vec3(0, 0, 0), glm::vec3 mscale = glm::vec3(1, 1, 1))
+	// compress : 16-byte CompressedVertex instead of 56-byte Vertex, a quantization report per mesh is printed
+	Model(string const &path,glm::vec3 pos = glm::vec3(0, 0, 0), glm::vec3 mscale = glm::vec3(1, 1, 1), bool compress = false)
+	{
+		loadModel(path, compress);
+		setup(pos, mscale);
+	}
+	// a model without meshes yet : fill it with UploadStep (used by AsyncModelLoader)
+	Model(glm::vec3 pos, glm::vec3 mscale)
+	{
+		setup(pos, mscale);
+	}
+	// another instance of source's meshes and textures (they are shared, nothing is loaded or copied), placed at pos
+	Model(const Model &source, glm::vec3 pos, glm::vec3 mscale)
+		: textures_loaded(source.textures_loaded), meshes(source.meshes), meshStates(source.meshes->size())
+	{
+		directory = source.directory;
+		gammaCorrection = source.gammaCorrection;
+		SphereCenter = source.SphereCenter;
+		SphereRadius = source.SphereRadius;
+		Source = source.Source;
+		setup(pos, mscale);
+	}
+
+    // picks each mesh's level of detail from its size on screen ; call before Draw.
+    // pixelsPerUnit : projection[1][1] * viewport height / 2
+    void SelectLod(const glm::vec3 &cameraPosition, float pixelsPerUnit)
+    {
+        for (unsigned int i = 0; i < meshes->size(); i++)
+            (*meshes)[i].SelectLod(Matrix, cameraPosition, pixelsPerUnit, meshStates[i]);
+    }
+
+    // drops the clusters of each mesh drawn at full detail that are outside the frustum or face away from the
+    // camera ; call after SelectLod and before Draw. Returns the triangles left in those meshes.
+    unsigned int Cull(const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition)
+    {
+        unsigned int kept = 0;
+        for (unsigned int i = 0; i < meshes->size(); i++)
+        {
+            const Mesh &mesh = (*meshes)[i];
+            MeshDrawState &state = meshStates[i];
+            if (state.lod != 0 || mesh.meshlets.empty())
+                continue;
+            state.drawCounts.clear();
+            state.drawOffsets.clear();
+            kept += CullMeshlets(mesh.meshlets, Matrix, viewProjection, cameraPosition, state.drawCounts, state.drawOffsets);
+            state.culled = true;
+        }
+        return kept;
+    }
+
+    // the bounding sphere moved and scaled by Matrix, for frustum culling (see SphereBatch)
+    void WorldBounds(glm::vec3 &center, float &radius) const
+    {
+        center = glm::vec3(Matrix * glm::vec4(SphereCenter, 1.0f));
+        radius = SphereRadius * MaxScale(Matrix);
+    }
+
+    // box around all the meshes, in model space
+    void Bounds(glm::vec3 &boundsMin, glm::vec3 &boundsMax) const
+    {
+        boundsMin = boundsMax = glm::vec3(0.0f);
+        for (unsigned int i = 0; i < meshes->size(); i++)
+        {
+            const Mesh &mesh = (*meshes)[i];
+            boundsMin = i == 0 ? mesh.boundsMin : glm::min(boundsMin, mesh.boundsMin);
+            boundsMax = i == 0 ? mesh.boundsMax : glm::max(boundsMax, mesh.boundsMax);
+        }
+    }
+
+    // queues the full level of every mesh as occluder triangles. Compressed meshes keep no CPU copy of their
+    // vertices and are skipped
+    void AddOccluder(OcclusionBuffer &buffer, const glm::mat4 &viewProjection) const
+    {
+        for (unsigned int i = 0; i < meshes->size(); i++)
+        {
+            const Mesh &mesh = (*meshes)[i];
+            if (mesh.vertices.empty())
+                continue;
+            buffer.AddOccluder(&mesh.vertices[0].Position, sizeof(Vertex), mesh.vertices.size(), &mesh.indices[mesh.lods[0].FirstIndex],
+                mesh.lods[0].IndexCount, viewProjection * Matrix);
+        }
+    }
+
+    // number for Source, handed out in load order from 1 ; call on the render thread
+    static unsigned int SourceId(const string &path, bool compress)
+    {
+        static map<string, unsigned int> ids;
+        unsigned int &id = ids[(compress ? "compressed:" : "") + path];
+        if (id == 0)
+            id = (unsigned int)ids.size();
+        return id;
+    }
+
+    // draws the model, and thus all its meshes
+    void Draw(const Shader &shader)
+    {
+        for(unsigned int i = 0; i < meshes->size(); i++)
+            (*meshes)[i].Draw(shader, meshStates[i]);
+    }
+
+    // reads a model with supported ASSIMP extensions and decodes its textures. Does no GL call,
+    // so it may run on any thread ; release the pixels with FreeModelData if the data is never uploaded.
+    static bool LoadModelData(string const &path, ModelData &data, bool compress = false)
+    {
+        // read file via ASSIMP
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        // check for errors
+        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        {
+            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+            return false;
+        }
+        // retrieve the directory path of the filepath
+        data.directory = path.substr(0, path.find_last_of('/'));
+        data.compressed = compress;
+
+        // process ASSIMP's root node recursively
+        processNode(scene->mRootNode, scene, data);
+
+        // quantize here rather than at upload, so a worker thread pays for it
+        if (compress)
+        {
+            for (unsigned int i = 0; i < data.meshes.size(); i++)
+            {
+                MeshData &mesh = data.meshes[i];
+                CompressVertices(mesh.vertices, mesh.compressedVertices, mesh.boundsMin, mesh.boundsMax, mesh.error);
+                vector<Vertex>().swap(mesh.vertices);
+            }
+        }
+        return true;
+    }
+
+    // uploads the next piece of data (all textures first, then one mesh per call) ; returns true when
+    // nothing is left. step starts at 0 and is advanced here. Must be called on the GL thread.
+    bool UploadStep(ModelData &data, size_t &step)
+    {
+        if (step == 0)
+        {
+            loadingTextures = make_shared<vector<Texture> >();
+            loadingMeshes = make_shared<vector<Mesh> >();
+            textures_loaded = loadingTextures;
+            meshes = loadingMeshes;
+            meshStates.clear();
+        }
+        if (step < data.textures.size())
+        {
+            TextureData &source = data.textures[step];
+            Texture texture;
+            texture.id = UploadTexture(source);
+            texture.type = source.type;
+            texture.path = source.path;
+            loadingTextures->push_back(texture);
+        }
+        else if (step < data.textures.size() + data.meshes.size())
+        {
+            MeshData &source = data.meshes[step - data.textures.size()];
+            vector<Texture> textures;
+            for (unsigned int i = 0; i < source.textures.size(); i++)
+                textures.push_back((*loadingTextures)[source.textures[i]]);
+            if (data.compressed)
+            {
+                loadingMeshes->push_back(Mesh(source.compressedVertices, source.boundsMin, source.boundsMax, source.indices, textures, source.lods, source.meshlets));
+                const QuantizationError &e = source.error;
+                cout << "MODEL::COMPRESSED:: " << directory << " mesh " << loadingMeshes->size() - 1 << " : " << source.compressedVertices.size()
+                     << " vertices, " << sizeof(Vertex) << " -> " << sizeof(CompressedVertex) << " bytes each ; max error position " << e.Position
+                     << ", normal " << e.Normal << " deg, tangent " << e.Tangent << " deg, bitangent " << e.Bitangent << " deg, uv " << e.TexCoords << endl;
+            }
+            else
+                loadingMeshes->push_back(Mesh(source.vertices, source.indices, textures, source.lods, source.meshlets));
+            meshStates.push_back(MeshDrawState());
+            Mesh &mesh = loadingMeshes->back();
+            mesh.sphereCenter = source.sphereCenter;
+            mesh.sphereRadius = source.sphereRadius;
+            if (loadingMeshes->size() == 1)
+            {
+                SphereCenter = mesh.sphereCenter;
+                SphereRadius = mesh.sphereRadius;
+            }
+            else
+                MergeSpheres(SphereCenter, SphereRadius, mesh.sphereCenter, mesh.sphereRadius);
+        }
+        step++;
+        if (step < data.textures.size() + data.meshes.size())
+            return false;
+        // from now on the meshes and textures are only read, by this model and its instances
+        loadingTextures.reset();
+        loadingMeshes.reset();
+        return true;
+    }
+
+private:
+    // textures_loaded and meshes while UploadStep fills them
+    shared_ptr<vector<Texture> > loadingTextures;
+    shared_ptr<vector<Mesh> > loadingMeshes;
+
+	void setup(glm::vec3 pos, glm::vec3 mscale)
 	{
-		loadModel(path);
 		Position = pos;
 		Front = glm::vec3(0., 0., 1.);
 		Up = glm::vec3(0., 1., 0.);
@@ -461,36 +713,22 @@ public:
 		mypath.push_back(glm::vec3(0, 0, 3));
 	}
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader shader)
-    {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
-    }
-    
-private:
     /*  Functions   */
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    void loadModel(string const &path, bool compress = false)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+        Source = SourceId(path, compress);
+        ModelData data;
+        if (!LoadModelData(path, data, compress))
             return;
-        }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        directory = data.directory;
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        size_t step = 0;
+        while (!UploadStep(data, step)) {}
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    static void processNode(aiNode *node, const aiScene *scene, ModelData &data)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -498,22 +736,23 @@ private:
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            data.meshes.push_back(processMesh(mesh, scene, data));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, data);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene, ModelData &data)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData result;
+        vector<Vertex> &vertices = result.vertices;
+        vector<unsigned int> &indices = result.indices;
+        vector<unsigned int> &textures = result.textures;
 
         // Walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -562,6 +801,14 @@ private:
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+        // Assimp keeps the file's face order : reorder for the post-transform cache, then the vertices for fetch
+        OptimizeVertexCache(indices, vertices.size());
+        // clusters for CullMeshlets, grown along the cache order ; the vertex fetch order follows theirs
+        BuildMeshlets(indices, indices.size(), vertices, result.meshlets);
+        OptimizeVertexFetch(indices, vertices);
+        // coarser copies of the triangles, appended to indices ; the vertices are shared by every level
+        BuildLodChain(indices, vertices, result.lods);
+        BoundingSphere(vertices, result.sphereCenter, result.sphereRadius);
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -572,50 +819,50 @@ private:
         // normal: texture_normalN
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        vector<unsigned int> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data);
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        vector<unsigned int> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", data);
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
+        std::vector<unsigned int> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", data);
         textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
+        std::vector<unsigned int> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", data);
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
         
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // return the extracted mesh data ; the Mesh object (and its buffers) is created by UploadStep
+        return result;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // checks all material textures of a given type and decodes the textures if they're not decoded yet.
+    // the textures are returned as indices into data.textures.
+    static vector<unsigned int> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName, ModelData &data)
     {
-        vector<Texture> textures;
+        vector<unsigned int> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
             // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
             bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            for(unsigned int j = 0; j < data.textures.size(); j++)
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
+                if(std::strcmp(data.textures[j].path.data(), str.C_Str()) == 0)
                 {
-                    textures.push_back(textures_loaded[j]);
+                    textures.push_back(j);
                     skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
                     break;
                 }
             }
             if(!skip)
             {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                TextureData texture;
+                DecodeTexture(str.C_Str(), data.directory, texture);
                 texture.type = typeName;
                 texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+                textures.push_back((unsigned int)data.textures.size());
+                data.textures.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
             }
         }
         return textures;
@@ -624,27 +871,41 @@ private:
 
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+{
+    TextureData data;
+    DecodeTexture(path, directory, data);
+    return UploadTexture(data, gamma);
+}
+
+bool DecodeTexture(const char *path, const string &directory, TextureData &data)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
+    data.path = path;
+    data.pixels = stbi_load(filename.c_str(), &data.width, &data.height, &data.nrComponents, 0);
+    if (!data.pixels)
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+    return data.pixels != NULL;
+}
+
+unsigned int UploadTexture(TextureData &data, bool gamma)
+{
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
+    if (data.pixels)
     {
         GLenum format;
-        if (nrComponents == 1)
+        if (data.nrComponents == 1)
             format = GL_RED;
-        else if (nrComponents == 3)
+        else if (data.nrComponents == 3)
             format = GL_RGB;
-        else if (nrComponents == 4)
+        else if (data.nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        GLState().BindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, data.width, data.height, 0, format, GL_UNSIGNED_BYTE, data.pixels);
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -652,15 +913,20 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        stbi_image_free(data.pixels);
+        data.pixels = NULL;
     }
 
     return textureID;
 }
 
+void FreeModelData(ModelData &data)
+{
+    for (unsigned int i = 0; i < data.textures.size(); i++)
+    {
+        stbi_image_free(data.textures[i].pixels);
+        data.textures[i].pixels = NULL;
+    }
+}
+
 #endif
@@ -0,0 +1,59 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free queue with any number of pushing threads and one popping thread, after Vyukov's MPSC list. A push is one
+// atomic exchange and never waits ; a Pop that races a push may not see it yet, the next Pop will.
+// Elements still queued when the queue is destroyed are dropped : a queue of owning pointers drains itself first.
+template <typename T>
+class MPSCQueue
+{
+public:
+    MPSCQueue() : tail(new Node()) { head.store(tail); }
+
+    ~MPSCQueue()
+    {
+        T value;
+        while (Pop(value)) {}
+        delete tail;
+    }
+
+    // any thread
+    void Push(const T &value)
+    {
+        Node *node = new Node();
+        node->value = value;
+        Node *previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // the consumer thread only
+    bool Pop(T &value)
+    {
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (next == NULL)
+            return false;
+        value = next->value;
+        // the popped node stays as the new stub, the old one goes
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next;
+        T value;
+        Node() : next(NULL), value() {}
+    };
+
+    std::atomic<Node*> head; // the last node pushed
+    Node *tail;              // stub : the next element to pop is in its successor
+
+    MPSCQueue(const MPSCQueue &);
+    MPSCQueue &operator=(const MPSCQueue &);
+};
+
+#endif
@@ -0,0 +1,326 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OCCLUSION_SSE
+#endif
+
+// Software occlusion culling : the big occluders (the nanosuit, the planet) are rasterized on the CPU into a
+// small depth buffer, then every other model's screen rectangle is tested against a max-depth pyramid of it.
+// No GL call, so it runs (and is benchmarked, see bench/occlusion_bench.cpp) without a GPU.
+// Rows are split in bands, one per thread ; each band rasterizes every triangle that reaches it, 4 pixels at a time with SSE.
+
+const int OCCLUSION_WIDTH = 256;
+const int OCCLUSION_HEIGHT = 128;
+
+class OcclusionBuffer
+{
+public:
+    // 0 threads = one band per hardware thread, the calling thread doing one of them
+    explicit OcclusionBuffer(int width = OCCLUSION_WIDTH, int height = OCCLUSION_HEIGHT, unsigned int threadCount = 0)
+        : width((width + 3) & ~3), height(height), generation(0), remaining(0), stopping(false)
+    {
+        if (threadCount == 0)
+            threadCount = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+        // at least 8 rows a band
+        bandCount = std::max(1u, std::min(threadCount, (unsigned int)height / 8));
+        levels.push_back(Level(this->width, height));
+        while (levels.back().Width > 1 || levels.back().Height > 1)
+            levels.push_back(Level((levels.back().Width + 1) / 2, (levels.back().Height + 1) / 2));
+        Clear();
+        for (unsigned int i = 1; i < bandCount; i++)
+            workers.push_back(std::thread(&OcclusionBuffer::workerLoop, this, i));
+    }
+
+    ~OcclusionBuffer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    unsigned int Bands() const { return bandCount; }
+    // triangles queued since Clear, after near plane clipping
+    size_t Triangles() const { return triangles.size(); }
+    // depth in [0, 1] per pixel, row 0 at the bottom ; 1 where no occluder was drawn
+    const vector<float> &Depth() const { return levels[0].Depth; }
+
+    // starts a new frame : empty buffer, no occluder
+    void Clear()
+    {
+        triangles.clear();
+        fill(levels[0].Depth.begin(), levels[0].Depth.end(), 1.0f);
+    }
+
+    // queues the triangles of an occluder. positions : the first of vertexCount positions, stride bytes apart
+    // (sizeof(Vertex) to read Vertex::Position in place) ; modelViewProjection takes them to clip space
+    void AddOccluder(const glm::vec3 *positions, size_t stride, size_t vertexCount, const unsigned int *indices, size_t indexCount, const glm::mat4 &modelViewProjection)
+    {
+        clip.resize(vertexCount);
+        const char *position = (const char*)positions;
+        for (size_t i = 0; i < vertexCount; i++, position += stride)
+            clip[i] = modelViewProjection * glm::vec4(*(const glm::vec3*)position, 1.0f);
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+            addTriangle(clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]]);
+    }
+
+    // draws the queued occluders, then builds the max-depth pyramid IsVisible reads
+    void Rasterize()
+    {
+        if (bandCount > 1)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                remaining = bandCount - 1;
+                generation++;
+            }
+            wakeUp.notify_all();
+        }
+        rasterizeBand(0);
+        if (bandCount > 1)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            bandsDone.wait(lock, [this] { return remaining == 0; });
+        }
+        buildPyramid();
+    }
+
+    // false when the box (model space, taken to clip space by modelViewProjection) is behind the occluders
+    // everywhere it covers, or entirely off screen. Boxes crossing the near plane are always visible.
+    bool IsVisible(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, const glm::mat4 &modelViewProjection) const
+    {
+        glm::vec2 screenMin(1e30f), screenMax(-1e30f);
+        float nearest = 1.0f;
+        for (int c = 0; c < 8; c++)
+        {
+            glm::vec3 corner((c & 1) ? boundsMax.x : boundsMin.x, (c & 2) ? boundsMax.y : boundsMin.y, (c & 4) ? boundsMax.z : boundsMin.z);
+            glm::vec4 p = modelViewProjection * glm::vec4(corner, 1.0f);
+            if (p.w <= 1e-6f || p.z < -p.w)
+                return true;
+            glm::vec2 screen = toScreen(p);
+            screenMin = glm::min(screenMin, screen);
+            screenMax = glm::max(screenMax, screen);
+            nearest = std::min(nearest, p.z / p.w * 0.5f + 0.5f);
+        }
+        if (screenMax.x < 0 || screenMax.y < 0 || screenMin.x > width || screenMin.y > height)
+            return false;
+        // one pixel of margin : occluders are sampled at pixel centers, their edges may be half a pixel off
+        int x0 = std::max(0, (int)floorf(screenMin.x) - 1), x1 = std::min(width - 1, (int)floorf(screenMax.x) + 1);
+        int y0 = std::max(0, (int)floorf(screenMin.y) - 1), y1 = std::min(height - 1, (int)floorf(screenMax.y) + 1);
+
+        // the finest level where the rectangle covers at most 4 x 4 texels
+        size_t level = 0;
+        while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) >= 4 || (y1 >> level) - (y0 >> level) >= 4))
+            level++;
+        const Level &l = levels[level];
+        for (int y = y0 >> level; y <= (y1 >> level); y++)
+            for (int x = x0 >> level; x <= (x1 >> level); x++)
+                if (l.Depth[y * l.Width + x] >= nearest)
+                    return true;
+        return false;
+    }
+
+private:
+    struct Level {
+        int Width, Height;
+        vector<float> Depth; // level 0 : depth ; above : the farthest depth of the 2 x 2 texels below
+        Level(int width, int height) : Width(width), Height(height), Depth((size_t)width * height, 1.0f) {}
+    };
+
+    // screen space triangle, counter-clockwise
+    struct ScreenTriangle {
+        glm::vec2 P[3];
+        float Z[3];
+        int MinY, MaxY;
+    };
+
+    int width, height;
+    unsigned int bandCount;
+    vector<Level> levels;
+    vector<ScreenTriangle> triangles;
+    vector<glm::vec4> clip;
+
+    vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeUp, bandsDone;
+    unsigned int generation, remaining;
+    bool stopping;
+
+    glm::vec2 toScreen(const glm::vec4 &p) const
+    {
+        return glm::vec2((p.x / p.w * 0.5f + 0.5f) * width, (p.y / p.w * 0.5f + 0.5f) * height);
+    }
+
+    // clips against the near plane (z >= -w), then queues what is left as screen triangles
+    void addTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c)
+    {
+        const glm::vec4 *in[3] = {&a, &b, &c};
+        // entirely outside one side plane
+        for (int axis = 0; axis < 2; axis++)
+        {
+            if ((*in[0])[axis] > in[0]->w && (*in[1])[axis] > in[1]->w && (*in[2])[axis] > in[2]->w)
+                return;
+            if ((*in[0])[axis] < -in[0]->w && (*in[1])[axis] < -in[1]->w && (*in[2])[axis] < -in[2]->w)
+                return;
+        }
+        glm::vec4 polygon[4];
+        int count = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec4 &p = *in[i], &q = *in[(i + 1) % 3];
+            float dp = p.z + p.w, dq = q.z + q.w;
+            if (dp >= 0)
+                polygon[count++] = p;
+            if ((dp >= 0) != (dq >= 0))
+                polygon[count++] = p + (q - p) * (dp / (dp - dq));
+        }
+        for (int i = 1; i + 1 < count; i++)
+            addScreenTriangle(polygon[0], polygon[i], polygon[i + 1]);
+    }
+
+    void addScreenTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c)
+    {
+        if (a.w <= 1e-6f || b.w <= 1e-6f || c.w <= 1e-6f)
+            return;
+        ScreenTriangle t;
+        t.P[0] = toScreen(a);
+        t.P[1] = toScreen(b);
+        t.P[2] = toScreen(c);
+        t.Z[0] = a.z / a.w * 0.5f + 0.5f;
+        t.Z[1] = b.z / b.w * 0.5f + 0.5f;
+        t.Z[2] = c.z / c.w * 0.5f + 0.5f;
+        float area = (t.P[1].x - t.P[0].x) * (t.P[2].y - t.P[0].y) - (t.P[2].x - t.P[0].x) * (t.P[1].y - t.P[0].y);
+        if (fabsf(area) < 1e-8f)
+            return;
+        // occluders are drawn from both sides
+        if (area < 0)
+        {
+            std::swap(t.P[1], t.P[2]);
+            std::swap(t.Z[1], t.Z[2]);
+        }
+        float minY = std::min(t.P[0].y, std::min(t.P[1].y, t.P[2].y)), maxY = std::max(t.P[0].y, std::max(t.P[1].y, t.P[2].y));
+        t.MinY = std::max(0, (int)floorf(minY));
+        t.MaxY = std::min(height - 1, (int)floorf(maxY));
+        if (t.MinY <= t.MaxY && maxY >= 0.5f && minY <= height - 0.5f)
+            triangles.push_back(t);
+    }
+
+    void rasterizeBand(unsigned int band)
+    {
+        int rowBegin = height * band / bandCount, rowEnd = height * (band + 1) / bandCount;
+        for (size_t i = 0; i < triangles.size(); i++)
+            if (triangles[i].MaxY >= rowBegin && triangles[i].MinY < rowEnd)
+                rasterizeTriangle(triangles[i], rowBegin, rowEnd);
+    }
+
+    // pixel (x, y) is covered when its center is inside all three edges ; depth keeps the nearest occluder
+    void rasterizeTriangle(const ScreenTriangle &t, int rowBegin, int rowEnd)
+    {
+        // edge i goes from P[i] to P[i + 1] : E(x, y) = A x + B y + C, >= 0 inside
+        float a[3], b[3], c[3];
+        for (int i = 0; i < 3; i++)
+        {
+            const glm::vec2 &p = t.P[i], &q = t.P[(i + 1) % 3];
+            a[i] = p.y - q.y;
+            b[i] = q.x - p.x;
+            c[i] = -(a[i] * p.x + b[i] * p.y);
+        }
+        // depth is affine in screen space
+        glm::vec2 e1 = t.P[1] - t.P[0], e2 = t.P[2] - t.P[0];
+        float area = e1.x * e2.y - e2.x * e1.y;
+        float dzdx = ((t.Z[1] - t.Z[0]) * e2.y - (t.Z[2] - t.Z[0]) * e1.y) / area;
+        float dzdy = ((t.Z[2] - t.Z[0]) * e1.x - (t.Z[1] - t.Z[0]) * e2.x) / area;
+        float z0 = t.Z[0] - dzdx * t.P[0].x - dzdy * t.P[0].y;
+
+        float minX = std::min(t.P[0].x, std::min(t.P[1].x, t.P[2].x)), maxX = std::max(t.P[0].x, std::max(t.P[1].x, t.P[2].x));
+        int x0 = std::max(0, (int)floorf(minX)) & ~3, x1 = std::min(width - 1, (int)floorf(maxX));
+        int y0 = std::max(rowBegin, t.MinY), y1 = std::min(rowEnd - 1, t.MaxY);
+        float *depth = &levels[0].Depth[0];
+        for (int y = y0; y <= y1; y++)
+        {
+            float py = y + 0.5f;
+            float *row = depth + (size_t)y * width;
+            int x = x0;
+#if defined(OCCLUSION_SSE)
+            __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            __m128 zero = _mm_setzero_ps();
+            for (; x <= x1; x += 4)
+            {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), px), _mm_set1_ps(b[0] * py + c[0])), zero);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[1]), px), _mm_set1_ps(b[1] * py + c[1])), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), px), _mm_set1_ps(b[2] * py + c[2])), zero));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), _mm_set1_ps(dzdy * py + z0));
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+            }
+#endif
+            for (; x <= x1; x++)
+            {
+                float px = x + 0.5f;
+                if (a[0] * px + (b[0] * py + c[0]) >= 0 && a[1] * px + (b[1] * py + c[1]) >= 0 && a[2] * px + (b[2] * py + c[2]) >= 0)
+                    row[x] = std::min(row[x], dzdx * px + (dzdy * py + z0));
+            }
+        }
+    }
+
+    void buildPyramid()
+    {
+        for (size_t level = 1; level < levels.size(); level++)
+        {
+            const Level &below = levels[level - 1];
+            Level &l = levels[level];
+            for (int y = 0; y < l.Height; y++)
+            {
+                int by0 = y * 2, by1 = std::min(by0 + 1, below.Height - 1);
+                for (int x = 0; x < l.Width; x++)
+                {
+                    int bx0 = x * 2, bx1 = std::min(bx0 + 1, below.Width - 1);
+                    l.Depth[y * l.Width + x] = std::max(std::max(below.Depth[by0 * below.Width + bx0], below.Depth[by0 * below.Width + bx1]),
+                        std::max(below.Depth[by1 * below.Width + bx0], below.Depth[by1 * below.Width + bx1]));
+                }
+            }
+        }
+    }
+
+    void workerLoop(unsigned int band)
+    {
+        unsigned int seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this, seen] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+            rasterizeBand(band);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--remaining == 0)
+                bandsDone.notify_one();
+        }
+    }
+};
+
+#endif
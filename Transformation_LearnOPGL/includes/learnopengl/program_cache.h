@@ -0,0 +1,149 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+
+// Binary cache of a linked program (glGetProgramBinary), stored next to its vertex shader as
+// "<file>.programcache" : the Shader constructors load it instead of compiling and linking the GLSL.
+// Layout : ProgramCacheHeader, then the driver's binary. The key hashes the sources with the vendor, renderer and
+// version strings of the context ; a cache with another key or version, or that the driver refuses (it may after
+// any driver update), is rebuilt from the sources. A vertex shader shared by several programs keeps the last one.
+
+const unsigned int PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader {
+    char Magic[4];              // "PRGC"
+    unsigned int Version;       // PROGRAM_CACHE_VERSION
+    unsigned long long Key;     // ProgramCacheKey of the sources
+    unsigned int BinaryFormat;  // as returned by glGetProgramBinary
+    unsigned int BinarySize;    // bytes following the header
+};
+
+// false before GL 4.1 without ARB_get_program_binary, or when the driver has no binary format : the
+// functions below then do nothing. The extension is only checked when glad was generated with it
+inline bool ProgramBinarySupported()
+{
+#ifdef GL_ARB_get_program_binary
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+        return false;
+#else
+    if (!GLAD_GL_VERSION_4_1)
+        return false;
+#endif
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// FNV-1a, 64 bits, of the sources in order and the driver strings, each followed by a 0 so that
+// "ab" + "c" and "a" + "bc" differ
+inline unsigned long long ProgramCacheKey(const std::string *sources, int count)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    const GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (int i = 0; i < count + 3; i++)
+    {
+        const char *text = "";
+        size_t length = 0;
+        if (i < count)
+        {
+            text = sources[i].c_str();
+            length = sources[i].size();
+        }
+        else if (const GLubyte *value = glGetString(driverStrings[i - count]))
+        {
+            text = (const char*)value;
+            length = strlen(text);
+        }
+        for (size_t c = 0; c <= length; c++)
+            hash = (hash ^ (unsigned char)text[c]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// the program stored at cachePath, linked ; 0 when there is none, it is out of date or the driver refuses it
+inline GLuint LoadCachedProgram(const std::string &cachePath, unsigned long long key)
+{
+    if (!ProgramBinarySupported())
+        return 0;
+    FILE *file = fopen(cachePath.c_str(), "rb");
+    if (file == NULL)
+        return 0;
+
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.Magic, "PRGC", 4) == 0 &&
+        header.Version == PROGRAM_CACHE_VERSION && header.Key == key && header.BinarySize > 0;
+    if (valid)
+    {
+        binary.resize(header.BinarySize);
+        valid = fread(&binary[0], 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!valid)
+    {
+        std::cout << "PROGRAM_CACHE:: " << cachePath << " is out of date" << std::endl;
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.BinaryFormat, &binary[0], (GLsizei)binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE)
+    {
+        std::cout << "PROGRAM_CACHE:: " << cachePath << " was refused by the driver" << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// stores a linked program, through a temporary file so a reader never sees half a cache. Set
+// GL_PROGRAM_BINARY_RETRIEVABLE_HINT on it before linking
+inline bool SaveCachedProgram(const std::string &cachePath, unsigned long long key, GLuint program)
+{
+    if (!ProgramBinarySupported())
+        return false;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, &binary[0]);
+    if (written <= 0)
+        return false;
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, "PRGC", 4);
+    header.Version = PROGRAM_CACHE_VERSION;
+    header.Key = key;
+    header.BinaryFormat = format;
+    header.BinarySize = (unsigned int)written;
+
+    std::string tempPath = cachePath + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == NULL)
+        return false;
+    bool stored = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(&binary[0], 1, written, file) == (size_t)written;
+    stored = fclose(file) == 0 && stored;
+    if (stored)
+    {
+        remove(cachePath.c_str()); // rename() does not replace an existing file on Windows
+        stored = rename(tempPath.c_str(), cachePath.c_str()) == 0;
+    }
+    if (!stored)
+        remove(tempPath.c_str());
+    return stored;
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// The draws of a frame as packets with 64-bit keys, radix sorted so InstanceRenderer walks them grouped by program,
+// then material, then vertex array, and a RenderStateTracker drops the binds that repeat. Header-only for this
+// tree ; the Transformations sample has its own queue in sources/renderqueue.cpp.
+
+// key fields, most significant first : pass, program, material (see MaterialId), vertex array, depth. Only the low
+// bits of each value fit : two values may share a key and end up apart, which costs binds, not correctness
+const unsigned int RENDER_KEY_PASS_BITS = 4;
+const unsigned int RENDER_KEY_PROGRAM_BITS = 12;
+const unsigned int RENDER_KEY_MATERIAL_BITS = 16;
+const unsigned int RENDER_KEY_VERTEX_ARRAY_BITS = 16;
+const unsigned int RENDER_KEY_DEPTH_BITS = 16;
+
+enum RenderPass {
+    RENDER_PASS_OPAQUE = 0, // front to back, so early depth testing drops what is hidden
+    RENDER_PASS_BLENDED = 1 // back to front, after every opaque draw
+};
+
+// depth : distance to the camera, clamped to [0, farDepth] ; inverted for blended passes
+inline uint64_t MakeSortKey(RenderPass pass, unsigned int program, unsigned int material, unsigned int vertexArray, float depth, float farDepth)
+{
+    const unsigned int depthMax = (1u << RENDER_KEY_DEPTH_BITS) - 1;
+    float t = farDepth > 0 ? depth / farDepth : 0.0f;
+    t = t < 0 ? 0.0f : (t > 1 ? 1.0f : t);
+    unsigned int quantized = (unsigned int)(t * depthMax + 0.5f);
+    if (pass == RENDER_PASS_BLENDED)
+        quantized = depthMax - quantized;
+
+    uint64_t key = pass & ((1u << RENDER_KEY_PASS_BITS) - 1);
+    key = (key << RENDER_KEY_PROGRAM_BITS) | (program & ((1u << RENDER_KEY_PROGRAM_BITS) - 1));
+    key = (key << RENDER_KEY_MATERIAL_BITS) | (material & ((1u << RENDER_KEY_MATERIAL_BITS) - 1));
+    key = (key << RENDER_KEY_VERTEX_ARRAY_BITS) | (vertexArray & ((1u << RENDER_KEY_VERTEX_ARRAY_BITS) - 1));
+    return (key << RENDER_KEY_DEPTH_BITS) | quantized;
+}
+
+// one draw : Item is whatever the caller needs to issue it
+struct RenderPacket {
+    uint64_t Key;
+    unsigned int Item;
+};
+
+class RenderQueue
+{
+public:
+    void Clear() { packets.clear(); }
+
+    void Push(uint64_t key, unsigned int item)
+    {
+        RenderPacket packet;
+        packet.Key = key;
+        packet.Item = item;
+        packets.push_back(packet);
+    }
+
+    // LSD radix sort on the keys, a byte per pass ; bytes equal in every key are skipped, so a frame with one
+    // program only pays for the bytes that differ. Stable
+    void Sort()
+    {
+        size_t count = packets.size();
+        if (count < 2)
+            return;
+
+        // one histogram per byte in a single read of the keys
+        size_t histograms[8][256];
+        memset(histograms, 0, sizeof(histograms));
+        for (size_t i = 0; i < count; i++)
+            for (int b = 0; b < 8; b++)
+                histograms[b][(packets[i].Key >> (b * 8)) & 0xFF]++;
+
+        scratch.resize(count);
+        RenderPacket *from = &packets[0];
+        RenderPacket *to = &scratch[0];
+        for (int b = 0; b < 8; b++)
+        {
+            size_t *histogram = histograms[b];
+            // every key has the same byte here : the pass would keep the order
+            if (histogram[(packets[0].Key >> (b * 8)) & 0xFF] == count)
+                continue;
+            size_t offset = 0;
+            for (int v = 0; v < 256; v++)
+            {
+                size_t n = histogram[v];
+                histogram[v] = offset;
+                offset += n;
+            }
+            for (size_t i = 0; i < count; i++)
+                to[histogram[(from[i].Key >> (b * 8)) & 0xFF]++] = from[i];
+            swap(from, to);
+        }
+        if (from != &packets[0])
+            packets.swap(scratch);
+    }
+
+    size_t Size() const { return packets.size(); }
+    const RenderPacket &operator[](size_t i) const { return packets[i]; }
+
+private:
+    vector<RenderPacket> packets;
+    vector<RenderPacket> scratch;
+};
+
+// last state set by a walk ; each call says whether the value differs from the current one (and keeps it), the
+// caller issues the GL calls only then. StateChanges counts the changes since Reset
+class RenderStateTracker
+{
+public:
+    unsigned int StateChanges;
+
+    RenderStateTracker() { Reset(); }
+
+    // state unknown : the next value of each kind is a change
+    void Reset()
+    {
+        for (int i = 0; i < STATE_KINDS; i++)
+        {
+            current[i] = 0;
+            known[i] = false;
+        }
+        StateChanges = 0;
+    }
+
+    bool UseProgram(unsigned int program) { return change(PROGRAM, program); }
+    bool BindMaterial(unsigned int material) { return change(MATERIAL, material); }
+    bool BindVertexArray(unsigned int vertexArray) { return change(VERTEX_ARRAY, vertexArray); }
+
+private:
+    enum Kind { PROGRAM, MATERIAL, VERTEX_ARRAY, STATE_KINDS };
+    unsigned int current[STATE_KINDS];
+    bool known[STATE_KINDS];
+
+    bool change(Kind kind, unsigned int value)
+    {
+        if (known[kind] && current[kind] == value)
+            return false;
+        current[kind] = value;
+        known[kind] = true;
+        StateChanges++;
+        return true;
+    }
+};
+
+#endif
@@ -3,6 +3,11 @@
 
 #include <glad/glad.h>
 
+#include <learnopengl/gl_state.h>
+#include <learnopengl/uniforms.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/frame_constants.h>
+
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -44,6 +49,17 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        // a program linked from the same sources by the same driver is loaded as is (learnopengl/program_cache.h)
+        std::string cachePath = std::string(vertexPath) + ".programcache";
+        std::string sources[2] = { vertexCode, fragmentCode };
+        unsigned long long cacheKey = ProgramCacheKey(sources, 2);
+        ID = LoadCachedProgram(cachePath, cacheKey);
+        if (ID != 0)
+        {
+            uniforms.Build(ID);
+            BindFrameConstantsBlock(ID);
+            return;
+        }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -64,8 +80,18 @@ public:
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
+        if (ProgramBinarySupported())
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        GLint linked = GL_FALSE;
+        glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+        if (linked == GL_TRUE)
+            SaveCachedProgram(cachePath, cacheKey, ID);
+        // every uniform location, once : the setters below look them up without asking GL
+        uniforms.Build(ID);
+        // the per-frame uniform buffer (learnopengl/frame_constants.h)
+        BindFrameConstantsBlock(ID);
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -74,26 +100,33 @@ public:
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState().UseProgram(ID); 
+    }
+    // location of a uniform of the program, -1 if it has none ; resolved when the program was linked
+    GLint Location(UniformName name) const
+    {
+        return uniforms.Location(name);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(UniformName name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(uniforms.Location(name), (int)value); 
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(UniformName name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(uniforms.Location(name), value); 
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(UniformName name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(uniforms.Location(name), value); 
     }
 
 private:
+    UniformTable uniforms;
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
@@ -0,0 +1,454 @@
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/vertex_cache.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+using namespace std;
+
+// Level of detail chain built by Model::processMesh : quadric error metric edge collapses (Garland & Heckbert,
+// "Surface Simplification Using Quadric Error Metrics"). Every level indexes the mesh's own vertices, so the
+// levels are only ranges of one element buffer. Errors are distances relative to the mesh bounding box
+// diagonal : 0.01 is 1% of the mesh size.
+
+struct LodSettings {
+    unsigned int MaxLevels;    // levels in the chain, the full mesh included ; 0 : as many as MinTriangles and MaxError allow
+    float Reduction;           // triangle count of a level over the one before
+    unsigned int MinTriangles; // no level goes below this
+    float MaxError;            // no level goes above this
+
+    // halving the triangles each time, down to 64 triangles or 5% error : a 65k triangle mesh gets 11 levels, and
+    // all of them together take less than twice the indices of the full one
+    LodSettings() : MaxLevels(0), Reduction(0.5f), MinTriangles(64), MaxError(0.05f) {}
+};
+
+// planes along seams and open borders weigh this much more than the surface, so they barely move
+const double LOD_BORDER_WEIGHT = 4.0;
+
+// sum of weighted squared distances to planes : p^T A p + 2 b.p + c, with A symmetric
+struct Quadric {
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight;
+
+    Quadric() : a00(0), a01(0), a02(0), a11(0), a12(0), a22(0), b0(0), b1(0), b2(0), c(0), weight(0) {}
+
+    // plane through point with unit normal n
+    void AddPlane(const glm::vec3 &n, const glm::vec3 &point, double w)
+    {
+        double x = n.x, y = n.y, z = n.z;
+        double d = -(x * point.x + y * point.y + z * point.z);
+        a00 += w * x * x; a01 += w * x * y; a02 += w * x * z;
+        a11 += w * y * y; a12 += w * y * z; a22 += w * z * z;
+        b0 += w * x * d; b1 += w * y * d; b2 += w * z * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    void Add(const Quadric &q)
+    {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02;
+        a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+    }
+
+    // root of the weighted mean squared distance : a distance, whatever the area around the vertex
+    float Error(const glm::vec3 &p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a00 * x * x + a11 * y * y + a22 * z * z
+            + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+            + 2 * (b0 * x + b1 * y + b2 * z) + c;
+        if (e <= 0 || weight <= 0)
+            return 0.0f;
+        return (float)sqrt(e / weight);
+    }
+};
+
+// triangle edge between two positions ; wedges are the actual vertices, which may differ in UV, normal or tangent
+struct LodHalfEdge {
+    unsigned int from, to;
+    unsigned int wedgeFrom, wedgeTo;
+    unsigned int triangle;
+
+    bool operator<(const LodHalfEdge &other) const
+    {
+        return from != other.from ? from < other.from : to < other.to;
+    }
+};
+
+struct LodCollapse {
+    unsigned int from, to; // positions
+    float error;
+
+    bool operator<(const LodCollapse &other) const { return error < other.error; }
+};
+
+// state of one simplification : the current index list and the quadrics it accumulated, so a chain is
+// built by a single run paused at every level
+class Simplifier
+{
+public:
+    vector<unsigned int> indices;
+    float reached; // largest error of the collapses done so far
+
+    Simplifier(const vector<unsigned int> &source, const vector<Vertex> &vertices) : reached(0.0f)
+    {
+        vertexCount = vertices.size();
+        indices.assign(source.begin(), source.end() - source.size() % 3);
+        if (vertexCount == 0)
+            return;
+
+        glm::vec3 boundsMin = vertices[0].Position, boundsMax = vertices[0].Position;
+        for (size_t v = 1; v < vertexCount; v++)
+        {
+            boundsMin = glm::min(boundsMin, vertices[v].Position);
+            boundsMax = glm::max(boundsMax, vertices[v].Position);
+        }
+        float diagonal = glm::length(boundsMax - boundsMin);
+        float invScale = diagonal > 0 ? 1.0f / diagonal : 1.0f;
+        scaled.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            scaled[v] = (vertices[v].Position - boundsMin) * invScale;
+
+        // vertices split for UVs or normals share a position : the first of them stands for all
+        vector<unsigned int> order(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            order[v] = (unsigned int)v;
+        const vector<glm::vec3> &p = scaled;
+        sort(order.begin(), order.end(), [&p](unsigned int a, unsigned int b) {
+            return p[a].x != p[b].x ? p[a].x < p[b].x : (p[a].y != p[b].y ? p[a].y < p[b].y : p[a].z < p[b].z);
+        });
+        position.resize(vertexCount);
+        position[order[0]] = order[0];
+        for (size_t i = 1; i < vertexCount; i++)
+            position[order[i]] = p[order[i]] == p[order[i - 1]] ? position[order[i - 1]] : order[i];
+
+        // each position starts with the planes of its triangles, weighted by area, plus planes standing on its seam and border edges
+        quadrics.assign(vertexCount, Quadric());
+        for (size_t t = 0; t < indices.size() / 3; t++)
+        {
+            unsigned int a = position[indices[t * 3]], b = position[indices[t * 3 + 1]], c = position[indices[t * 3 + 2]];
+            glm::vec3 normal = glm::cross(p[b] - p[a], p[c] - p[a]);
+            float length = glm::length(normal);
+            if (length <= 0)
+                continue;
+            normal /= length;
+            quadrics[a].AddPlane(normal, p[a], length * 0.5);
+            quadrics[b].AddPlane(normal, p[a], length * 0.5);
+            quadrics[c].AddPlane(normal, p[a], length * 0.5);
+        }
+        buildHalfEdges();
+        for (size_t i = 0; i < edges.size(); i++)
+        {
+            const LodHalfEdge &halfEdge = edges[i];
+            bool hasOpposite;
+            unsigned int pointSplit;
+            if (!isConstrained(halfEdge, hasOpposite, pointSplit))
+                continue;
+            const unsigned int *triangle = &indices[halfEdge.triangle * 3];
+            glm::vec3 normal = glm::cross(p[position[triangle[1]]] - p[position[triangle[0]]], p[position[triangle[2]]] - p[position[triangle[0]]]);
+            glm::vec3 edge = p[halfEdge.to] - p[halfEdge.from];
+            glm::vec3 side = glm::cross(edge, normal);
+            float length = glm::length(side);
+            if (length <= 0)
+                continue;
+            side /= length;
+            double weight = glm::dot(edge, edge) * LOD_BORDER_WEIGHT;
+            quadrics[halfEdge.from].AddPlane(side, p[halfEdge.from], weight);
+            quadrics[halfEdge.to].AddPlane(side, p[halfEdge.from], weight);
+        }
+
+        kind.resize(vertexCount);
+        splitPoints.resize(vertexCount);
+        constrainedEdges.resize(vertexCount);
+        triangleCount.resize(vertexCount);
+        offsets.resize(vertexCount + 1);
+        touched.resize(vertexCount);
+        wedgeRemap.resize(vertexCount);
+    }
+
+    // collapses edges until indices is down to targetIndexCount or the next collapse would cost more than maxError.
+    // Each pass collapses the cheapest edges whose neighbourhoods do not overlap, then rebuilds the list.
+    void Run(size_t targetIndexCount, float maxError)
+    {
+        if (vertexCount == 0)
+            return;
+        const vector<glm::vec3> &p = scaled;
+        while (indices.size() > targetIndexCount)
+        {
+            size_t triangles = indices.size() / 3;
+            buildHalfEdges();
+
+            // classify positions by the seam and border edges around them ; a point split locks its position
+            fill(constrainedEdges.begin(), constrainedEdges.end(), 0);
+            fill(splitPoints.begin(), splitPoints.end(), 0);
+            edgeConstrained.resize(edges.size());
+            edgeHasOpposite.resize(edges.size());
+            for (size_t i = 0; i < edges.size(); i++)
+            {
+                bool hasOpposite;
+                unsigned int pointSplit;
+                edgeConstrained[i] = isConstrained(edges[i], hasOpposite, pointSplit);
+                edgeHasOpposite[i] = hasOpposite;
+                if (pointSplit != ~0u)
+                    splitPoints[pointSplit] = 1;
+                // a seam shows up from both sides : count it once
+                if (edgeConstrained[i] && (!hasOpposite || edges[i].from < edges[i].to))
+                {
+                    constrainedEdges[edges[i].from]++;
+                    constrainedEdges[edges[i].to]++;
+                }
+            }
+            for (size_t v = 0; v < vertexCount; v++)
+                kind[v] = splitPoints[v] ? LOCKED : (constrainedEdges[v] == 0 ? FREE : (constrainedEdges[v] == 2 ? CONSTRAINED : LOCKED));
+
+            // candidate collapses, one per edge, in the cheaper allowed direction
+            collapses.clear();
+            for (size_t i = 0; i < edges.size(); i++)
+            {
+                const LodHalfEdge &edge = edges[i];
+                if (edgeHasOpposite[i] && edge.from > edge.to)
+                    continue;
+                LodCollapse best;
+                best.error = -1.0f;
+                for (int direction = 0; direction < 2; direction++)
+                {
+                    unsigned int from = direction == 0 ? edge.from : edge.to;
+                    unsigned int to = direction == 0 ? edge.to : edge.from;
+                    if (kind[from] == LOCKED || (kind[from] == CONSTRAINED && !edgeConstrained[i]))
+                        continue;
+                    Quadric merged = quadrics[from];
+                    merged.Add(quadrics[to]);
+                    float error = merged.Error(p[to]);
+                    if (best.error < 0 || error < best.error)
+                    {
+                        best.from = from;
+                        best.to = to;
+                        best.error = error;
+                    }
+                }
+                if (best.error >= 0 && best.error <= maxError)
+                    collapses.push_back(best);
+            }
+            sort(collapses.begin(), collapses.end());
+
+            // triangles around each position
+            fill(triangleCount.begin(), triangleCount.end(), 0);
+            for (size_t i = 0; i < indices.size(); i++)
+                triangleCount[position[indices[i]]]++;
+            offsets[0] = 0;
+            for (size_t v = 0; v < vertexCount; v++)
+                offsets[v + 1] = offsets[v] + triangleCount[v];
+            adjacency.resize(indices.size());
+            fillOffsets.assign(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                adjacency[fillOffsets[position[indices[i]]]++] = (unsigned int)(i / 3);
+
+            fill(touched.begin(), touched.end(), 0);
+            for (size_t v = 0; v < vertexCount; v++)
+                wedgeRemap[v] = (unsigned int)v;
+            size_t needed = triangles - targetIndexCount / 3;
+            size_t removed = 0;
+            size_t done = 0;
+            for (size_t i = 0; i < collapses.size() && removed < needed; i++)
+            {
+                const LodCollapse &collapse = collapses[i];
+                unsigned int a = collapse.from, b = collapse.to;
+                if (touched[a] || touched[b])
+                    continue;
+
+                // refuse collapses that would fold a triangle over
+                bool flips = false;
+                size_t onEdge = 0;
+                for (unsigned int j = offsets[a]; j < offsets[a + 1] && !flips; j++)
+                {
+                    const unsigned int *triangle = &indices[adjacency[j] * 3];
+                    glm::vec3 before[3], after[3];
+                    bool hasB = false;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        unsigned int q = position[triangle[k]];
+                        hasB = hasB || q == b;
+                        before[k] = p[q];
+                        after[k] = q == a ? p[b] : p[q];
+                    }
+                    if (hasB)
+                    {
+                        onEdge++;
+                        continue;
+                    }
+                    flips = glm::dot(glm::cross(before[1] - before[0], before[2] - before[0]), glm::cross(after[1] - after[0], after[2] - after[0])) <= 0;
+                }
+                if (flips)
+                    continue;
+
+                // each vertex at a follows the vertex at b it shares a triangle with, so UVs and normals stay on their side of a seam
+                for (unsigned int j = offsets[a]; j < offsets[a + 1]; j++)
+                {
+                    const unsigned int *triangle = &indices[adjacency[j] * 3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        if (position[triangle[k]] != a)
+                            continue;
+                        for (int m = 0; m < 3; m++)
+                            if (position[triangle[m]] == b)
+                                wedgeRemap[triangle[k]] = triangle[m];
+                    }
+                }
+                for (unsigned int j = offsets[a]; j < offsets[a + 1]; j++)
+                {
+                    const unsigned int *triangle = &indices[adjacency[j] * 3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        if (position[triangle[k]] == a && wedgeRemap[triangle[k]] == triangle[k])
+                            wedgeRemap[triangle[k]] = b;
+                        touched[position[triangle[k]]] = 1;
+                    }
+                }
+                quadrics[b].Add(quadrics[a]);
+                reached = max(reached, collapse.error);
+                removed += onEdge;
+                done++;
+            }
+            if (done == 0)
+                break;
+
+            next.clear();
+            for (size_t t = 0; t < triangles; t++)
+            {
+                unsigned int w0 = wedgeRemap[indices[t * 3]], w1 = wedgeRemap[indices[t * 3 + 1]], w2 = wedgeRemap[indices[t * 3 + 2]];
+                unsigned int p0 = position[w0], p1 = position[w1], p2 = position[w2];
+                if (p0 == p1 || p1 == p2 || p0 == p2)
+                    continue;
+                next.push_back(w0);
+                next.push_back(w1);
+                next.push_back(w2);
+            }
+            indices.swap(next);
+        }
+    }
+
+private:
+    enum VertexKind {
+        FREE,        // inside a smooth surface : may collapse anywhere
+        CONSTRAINED, // on one seam or border line : may only slide along it
+        LOCKED       // where seams or borders meet : stays
+    };
+
+    size_t vertexCount;
+    vector<glm::vec3> scaled;      // positions in a unit-sized copy of the mesh, so errors come out relative
+    vector<unsigned int> position; // vertex -> the vertex standing for its position
+    vector<Quadric> quadrics;      // by position
+
+    // work buffers, kept from pass to pass
+    vector<LodHalfEdge> edges;
+    vector<bool> edgeConstrained, edgeHasOpposite;
+    vector<unsigned char> kind;
+    vector<unsigned char> splitPoints; // by position : split around the point, along no edge
+    vector<unsigned int> constrainedEdges;
+    vector<unsigned int> triangleCount, offsets, adjacency, fillOffsets;
+    vector<LodCollapse> collapses;
+    vector<unsigned char> touched;
+    vector<unsigned int> wedgeRemap;
+    vector<unsigned int> next;
+
+    void buildHalfEdges()
+    {
+        edges.resize(indices.size());
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            size_t following = i % 3 == 2 ? i - 2 : i + 1;
+            LodHalfEdge &edge = edges[i];
+            edge.wedgeFrom = indices[i];
+            edge.wedgeTo = indices[following];
+            edge.from = position[edge.wedgeFrom];
+            edge.to = position[edge.wedgeTo];
+            edge.triangle = (unsigned int)(i / 3);
+        }
+        sort(edges.begin(), edges.end());
+    }
+
+    // an open border has no triangle on the other side ; a seam has one, but it uses other vertices at both ends.
+    // Other vertices at one end only (a pole with a vertex per fan triangle) split that point, not the edge : the
+    // edge is free and pointSplit is the position to lock, ~0u when there is none
+    bool isConstrained(const LodHalfEdge &edge, bool &hasOpposite, unsigned int &pointSplit) const
+    {
+        LodHalfEdge key;
+        key.from = edge.to;
+        key.to = edge.from;
+        pair<vector<LodHalfEdge>::const_iterator, vector<LodHalfEdge>::const_iterator> opposite = equal_range(edges.begin(), edges.end(), key);
+        hasOpposite = opposite.first != opposite.second;
+        pointSplit = ~0u;
+        for (vector<LodHalfEdge>::const_iterator it = opposite.first; it != opposite.second; ++it)
+        {
+            bool sameTo = it->wedgeFrom == edge.wedgeTo, sameFrom = it->wedgeTo == edge.wedgeFrom;
+            if (sameTo && sameFrom)
+            {
+                pointSplit = ~0u;
+                return false;
+            }
+            if (sameTo || sameFrom)
+                pointSplit = sameTo ? edge.from : edge.to;
+        }
+        return pointSplit == ~0u;
+    }
+};
+
+// collapses edges by increasing error until indices is down to targetIndexCount, or the next collapse would cost
+// more than maxError ; vertices sharing a position move together, seams and open borders stay in place.
+// Returns the largest error of the collapses done.
+inline float SimplifyMesh(const vector<unsigned int> &indices, const vector<Vertex> &vertices, size_t targetIndexCount, float maxError, vector<unsigned int> &result)
+{
+    Simplifier simplifier(indices, vertices);
+    simplifier.Run(targetIndexCount, maxError);
+    result.swap(simplifier.indices);
+    return simplifier.reached;
+}
+
+// replaces indices (level 0) by the whole chain, level after level, each ordered for the vertex cache ; lods[0] is the full mesh
+inline void BuildLodChain(vector<unsigned int> &indices, const vector<Vertex> &vertices, vector<MeshLod> &lods, const LodSettings &settings = LodSettings())
+{
+    lods.clear();
+    MeshLod full;
+    full.FirstIndex = 0;
+    full.IndexCount = (unsigned int)indices.size();
+    full.Error = 0.0f;
+    lods.push_back(full);
+    if (vertices.empty())
+        return;
+
+    // one run from the full mesh to the coarsest level, copied out each time it gets down to a level
+    Simplifier simplifier(indices, vertices);
+    size_t target = indices.size() / 3;
+    vector<unsigned int> level;
+    for (unsigned int i = 1; settings.MaxLevels == 0 || i < settings.MaxLevels; i++)
+    {
+        target = (size_t)(target * settings.Reduction);
+        if (target < settings.MinTriangles)
+            break;
+        simplifier.Run(target * 3, settings.MaxError);
+        // the error limit stopped it well before the target : coarser levels would be the same
+        if (simplifier.indices.size() * 10 > (size_t)lods.back().IndexCount * 9)
+            break;
+
+        level = simplifier.indices;
+        OptimizeVertexCache(level, vertices.size());
+        MeshLod lod;
+        lod.FirstIndex = (unsigned int)indices.size();
+        lod.IndexCount = (unsigned int)level.size();
+        lod.Error = simplifier.reached;
+        indices.insert(indices.end(), level.begin(), level.end());
+        lods.push_back(lod);
+    }
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef UNIFORMS_H
+#define UNIFORMS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Uniform locations resolved once, when the program is linked : UniformTable::Build lists the program's active
+// uniforms (glGetActiveUniform) into an open addressing table keyed by the hash of their names, and a Shader
+// setter is a probe of that table instead of a glGetUniformLocation. Names are passed as UniformName, which a
+// string literal converts to with its hash folded at compile time ; neither side allocates. Names whose hashes
+// collide both stay in the table, and only their slots compare the name on a lookup.
+
+// FNV-1a, 32 bits
+constexpr unsigned int UniformHash(const char *name, unsigned int hash = 2166136261u)
+{
+    return *name == 0 ? hash : UniformHash(name + 1, (hash ^ (unsigned char)*name) * 16777619u);
+}
+
+// the hash of a uniform name ; from a literal it is a constant (a constexpr UniformName guarantees it), from a
+// string it is computed on the spot, without copying the string. Name is only read when the hash collides
+struct UniformName {
+    unsigned int Hash;
+    const char *Name;
+
+    template <size_t N>
+    constexpr UniformName(const char (&name)[N]) : Hash(UniformHash(name)), Name(name) {}
+    UniformName(const std::string &name) : Hash(UniformHash(name.c_str())), Name(name.c_str()) {}
+    // a hash kept from an earlier UniformHash(name)
+    UniformName(unsigned int hash, const char *name) : Hash(hash), Name(name) {}
+};
+
+class UniformTable
+{
+public:
+    UniformTable() : mask(0) {}
+
+    // lists the active uniforms of a linked program. An array is reachable by its name, its name with [0], and
+    // every element name[i] ; uniforms of uniform blocks have no location and are left out
+    void Build(GLuint program)
+    {
+        std::vector<std::string> names;
+        std::vector<GLint> found;
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(program, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, &buffer[0]);
+            std::string name(&buffer[0], length);
+            GLint location = glGetUniformLocation(program, name.c_str());
+            if (location < 0)
+                continue;
+            names.push_back(name);
+            found.push_back(location);
+            if (name.size() < 3 || name.compare(name.size() - 3, 3, "[0]") != 0)
+                continue;
+            std::string base = name.substr(0, name.size() - 3);
+            names.push_back(base);
+            found.push_back(location);
+            for (GLint element = 1; element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                names.push_back(elementName);
+                found.push_back(glGetUniformLocation(program, elementName.c_str()));
+            }
+        }
+
+        // at most half full
+        size_t capacity = 8;
+        while (capacity < names.size() * 2)
+            capacity *= 2;
+        slots.assign(capacity, Slot());
+        mask = (unsigned int)capacity - 1;
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            // names of the same hash share a probe chain : the new one goes after the others and all of them
+            // are marked, so a lookup tells them apart by name
+            unsigned int hash = UniformHash(names[i].c_str());
+            bool collides = false;
+            size_t s = hash & mask;
+            for (; slots[s].Location >= 0; s = (s + 1) & mask)
+                if (slots[s].Hash == hash)
+                    slots[s].Collides = collides = true;
+            slots[s].Hash = hash;
+            slots[s].Location = found[i];
+            slots[s].Collides = collides;
+            slots[s].Name = names[i];
+        }
+    }
+
+    // -1 when the program has no such uniform, which glUniform* ignores like it does for glGetUniformLocation's
+    GLint Location(UniformName name) const
+    {
+        if (slots.empty())
+            return -1;
+        for (size_t s = name.Hash & mask; slots[s].Location >= 0; s = (s + 1) & mask)
+            if (slots[s].Hash == name.Hash && (!slots[s].Collides || strcmp(slots[s].Name.c_str(), name.Name) == 0))
+                return slots[s].Location;
+        return -1;
+    }
+
+private:
+    // an empty slot has no location
+    struct Slot {
+        unsigned int Hash;
+        GLint Location;
+        bool Collides; // another name has the same hash : compare Name
+        std::string Name;
+        Slot() : Hash(0), Location(-1), Collides(false) {}
+    };
+
+    std::vector<Slot> slots;
+    unsigned int mask;
+};
+
+#endif
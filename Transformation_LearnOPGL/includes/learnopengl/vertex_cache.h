@@ -0,0 +1,168 @@
+#ifndef VERTEX_CACHE_H
+#define VERTEX_CACHE_H
+
+#include <learnopengl/mesh.h>
+
+#include <cmath>
+#include <vector>
+using namespace std;
+
+// Mesh optimization run by Model::processMesh once a mesh is indexed : OptimizeVertexCache orders the
+// triangles for the post-transform cache, then OptimizeVertexFetch lays the vertices out in that order.
+// Like everything under learnopengl/ it is header-only and works on Vertex ; Transformations keeps its own
+// version, over separate attribute arrays, in sources/meshoptimize.cpp.
+
+// entries of the post-transform cache the scores assume
+const int VERTEX_CACHE_SIZE = 32;
+
+// score of a vertex after Tom Forsyth ("Linear-Speed Vertex Cache Optimisation"), computed on the spot : 0.75 in the
+// 3 newest entries, falling off with age after that, plus 2 / sqrt(triangles left) ; -1 once it has no triangle left
+inline float ForsythVertexScore(int cachePosition, unsigned int activeTriangles)
+{
+    if (activeTriangles == 0)
+        return -1.0f; // never used again
+    float score = 0.0f;
+    if (cachePosition >= 0)
+        score = cachePosition < 3 ? 0.75f : powf(1.0f - (float)(cachePosition - 3) / (VERTEX_CACHE_SIZE - 3), 1.5f);
+    return score + 2.0f / sqrtf((float)activeTriangles);
+}
+
+// reorders the triangles of indices (a triangle list) for vertex reuse ; linear in the number of triangles
+inline void OptimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount)
+{
+    const size_t noTriangle = (size_t)-1;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles still to emit around each vertex : vertex v owns adjacency[offsets[v] .. offsets[v] + activeCount[v]]
+    vector<unsigned int> activeCount(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        activeCount[indices[i]]++;
+    vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + activeCount[v];
+    vector<unsigned int> adjacency(triangleCount * 3);
+    vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScores[v] = ForsythVertexScore(-1, activeCount[v]);
+
+    vector<bool> emitted(triangleCount, false);
+    size_t best = 0;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = t;
+        }
+    }
+
+    vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    // the emitted triangle's vertices go in front, so the cache briefly holds 3 more entries
+    unsigned int cache[VERTEX_CACHE_SIZE + 3];
+    unsigned int newCache[VERTEX_CACHE_SIZE + 3];
+    unsigned int cacheCount = 0;
+    size_t cursor = 0; // next triangle in file order, for when nothing in the cache has triangles left
+
+    while (best != noTriangle)
+    {
+        emitted[best] = true;
+        const unsigned int *triangle = &indices[best * 3];
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = triangle[k];
+            output.push_back(v);
+            unsigned int *list = &adjacency[offsets[v]];
+            for (unsigned int j = 0; j < activeCount[v]; j++)
+            {
+                if (list[j] == best)
+                {
+                    list[j] = list[activeCount[v] - 1];
+                    break;
+                }
+            }
+            activeCount[v]--;
+        }
+
+        unsigned int newCount = 0;
+        newCache[newCount++] = triangle[0];
+        if (triangle[1] != triangle[0])
+            newCache[newCount++] = triangle[1];
+        if (triangle[2] != triangle[0] && triangle[2] != triangle[1])
+            newCache[newCount++] = triangle[2];
+        for (unsigned int i = 0; i < cacheCount; i++)
+            if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+                newCache[newCount++] = cache[i];
+
+        for (unsigned int i = 0; i < newCount; i++)
+        {
+            unsigned int v = newCache[i];
+            cachePosition[v] = i < (unsigned int)VERTEX_CACHE_SIZE ? (int)i : -1;
+            vertexScores[v] = ForsythVertexScore(cachePosition[v], activeCount[v]);
+        }
+        cacheCount = newCount < (unsigned int)VERTEX_CACHE_SIZE ? newCount : VERTEX_CACHE_SIZE;
+        for (unsigned int i = 0; i < cacheCount; i++)
+            cache[i] = newCache[i];
+
+        // only triangles around vertices whose score changed can become the best one
+        best = noTriangle;
+        bestScore = -1.0f;
+        for (unsigned int i = 0; i < newCount; i++)
+        {
+            unsigned int v = newCache[i];
+            const unsigned int *list = &adjacency[offsets[v]];
+            for (unsigned int j = 0; j < activeCount[v]; j++)
+            {
+                unsigned int t = list[j];
+                float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        if (best == noTriangle)
+        {
+            while (cursor < triangleCount && emitted[cursor])
+                cursor++;
+            if (cursor < triangleCount)
+                best = cursor;
+        }
+    }
+
+    indices.swap(output);
+}
+
+// renumbers vertices in the order indices first use them (unused vertices are dropped), so the fetch walks forward
+inline void OptimizeVertexFetch(vector<unsigned int> &indices, vector<Vertex> &vertices)
+{
+    const unsigned int unused = (unsigned int)-1;
+    vector<unsigned int> remap(vertices.size(), unused);
+    vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        unsigned int &index = remap[indices[i]];
+        if (index == unused)
+        {
+            index = (unsigned int)reordered.size();
+            reordered.push_back(vertices[indices[i]]);
+        }
+        indices[i] = index;
+    }
+    vertices.swap(reordered);
+}
+
+#endif
@@ -1,16 +1,45 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+// Takes both vertex formats of learnopengl/mesh.h :
+//  Vertex           : aPos.w and aNormal.w default to 1, positionScale = (1,1,1), positionOffset = (0,0,0)
+//  CompressedVertex : aPos.xyz is 0..1 inside the mesh bounding box and aPos.w the tangent angle (0..1 turn),
+//                     aNormal.w the bitangent sign ; positionScale = box size, positionOffset = box min
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec4 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per instance model matrix and position decoding (InstanceRenderer), read instead of the uniforms when instanced is set
+layout (location = 5) in mat4 aInstanceModel;
+layout (location = 9) in vec3 aInstanceScale;
+layout (location = 10) in vec3 aInstanceOffset;
 
 out vec2 TexCoords;
 
+// per-frame constants, learnopengl/frame_constants.h ; only the camera is read here
+struct Light {
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec3 viewPos;
+    int lightCount;
+    Light lights[4];
+};
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform bool instanced;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
 
 void main()
 {
     TexCoords = aTexCoords;    
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    mat4 world = instanced ? aInstanceModel : model;
+    vec3 scale = instanced ? aInstanceScale : positionScale;
+    vec3 offset = instanced ? aInstanceOffset : positionOffset;
+    gl_Position = viewProjection * world * vec4(aPos.xyz * scale + offset, 1.0);
 }
\ No newline at end of file
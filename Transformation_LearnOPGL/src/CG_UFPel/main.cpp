@@ -9,17 +9,25 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/async_loader.h>
+#include <learnopengl/instancing.h>
+#include <learnopengl/frame_constants.h>
 
+#include <cstdlib>
 #include <iostream>
+#include <new>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow *window, std::vector<Model> &models, unsigned short &index);
+void processInput(GLFWwindow *window, std::vector<Model> &models, unsigned short &index, AsyncModelLoader &loader);
+int findRock(const std::vector<Model> &models, const unsigned int rockSources[2]);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// rocks added by key 5
+const int ASTEROID_FIELD_SIZE = 10000;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -31,6 +39,23 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
+// heap allocations made by each thread : the frame reports those of the draw path, which reuses its buffers and
+// looks uniforms up without building strings, so it should read 0 once the scene is loaded
+thread_local unsigned long threadAllocations = 0;
+
+void *operator new(size_t size)
+{
+    threadAllocations++;
+    if (void *p = malloc(size > 0 ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
 int main()
 {
     // glfw: initialize and configure
@@ -71,11 +96,16 @@ int main()
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    // through the state cache (learnopengl/gl_state.h), like every bind of the frame
+    GLState().Enable(GL_DEPTH_TEST);
+    // back faces are dropped anyway by the meshlet cone test (Model::Cull), the rasterizer does the same for the rest
+    GLState().Enable(GL_CULL_FACE);
 
-    // build and compile shaders
+    // build and compile shaders ; from the second run on they come out of the program cache (learnopengl/program_cache.h)
     // -------------------------
+    double shaderStartTime = glfwGetTime();
     Shader ourShader(FileSystem::getPath("resources/cg_ufpel.vs").c_str(), FileSystem::getPath("resources/cg_ufpel.fs").c_str());
+    std::cout << "shaders ready in " << (glfwGetTime() - shaderStartTime) * 1000.0 << " ms" << std::endl;
 
     // load models
     // -----------
@@ -93,11 +123,12 @@ int main()
 		glm::vec3(-2.0f, -1.75f, 0.0f),
 		glm::vec3(0.2f, 0.2f, 0.2f)
 	);
-	Model ourModel4(FileSystem::getPath("resources/objects/rock/rock.obj"),
+	// the other rocks share the first one's meshes, so the three are drawn instanced
+	Model ourModel4(ourModel2,
 		glm::vec3(3.0f, 2.0f, 0.0f),
 		glm::vec3(0.5f, 0.5f, 0.5f)
 	);
-	Model ourModel5(FileSystem::getPath("resources/objects/rock/rock.obj"),
+	Model ourModel5(ourModel2,
 		glm::vec3(-3.0f, 2.0f, 0.0f),
 		glm::vec3(0.5)
 	);
@@ -113,6 +144,9 @@ int main()
 
     // render loop
     // -----------
+	// the nanosuit and the planet hide the rocks behind them : they are drawn into the occlusion buffer
+	ourModel.Occluder = true;
+	ourModel3.Occluder = true;
 	std::vector<Model> models;
 	models.push_back(ourModel);
 	models.push_back(ourModel2);
@@ -131,6 +165,17 @@ int main()
 	}*/
 	unsigned short index = 0;
 	float press = 0;
+	// models spawned from the keyboard are loaded in the background, with compressed vertices (see processInput)
+	AsyncModelLoader loader;
+	// world bounding spheres of the models, culled against the frustum as one batch every frame
+	SphereBatch bounds;
+	vector<unsigned char> visible;
+	float lastCullReport = 0.0f;
+	OcclusionBuffer occlusion;
+	// repeated models (the rocks) are drawn instanced
+	InstanceRenderer renderer;
+	// camera of the frame, shared by every program through one uniform buffer
+	FrameConstantsBuffer frameConstants;
     while (!glfwWindowShouldClose(window))
     {
         // per-frame time logic
@@ -142,13 +187,20 @@ int main()
         // input
         // -----
 		//if ((currentFrame - press) > .3f) {
-			processInput(window, models, index);
+			processInput(window, models, index, loader);
 			press = glfwGetTime();
 		//}
 			
 
 
 
+		// upload the models that finished loading, 2 ms per frame at most
+		// -----
+		loader.Pump(models, 0.002);
+		// deleted models leave holes in the geometry arenas : packed again once they add up
+		VertexArena().CompactIfFragmented();
+		CompressedVertexArena().CompactIfFragmented();
+
 		// animation
 		// -----
 		for (int i = 0; i < models.size(); ++i) {
@@ -160,6 +212,8 @@ int main()
         // ------
         glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        GLState().ResetCounters();
+        unsigned long frameAllocations = threadAllocations;
 
         // don't forget to enable shader before setting uniforms
         ourShader.use();
@@ -167,14 +221,58 @@ int main()
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
+        FrameConstants constants;
+        constants.View = view;
+        constants.Projection = projection;
+        constants.ViewProjection = projection * view;
+        constants.ViewPos = camera.Position;
+        constants.LightCount = 0; // cg_ufpel.fs is unlit
+        frameConstants.Upload(constants);
 
         // render the loaded model
 		//ourShader.setMat4("model", model);
+		// distant models (a crowd of rocks) drop to their coarser levels of detail
+		float pixelsPerUnit = projection[1][1] * SCR_HEIGHT * 0.5f;
+		bounds.Resize(models.size());
+		for (int i = 0; i < models.size(); ++i) {
+			glm::vec3 center;
+			float radius;
+			models[i].WorldBounds(center, radius);
+			bounds.Set(i, center, radius);
+		}
+		CullStats cullStats = bounds.Cull(projection * view, visible);
+		// then the models hidden behind the occluders left in view
+		occlusion.Clear();
+		for (int i = 0; i < models.size(); ++i) {
+			if (visible[i] && models[i].Occluder)
+				models[i].AddOccluder(occlusion, projection * view);
+		}
+		occlusion.Rasterize();
+		unsigned int occluded = 0;
 		for (int i = 0; i < models.size(); ++i) {
-			ourShader.setMat4("model", models[i].Matrix);
-			models[i].Draw(ourShader);
+			if (!visible[i] || models[i].Occluder)
+				continue;
+			glm::vec3 boundsMin, boundsMax;
+			models[i].Bounds(boundsMin, boundsMax);
+			if (!occlusion.IsVisible(boundsMin, boundsMax, projection * view * models[i].Matrix)) {
+				visible[i] = 0;
+				occluded++;
+			}
+		}
+		renderer.Begin();
+		for (int i = 0; i < models.size(); ++i) {
+			if (visible[i])
+				renderer.Add(models[i]);
+		}
+		renderer.Submit(ourShader, projection * view, camera.Position, pixelsPerUnit, 100.0f);
+		frameAllocations = threadAllocations - frameAllocations;
+		if (currentFrame - lastCullReport >= 1.0f) {
+			std::cout << cullStats.Visible - occluded << " models visible, " << cullStats.Culled << " culled, " << occluded << " occluded ; "
+				<< renderer.DrawCalls << " draw calls for " << renderer.Commands << " commands, " << renderer.StateChanges << " state changes, "
+				<< renderer.InstancedModels << " models instanced ; " << GLState().Issued << " state calls issued, " << GLState().Filtered << " filtered, "
+				<< frameAllocations << " allocations ; " << VertexArena().Compactions + CompressedVertexArena().Compactions
+				<< " arena compactions" << std::endl;
+			lastCullReport = currentFrame;
 		}
         //ourModel.Draw(ourShader);
 
@@ -185,15 +283,29 @@ int main()
         glfwPollEvents();
     }
 
+    // GL objects owned by locals, while the context still exists
+    renderer.Release();
+    frameConstants.Release();
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
     return 0;
 }
 
+// the first model of either source, -1 when there is none ; scans the scene, so only on a key press
+int findRock(const std::vector<Model> &models, const unsigned int rockSources[2])
+{
+	for (size_t i = 0; i < models.size(); ++i) {
+		if (models[i].Source == rockSources[0] || models[i].Source == rockSources[1])
+			return (int)i;
+	}
+	return -1;
+}
+
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow *window, std::vector<Model> &models, unsigned short &index)
+void processInput(GLFWwindow *window, std::vector<Model> &models, unsigned short &index, AsyncModelLoader &loader)
 {
 	float r1 = static_cast <float> (rand()) / (static_cast <float> (RAND_MAX / 3.0f));
 	float r2 = static_cast <float> (rand()) / (static_cast <float> (RAND_MAX / 3.0f));
@@ -278,37 +390,59 @@ void processInput(GLFWwindow *window, std::vector<Model> &models, unsigned short
 		if (index > models.size() - 1)
 			index = 0;
 	}
+	// rocks are copies of a rock already in the scene, so the file is loaded once and they all draw instanced
+	static const string rockPath = FileSystem::getPath("resources/objects/rock/rock.obj");
+	static const unsigned int rockSources[2] = {Model::SourceId(rockPath, false), Model::SourceId(rockPath, true)};
 	if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) {
-		
-		Model newmodel(FileSystem::getPath("resources/objects/rock/rock.obj"),
-			glm::vec3(r1, r2, r3),
-			glm::vec3(0.2f)
-		);
-		models.push_back(newmodel);
+		int rock = findRock(models, rockSources);
+		if (rock >= 0)
+			models.push_back(Model(models[rock], glm::vec3(r1, r2, r3), glm::vec3(0.2f)));
+		else
+			loader.Load(rockPath,
+				glm::vec3(r1, r2, r3),
+				glm::vec3(0.2f),
+				true
+			);
+	}
+	/*   ASTEROID FIELD : a ring of ASTEROID_FIELD_SIZE rocks around the planet, once per key press   */
+	static bool fieldKeyDown = false;
+	if (glfwGetKey(window, GLFW_KEY_5) == GLFW_PRESS) {
+		int rock = fieldKeyDown ? -1 : findRock(models, rockSources);
+		if (rock >= 0) {
+			for (int i = 0; i < ASTEROID_FIELD_SIZE; ++i) {
+				float angle = 6.2831853f * rand() / RAND_MAX;
+				float distance = 15.0f + 10.0f * rand() / RAND_MAX;
+				glm::vec3 position(cosf(angle) * distance, 2.0f * rand() / RAND_MAX - 1.0f, sinf(angle) * distance);
+				models.push_back(Model(models[rock], position + glm::vec3(-2.0f, -1.75f, 0.0f), glm::vec3(0.05f + 0.15f * rand() / RAND_MAX)));
+			}
+		}
+		fieldKeyDown = true;
 	}
+	else
+		fieldKeyDown = false;
 	if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS) {
 
-		Model newmodel(FileSystem::getPath("resources/objects/nanosuit/nanosuit.obj"),
+		loader.Load(FileSystem::getPath("resources/objects/nanosuit/nanosuit.obj"),
 			glm::vec3(r1, r2, r3),
-			glm::vec3(r4)
+			glm::vec3(r4),
+			true
 		);
-		models.push_back(newmodel);
 	}
 	if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS) {
 
-		Model newmodel(FileSystem::getPath("resources/objects/cyborg/cyborg.obj"),
+		loader.Load(FileSystem::getPath("resources/objects/cyborg/cyborg.obj"),
 			glm::vec3(r1, r2, r3),
-			glm::vec3(r4)
+			glm::vec3(r4),
+			true
 		);
-		models.push_back(newmodel);
 	}
 	if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS) {
 
-		Model newmodel(FileSystem::getPath("resources/objects/planet/planet.obj"),
+		loader.Load(FileSystem::getPath("resources/objects/planet/planet.obj"),
 			glm::vec3(r1, r2,r3),
-			glm::vec3(r4)
+			glm::vec3(r4),
+			true
 		);
-		models.push_back(newmodel);
 	}
 	if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) {
 		++index;
@@ -0,0 +1,153 @@
+// Scene BVH (bvh.hpp) against a linear scan over the same boxes, from 1k to 1M instances scattered in a
+// cube. Times the SAH build, a refit after every instance moved a little, and the frustum, ray and sphere
+// queries, and checks that the BVH and the scan agree on every answer.
+// Usage : bvh_bench [maxInstances] [queries]
+// Build : compile with sources/bvh.cpp and sources/frustumcull.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <random>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <bvh.hpp>
+#include <frustumcull.hpp>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double seconds(Clock::time_point start){
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void scatter(std::vector<Aabb> & boxes, size_t count, float side, std::mt19937 & random){
+	std::uniform_real_distribution<float> position(-side, side);
+	std::uniform_real_distribution<float> size(0.5f, 2.0f);
+	boxes.resize(count);
+	for (size_t i = 0; i < count; i++){
+		glm::vec3 center(position(random), position(random), position(random));
+		glm::vec3 half(size(random), size(random), size(random));
+		boxes[i].min = center - half;
+		boxes[i].max = center + half;
+	}
+}
+
+// Same order for both sides before comparing
+static bool sameItems(std::vector<unsigned int> & a, std::vector<unsigned int> & b){
+	std::sort(a.begin(), a.end());
+	std::sort(b.begin(), b.end());
+	return a == b;
+}
+
+int main(int argc, char ** argv){
+	size_t maxCount = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+	int queries = argc > 2 ? atoi(argv[2]) : 100;
+
+	printf("times in ms ; frustum, ray and sphere are per query, bvh / linear scan\n\n");
+	printf("%9s %9s %8s %8s %17s %17s %17s %17s %8s\n", "instances", "nodes", "build", "refit", "frustum", "ray (all hits)", "ray (nearest)", "sphere", "matches");
+
+	int failed = 0;
+	for (size_t count = 1000; count <= maxCount; count *= 10){
+		std::mt19937 random(1234);
+		// a constant density : about the same number of neighbours whatever the count
+		float side = 10.0f * powf((float)count, 1.0f / 3.0f);
+		std::vector<Aabb> boxes;
+		scatter(boxes, count, side, random);
+
+		Bvh bvh;
+		Clock::time_point start = Clock::now();
+		bvh.build(boxes);
+		double build = seconds(start);
+
+		std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+		for (size_t i = 0; i < count; i++){
+			glm::vec3 move(jitter(random), jitter(random), jitter(random));
+			boxes[i].min += move;
+			boxes[i].max += move;
+		}
+		start = Clock::now();
+		bvh.refit(boxes);
+		double refit = seconds(start);
+
+		std::uniform_real_distribution<float> position(-side, side);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		double times[4][2] = {{0}};
+		bool matches = true;
+		std::vector<unsigned int> found, expected;
+		for (int q = 0; q < queries; q++){
+			glm::vec3 eye(position(random), position(random), position(random));
+			glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0, 0, 1e-3f));
+
+			// frustum : a camera inside the scene, looking a third of the way across
+			glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, side * 0.66f);
+			glm::mat4 view = glm::lookAt(eye, eye + direction, glm::abs(direction.y) > 0.99f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0));
+			glm::vec4 planes[6];
+			extractFrustumPlanes(projection * view, planes);
+			found.clear();
+			expected.clear();
+			start = Clock::now();
+			bvh.queryFrustum(planes, found);
+			times[0][0] += seconds(start);
+			start = Clock::now();
+			for (size_t i = 0; i < count; i++)
+				if (aabbInFrustum(boxes[i], planes))
+					expected.push_back((unsigned int)i);
+			times[0][1] += seconds(start);
+			matches = matches && sameItems(found, expected);
+
+			// rays : every box along the whole ray, then the nearest one (picking)
+			glm::vec3 inverseDirection = 1.0f / direction;
+			float maxDistance = side * 4.0f, entry;
+			found.clear();
+			expected.clear();
+			start = Clock::now();
+			bvh.queryRay(eye, direction, maxDistance, found);
+			times[1][0] += seconds(start);
+			start = Clock::now();
+			for (size_t i = 0; i < count; i++)
+				if (aabbHitByRay(boxes[i], eye, inverseDirection, maxDistance, entry))
+					expected.push_back((unsigned int)i);
+			times[1][1] += seconds(start);
+			matches = matches && sameItems(found, expected);
+
+			float distance = 0;
+			start = Clock::now();
+			int nearest = bvh.raycast(eye, direction, maxDistance, distance);
+			times[2][0] += seconds(start);
+			start = Clock::now();
+			int linearNearest = -1;
+			float linearDistance = maxDistance;
+			for (size_t i = 0; i < count; i++)
+				if (aabbHitByRay(boxes[i], eye, inverseDirection, linearDistance, entry) && (linearNearest < 0 || entry < linearDistance)){
+					linearNearest = (int)i;
+					linearDistance = entry;
+				}
+			times[2][1] += seconds(start);
+			matches = matches && nearest == linearNearest && (nearest < 0 || distance == linearDistance);
+
+			// proximity : everything within 20 units
+			found.clear();
+			expected.clear();
+			start = Clock::now();
+			bvh.querySphere(eye, 20.0f, found);
+			times[3][0] += seconds(start);
+			start = Clock::now();
+			for (size_t i = 0; i < count; i++)
+				if (aabbOverlapsSphere(boxes[i], eye, 20.0f))
+					expected.push_back((unsigned int)i);
+			times[3][1] += seconds(start);
+			matches = matches && sameItems(found, expected);
+		}
+		failed += matches ? 0 : 1;
+
+		char columns[4][32];
+		for (int k = 0; k < 4; k++)
+			snprintf(columns[k], sizeof(columns[k]), "%.4f / %.3f", times[k][0] * 1000 / queries, times[k][1] * 1000 / queries);
+		printf("%9u %9u %8.2f %8.2f %17s %17s %17s %17s %8s\n", (unsigned int)count, (unsigned int)bvh.nodeCount(), build * 1000, refit * 1000,
+			columns[0], columns[1], columns[2], columns[3], matches ? "yes" : "NO");
+	}
+	return failed ? 1 : 0;
+}
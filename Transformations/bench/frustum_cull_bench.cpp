@@ -0,0 +1,75 @@
+// Frustum culling of many instances with cullSpheres : one sphere per instance, scattered in a cube around a
+// camera with the projection of main.cpp. Times the scalar reference, the SIMD loop on one thread and the SIMD
+// loop split over the thread pool, and checks that all three agree on every instance.
+// Usage : frustum_cull_bench [instances] [runs]
+// Build : compile with sources/frustumcull.cpp and sources/threadpool.cpp ; add /arch:AVX (MSVC) or -mavx for the AVX path.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+#include <random>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <frustumcull.hpp>
+#include <threadpool.hpp>
+
+enum Path{SCALAR, SIMD, SIMD_THREADED};
+
+static CullStats run(Path path, const glm::vec4 planes[6], const SphereBounds & spheres, std::vector<unsigned char> & visible){
+	if (path == SCALAR){
+		visible.resize(spheres.size());
+		CullStats stats;
+		stats.visible = cullSpheresScalar(planes, spheres, 0, spheres.size(), visible.empty() ? NULL : &visible[0]);
+		stats.culled = (unsigned int)spheres.size() - stats.visible;
+		return stats;
+	}
+	return cullSpheres(planes, spheres, visible, path == SIMD_THREADED);
+}
+
+int main(int argc, char ** argv){
+	size_t count = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+	int runs = argc > 2 ? atoi(argv[2]) : 100;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 5.0f);
+	SphereBounds spheres;
+	spheres.resize(count);
+	for (size_t i = 0; i < count; i++){
+		float x = position(random), y = position(random), z = position(random);
+		spheres.set(i, glm::vec3(x, y, z), size(random));
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 1000.0f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 5), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+	glm::vec4 planes[6];
+	extractFrustumPlanes(projection * view, planes);
+
+	const char * names[] = {"scalar", "simd", "simd threaded"};
+#if defined(__AVX__)
+	const char * simd = "AVX, 8 spheres per register";
+#else
+	const char * simd = "SSE, 4 spheres per register";
+#endif
+	printf("%u instances, %d runs, %s, %u pool threads\n\n", (unsigned int)count, runs, simd, defaultThreadPool().size());
+	printf("%-15s %10s %10s %12s %14s %10s\n", "path", "visible", "culled", "ms/run", "Minstances/s", "matches");
+
+	std::vector<unsigned char> reference, visible;
+	run(SCALAR, planes, spheres, reference);
+	int failed = 0;
+	for (int path = SCALAR; path <= SIMD_THREADED; path++){
+		CullStats stats = run((Path)path, planes, spheres, visible); // warm up, and the result to check
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < runs; r++)
+			run((Path)path, planes, spheres, visible);
+		double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / runs;
+		bool matches = visible == reference;
+		failed += matches ? 0 : 1;
+		printf("%-15s %10u %10u %12.3f %14.1f %10s\n", names[path], stats.visible, stats.culled, elapsed * 1000.0,
+			count / elapsed / 1e6, matches ? "yes" : "NO");
+	}
+	return failed ? 1 : 0;
+}
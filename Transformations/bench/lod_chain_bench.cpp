@@ -0,0 +1,75 @@
+// LOD chains built by buildLodChain for every mesh in mesh/ and for a noisy UV sphere with a UV seam
+// (a stand-in for a scanned rock) : triangles and error of each level, and the build time.
+// Errors are relative to the bounding box diagonal.
+// Run from the Transformations folder. Usage : lod_chain_bench [sphereSegments]
+// Build : compile with sources/meshsimplify.cpp, sources/meshoptimize.cpp, sources/objloader.cpp, sources/vboindexer.cpp,
+// sources/mappedfile.cpp and sources/threadpool.cpp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <objloader.hpp>
+#include <meshoptimize.hpp>
+#include <meshsimplify.hpp>
+
+static const char * meshes[] = {"mesh/cube.obj", "mesh/esfera.obj", "mesh/suzanne.obj", "mesh/g1.obj", "mesh/g2.obj", "mesh/g4.obj", "mesh/g5.obj"};
+
+// UV sphere with a bumpy radius ; the column at u = 1 duplicates u = 0, as an OBJ export would
+static void makeRock(int segments, std::vector<unsigned int> & indices, std::vector<glm::vec3> & positions){
+	int rings = segments / 2;
+	for (int r = 0; r <= rings; r++){
+		for (int s = 0; s <= segments; s++){
+			float theta = 3.14159265f * r / rings, phi = 6.2831853f * (s % segments) / segments;
+			glm::vec3 direction(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+			float bump = 1.0f + 0.08f * sinf(5 * direction.x + 3 * direction.y) * cosf(4 * direction.z) + 0.02f * sinf(23 * direction.x * direction.y);
+			positions.push_back(direction * bump);
+		}
+	}
+	for (int r = 0; r < rings; r++){
+		for (int s = 0; s < segments; s++){
+			unsigned int a = r * (segments + 1) + s, b = a + 1, c = a + segments + 1, d = c + 1;
+			if (r > 0){ indices.push_back(a); indices.push_back(b); indices.push_back(c); }
+			if (r < rings - 1){ indices.push_back(b); indices.push_back(d); indices.push_back(c); }
+		}
+	}
+}
+
+static void report(const char * name, std::vector<unsigned int> & indices, std::vector<glm::vec3> & positions){
+	std::vector<MeshLod> lods;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	buildLodChain(indices, &positions[0], positions.size(), defaultLodSettings(), lods);
+	double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	printf("%-20s %10.3f ms :", name, elapsed * 1000.0);
+	for (size_t i = 0; i < lods.size(); i++)
+		printf("  %u tris (%.4f)", lods[i].indexCount / 3, lods[i].error);
+	printf("\n");
+}
+
+int main(int argc, char ** argv){
+	int segments = argc > 1 ? atoi(argv[1]) : 256;
+
+	for (size_t m = 0; m < sizeof(meshes) / sizeof(meshes[0]); m++){
+		std::vector<unsigned int> indices;
+		std::vector<glm::vec3> positions, normals;
+		std::vector<glm::vec2> uvs;
+		if (!loadOBJ_indexed(meshes[m], indices, positions, uvs, normals) || positions.empty()){
+			printf("%-20s could not be loaded\n", meshes[m]);
+			continue;
+		}
+		optimizeVertexCache(indices, positions.size());
+		optimizeVertexFetch(indices, positions, uvs, normals);
+		report(meshes[m], indices, positions);
+	}
+
+	std::vector<unsigned int> indices;
+	std::vector<glm::vec3> positions;
+	makeRock(segments, indices, positions);
+	report("rock (synthetic)", indices, positions);
+	return 0;
+}
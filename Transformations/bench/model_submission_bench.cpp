@@ -0,0 +1,166 @@
+// CPU submission cost of drawing thousands of Model instances, with the GL calls issued per frame :
+//  respecified : SEPARATE models drawn the old way, three attribute pointers enabled, set and disabled per draw
+//  separate    : SEPARATE models (three VBOs) through their VAO
+//  interleaved : INTERLEAVED models (one VBO) through their VAO
+//  quantized   : QUANTIZED models (one VBO of 16-byte vertices) through their VAO
+// Opens a hidden GLFW window ; the timed part is only the CPU side of the draw loop, glFinish is timed apart.
+// Run from the Transformations folder. Usage : model_submission_bench [models] [frames]
+// Build : compile with sources/Model.cpp, sources/meshregistry.cpp, sources/meshcache.cpp, sources/meshoptimize.cpp, sources/meshsimplify.cpp, sources/frustumcull.cpp, sources/objloader.cpp, sources/vboindexer.cpp,
+// sources/mappedfile.cpp, sources/threadpool.cpp, sources/shader.cpp, sources/programcache.cpp, sources/frameconstants.cpp, sources/glstate.cpp and sources/glerror.cpp, link GLEW and GLFW.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#include <GL/glew.h>
+#include <glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Model.hpp"
+#include "frameconstants.hpp"
+
+static char * meshes[] = {"mesh/cube.obj", "mesh/suzanne.obj", "mesh/g5.obj"};
+
+struct FrameTime{
+	double submit; // seconds spent issuing GL calls
+	double finish; // seconds spent in glFinish afterwards
+};
+
+// What draw() in main.cpp did before every Model recorded its attribute setup in a VAO
+static void drawRespecified(const Model & model){
+	const GpuMesh & mesh = *model.mesh;
+	counted_gl_call(glBindVertexArray(mesh.vertexArray));
+	counted_gl_call(glEnableVertexAttribArray(0));
+	counted_gl_call(glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexbuffer));
+	counted_gl_call(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+	counted_gl_call(glEnableVertexAttribArray(1));
+	counted_gl_call(glBindBuffer(GL_ARRAY_BUFFER, mesh.uvbuffer));
+	counted_gl_call(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0));
+	counted_gl_call(glEnableVertexAttribArray(2));
+	counted_gl_call(glBindBuffer(GL_ARRAY_BUFFER, mesh.normalbuffer));
+	counted_gl_call(glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0));
+	counted_gl_call(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.elementbuffer));
+	counted_gl_call(glDrawElements(GL_TRIANGLES, mesh.indexCount, mesh.indexType, (void*)0));
+	counted_gl_call(glDisableVertexAttribArray(0));
+	counted_gl_call(glDisableVertexAttribArray(1));
+	counted_gl_call(glDisableVertexAttribArray(2));
+}
+
+// Uniform locations of StandardShading
+struct Uniforms{
+	GLuint ModelMatrixID;
+	GLuint PositionScaleID;
+	GLuint PositionOffsetID;
+};
+
+static FrameTime drawFrame(std::vector<Model> & models, bool respecify, const Uniforms & uniforms){
+	FrameConstants frame = {};
+	frame.view = glm::lookAt(glm::vec3(0, 0, 120), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+	frame.projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 500.0f);
+	frame.viewProjection = frame.projection * frame.view;
+	frame.viewPos = glm::vec3(0, 0, 120);
+	frame.lightCount = 1;
+	frame.lights[0].position = glm::vec4(4, 4, 4, 1);
+
+	FrameTime t;
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// drawRespecified binds behind the back of glstate.hpp, which drawGeometry goes through
+	glStateInvalidate();
+	g_glCallCount = 0;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	// the camera goes up once per frame ; each model only sends its own uniforms
+	uploadFrameConstants(frame);
+	for (size_t i = 0; i < models.size(); i++){
+		const GpuMesh & mesh = *models[i].mesh;
+		counted_gl_call(glUniformMatrix4fv(uniforms.ModelMatrixID, 1, GL_FALSE, &models[i].modelMatrix[0][0]));
+		counted_gl_call(glUniform3f(uniforms.PositionScaleID, mesh.positionScale.x, mesh.positionScale.y, mesh.positionScale.z));
+		counted_gl_call(glUniform3f(uniforms.PositionOffsetID, mesh.positionOffset.x, mesh.positionOffset.y, mesh.positionOffset.z));
+		if (respecify)
+			drawRespecified(models[i]);
+		else
+			models[i].drawGeometry();
+	}
+	std::chrono::high_resolution_clock::time_point submitted = std::chrono::high_resolution_clock::now();
+	glFinish();
+	std::chrono::high_resolution_clock::time_point finished = std::chrono::high_resolution_clock::now();
+	t.submit = std::chrono::duration<double>(submitted - start).count();
+	t.finish = std::chrono::duration<double>(finished - submitted).count();
+	return t;
+}
+
+static void benchmark(const char * name, GpuMesh::Layout layout, bool respecify, int count, int frames, const Uniforms & uniforms){
+	// Only the first model of each mesh loads and uploads it, the others share it through the registry
+	std::vector<Model> models;
+	models.reserve(count);
+	std::chrono::high_resolution_clock::time_point spawnStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < count; i++){
+		glm::vec3 pos((float)(i % 100) - 50.0f, (float)((i / 100) % 50) - 25.0f, -(float)(i / 5000) * 4.0f);
+		models.push_back(Model(meshes[i % 3], pos, layout));
+	}
+	double spawn = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - spawnStart).count();
+
+	drawFrame(models, respecify, uniforms); // warm up the driver
+	double bestSubmit = 1e30, totalSubmit = 0, totalFinish = 0;
+	for (int f = 0; f < frames; f++){
+		FrameTime t = drawFrame(models, respecify, uniforms);
+		if (t.submit < bestSubmit) bestSubmit = t.submit;
+		totalSubmit += t.submit;
+		totalFinish += t.finish;
+	}
+	printf("%-12s %7d %12.3f %12u %12.3f %12.3f %12.1f %12.3f\n", name, count, spawn * 1000.0, g_glCallCount,
+		bestSubmit * 1000.0, totalSubmit / frames * 1000.0, bestSubmit / count * 1e9, totalFinish / frames * 1000.0);
+}
+
+int main(int argc, char ** argv){
+	int count = argc > 1 ? atoi(argv[1]) : 5000;
+	int frames = argc > 2 ? atoi(argv[2]) : 100;
+
+	if (!glfwInit()){
+		fprintf(stderr, "Failed to initialize GLFW\n");
+		return -1;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	GLFWwindow * window = glfwCreateWindow(1024, 768, "model_submission_bench", NULL, NULL);
+	if (window == NULL){
+		fprintf(stderr, "Failed to open GLFW window\n");
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+	glewExperimental = true;
+	if (glewInit() != GLEW_OK){
+		fprintf(stderr, "Failed to initialize GLEW\n");
+		return -1;
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glEnable(GL_CULL_FACE);
+
+	GLuint programID = LoadShaders("shaders/StandardShading.vertexshader", "shaders/StandardShading.fragmentshader");
+	glUseProgram(programID);
+	initFrameConstants();
+	bindFrameConstantsBlock(programID);
+	Uniforms uniforms;
+	uniforms.ModelMatrixID = glGetUniformLocation(programID, "M");
+	uniforms.PositionScaleID = glGetUniformLocation(programID, "PositionScale");
+	uniforms.PositionOffsetID = glGetUniformLocation(programID, "PositionOffset");
+
+	printf("%-12s %7s %12s %12s %12s %12s %12s %12s\n", "path", "models", "spawn ms", "calls/frame", "best ms", "mean ms", "ns/model", "finish ms");
+	benchmark("respecified", GpuMesh::SEPARATE, true, count, frames, uniforms);
+	benchmark("separate", GpuMesh::SEPARATE, false, count, frames, uniforms);
+	benchmark("interleaved", GpuMesh::INTERLEAVED, false, count, frames, uniforms);
+	benchmark("quantized", GpuMesh::QUANTIZED, false, count, frames, uniforms);
+
+	glDeleteProgram(programID);
+	cleanupFrameConstants();
+	glfwTerminate();
+	return 0;
+}
@@ -0,0 +1,79 @@
+// OBJ loading throughput : loadOBJ (fscanf) against loadOBJ_mmap (mapped, in-place tokenizer).
+// Run from the Transformations folder so that "mesh/..." resolves, like the main program.
+// Build : compile with sources/objloader.cpp and sources/mappedfile.cpp.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <objloader.hpp>
+
+static double fileSizeMB(const char * path){
+	FILE * file = fopen(path, "rb");
+	if (file == NULL) return 0.0;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fclose(file);
+	return size / (1024.0 * 1024.0);
+}
+
+typedef bool (*ObjLoader)(const char *, std::vector<glm::vec3> &, std::vector<glm::vec2> &, std::vector<glm::vec3> &);
+
+// Returns the best time of "runs" loads, in seconds.
+static double timeLoader(ObjLoader loader, const char * path, int runs, size_t & out_corners){
+	double best = 1e30;
+	for (int run = 0; run < runs; run++){
+		std::vector<glm::vec3> vertices, normals;
+		std::vector<glm::vec2> uvs;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		bool res = loader(path, vertices, uvs, normals);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (!res) return -1.0;
+		out_corners = vertices.size();
+		if (elapsed.count() < best) best = elapsed.count();
+	}
+	return best;
+}
+
+static bool sameOutput(const char * path){
+	std::vector<glm::vec3> v1, n1, v2, n2;
+	std::vector<glm::vec2> uv1, uv2;
+	if (!loadOBJ(path, v1, uv1, n1)) return true; // Nothing to compare against
+	loadOBJ_mmap(path, v2, uv2, n2);
+	return v1.size() == v2.size() && uv1.size() == uv2.size() && n1.size() == n2.size() &&
+		memcmp(&v1[0], &v2[0], v1.size() * sizeof(glm::vec3)) == 0 &&
+		memcmp(&uv1[0], &uv2[0], uv1.size() * sizeof(glm::vec2)) == 0 &&
+		memcmp(&n1[0], &n2[0], n1.size() * sizeof(glm::vec3)) == 0;
+}
+
+int main(int argc, char ** argv){
+	const char * defaults[] = {"mesh/suzanne.obj", "mesh/g5.obj"};
+	const char ** paths = argc > 1 ? (const char **)argv + 1 : defaults;
+	int count = argc > 1 ? argc - 1 : 2;
+	const int runs = 20;
+
+	printf("%-24s %-12s %10s %10s %14s\n", "mesh", "loader", "ms", "MB/s", "triangles/s");
+	for (int i = 0; i < count; i++){
+		double mb = fileSizeMB(paths[i]);
+		size_t corners = 0;
+
+		double slow = timeLoader(loadOBJ, paths[i], runs, corners);
+		if (slow < 0.0)
+			printf("%-24s %-12s %10s\n", paths[i], "loadOBJ", "failed");
+		else
+			printf("%-24s %-12s %10.3f %10.1f %14.0f\n", paths[i], "loadOBJ", slow * 1000.0, mb / slow, (corners / 3) / slow);
+
+		double fast = timeLoader(loadOBJ_mmap, paths[i], runs, corners);
+		if (fast < 0.0)
+			printf("%-24s %-12s %10s\n", paths[i], "loadOBJ_mmap", "failed");
+		else
+			printf("%-24s %-12s %10.3f %10.1f %14.0f\n", paths[i], "loadOBJ_mmap", fast * 1000.0, mb / fast, (corners / 3) / fast);
+
+		if (!sameOutput(paths[i]))
+			printf("%-24s OUTPUT MISMATCH between loadOBJ and loadOBJ_mmap\n", paths[i]);
+	}
+	return 0;
+}
@@ -0,0 +1,106 @@
+// loadOBJ_mmap + indexVBO against the single-pass loadOBJ_indexed : time and peak heap usage.
+// Run from the Transformations folder. Usage : objloader_indexed_bench [mesh.obj ...]
+// Build : compile with sources/objloader.cpp, sources/vboindexer.cpp, sources/mappedfile.cpp and sources/threadpool.cpp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+#include <new>
+
+#include <glm/glm.hpp>
+
+#include <objloader.hpp>
+#include <vboindexer.hpp>
+
+// Heap accounting : every allocation is prefixed with its size
+static size_t currentBytes = 0, peakBytes = 0;
+
+void * operator new(size_t size){
+	size_t * block = (size_t *)malloc(size + sizeof(size_t));
+	if (block == NULL) throw std::bad_alloc();
+	*block = size;
+	currentBytes += size;
+	if (currentBytes > peakBytes) peakBytes = currentBytes;
+	return block + 1;
+}
+
+void operator delete(void * p) noexcept{
+	if (p == NULL) return;
+	size_t * block = (size_t *)p - 1;
+	currentBytes -= *block;
+	free(block);
+}
+
+struct Result{
+	double seconds;
+	size_t peak;
+	size_t vertices, indices;
+	bool ok;
+};
+
+static Result twoPass(const char * path){
+	Result r;
+	size_t before = currentBytes;
+	peakBytes = currentBytes;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	{
+		std::vector<glm::vec3> vertices, normals;
+		std::vector<glm::vec2> uvs;
+		std::vector<unsigned short> indices;
+		std::vector<glm::vec3> indexed_vertices, indexed_normals;
+		std::vector<glm::vec2> indexed_uvs;
+		r.ok = loadOBJ_mmap(path, vertices, uvs, normals) &&
+			indexVBO(vertices, uvs, normals, indices, indexed_vertices, indexed_uvs, indexed_normals);
+		r.vertices = indexed_vertices.size();
+		r.indices = indices.size();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	r.seconds = elapsed.count();
+	r.peak = peakBytes - before;
+	return r;
+}
+
+static Result onePass(const char * path){
+	Result r;
+	size_t before = currentBytes;
+	peakBytes = currentBytes;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	{
+		std::vector<unsigned int> indices;
+		std::vector<glm::vec3> indexed_vertices, indexed_normals;
+		std::vector<glm::vec2> indexed_uvs;
+		r.ok = loadOBJ_indexed(path, indices, indexed_vertices, indexed_uvs, indexed_normals);
+		r.vertices = indexed_vertices.size();
+		r.indices = indices.size();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	r.seconds = elapsed.count();
+	r.peak = peakBytes - before;
+	return r;
+}
+
+static void report(const char * path, const char * name, Result (*run)(const char *)){
+	Result best = run(path);
+	for (int i = 0; i < 9; i++){
+		Result r = run(path);
+		if (r.seconds < best.seconds) best = r;
+	}
+	if (!best.ok)
+		printf("%-20s %-16s failed\n", path, name);
+	else
+		printf("%-20s %-16s %9.3f %12.1f %9u %9u\n", path, name, best.seconds * 1000.0, best.peak / 1024.0, (unsigned int)best.vertices, (unsigned int)best.indices);
+}
+
+int main(int argc, char ** argv){
+	const char * defaults[] = {"mesh/cube.obj", "mesh/suzanne.obj", "mesh/g4.obj", "mesh/g5.obj"};
+	const char ** paths = argc > 1 ? (const char **)argv + 1 : defaults;
+	int count = argc > 1 ? argc - 1 : 4;
+
+	printf("%-20s %-16s %9s %12s %9s %9s\n", "mesh", "path", "ms", "peak KB", "vertices", "indices");
+	for (int i = 0; i < count; i++){
+		report(paths[i], "mmap+indexVBO", twoPass);
+		report(paths[i], "loadOBJ_indexed", onePass);
+	}
+	return 0;
+}
@@ -0,0 +1,110 @@
+// Thread scaling of loadOBJ_parallel over a synthetic multi-million triangle OBJ.
+// The file is built from copies of the mesh/g5.obj icosphere laid on a grid, with
+// per-vertex UVs and normals so that "v", "vt", "vn" and "f a/b/c" are all exercised.
+// Run from the Transformations folder. Usage : objloader_scaling_bench [copies] [maxThreads]
+// Build : compile with sources/objloader.cpp, sources/mappedfile.cpp and sources/threadpool.cpp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include <glm/glm.hpp>
+
+#include <objloader.hpp>
+
+static const char * syntheticPath = "synthetic_icospheres.obj";
+
+// Writes "copies" icospheres to syntheticPath and returns the triangle count (0 on failure)
+static size_t writeSyntheticOBJ(const char * icospherePath, int copies){
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> faces;
+
+	FILE * in = fopen(icospherePath, "r");
+	if (in == NULL){
+		printf("Impossible to open %s\n", icospherePath);
+		return 0;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), in)){
+		glm::vec3 v;
+		unsigned int a, b, c;
+		if (sscanf(line, "v %f %f %f", &v.x, &v.y, &v.z) == 3)
+			positions.push_back(v);
+		else if (sscanf(line, "f %u %u %u", &a, &b, &c) == 3){
+			faces.push_back(a); faces.push_back(b); faces.push_back(c);
+		}
+	}
+	fclose(in);
+
+	FILE * out = fopen(syntheticPath, "w");
+	if (out == NULL)
+		return 0;
+	fprintf(out, "# %d copies of %s\n", copies, icospherePath);
+	int side = (int)ceil(sqrt((double)copies));
+	for (int copy = 0; copy < copies; copy++){
+		glm::vec3 offset(3.0f * (copy % side), 0.0f, 3.0f * (copy / side));
+		fprintf(out, "o sphere_%d\n", copy);
+		for (size_t i = 0; i < positions.size(); i++){
+			glm::vec3 p = positions[i];
+			fprintf(out, "v %f %f %f\n", p.x + offset.x, p.y + offset.y, p.z + offset.z);
+			fprintf(out, "vt %f %f\n", 0.5f + atan2f(p.z, p.x) / 6.2831853f, 0.5f - asinf(p.y) / 3.1415926f);
+			fprintf(out, "vn %f %f %f\n", p.x, p.y, p.z);
+		}
+		unsigned int base = (unsigned int)(copy * positions.size());
+		for (size_t i = 0; i < faces.size(); i += 3){
+			unsigned int a = faces[i] + base, b = faces[i + 1] + base, c = faces[i + 2] + base;
+			fprintf(out, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+		}
+	}
+	fclose(out);
+	return copies * faces.size() / 3;
+}
+
+int main(int argc, char ** argv){
+	int copies = argc > 1 ? atoi(argv[1]) : 400; // 400 * 5120 = ~2M triangles
+	unsigned int maxThreads = argc > 2 ? (unsigned int)atoi(argv[2]) : std::thread::hardware_concurrency();
+	if (maxThreads == 0) maxThreads = 1;
+
+	size_t triangles = writeSyntheticOBJ("mesh/g5.obj", copies);
+	if (triangles == 0)
+		return 1;
+	FILE * file = fopen(syntheticPath, "rb");
+	fseek(file, 0, SEEK_END);
+	double mb = ftell(file) / (1024.0 * 1024.0);
+	fclose(file);
+	printf("%s : %.1f MB, %u triangles\n", syntheticPath, mb, (unsigned int)triangles);
+
+	std::vector<glm::vec3> referenceVertices, referenceNormals;
+	std::vector<glm::vec2> referenceUVs;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	loadOBJ_mmap(syntheticPath, referenceVertices, referenceUVs, referenceNormals);
+	std::chrono::duration<double> sequential = std::chrono::high_resolution_clock::now() - start;
+	printf("%-8s %10s %10s %14s %8s\n", "threads", "ms", "MB/s", "triangles/s", "speedup");
+	printf("%-8s %10.1f %10.1f %14.0f %8s\n", "mmap", sequential.count() * 1000.0, mb / sequential.count(), triangles / sequential.count(), "1.00");
+
+	for (unsigned int threads = 1; threads <= maxThreads; threads = threads < 4 ? threads + 1 : threads * 2){
+		double best = 1e30;
+		bool same = true;
+		for (int run = 0; run < 3; run++){
+			std::vector<glm::vec3> vertices, normals;
+			std::vector<glm::vec2> uvs;
+			start = std::chrono::high_resolution_clock::now();
+			loadOBJ_parallel(syntheticPath, vertices, uvs, normals, threads);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			if (elapsed.count() < best) best = elapsed.count();
+			same = same && vertices.size() == referenceVertices.size() &&
+				memcmp(&vertices[0], &referenceVertices[0], vertices.size() * sizeof(glm::vec3)) == 0 &&
+				memcmp(&uvs[0], &referenceUVs[0], uvs.size() * sizeof(glm::vec2)) == 0 &&
+				memcmp(&normals[0], &referenceNormals[0], normals.size() * sizeof(glm::vec3)) == 0;
+		}
+		printf("%-8u %10.1f %10.1f %14.0f %8.2f%s\n", threads, best * 1000.0, mb / best, triangles / best,
+			sequential.count() / best, same ? "" : "  OUTPUT MISMATCH");
+	}
+
+	remove(syntheticPath);
+	return 0;
+}
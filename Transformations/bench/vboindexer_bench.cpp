@@ -0,0 +1,97 @@
+// Vertex welding : indexVBO (open-addressing VertexHashTable) against indexVBO_map (std::map)
+// and indexVBO_slow (linear search), on every mesh in mesh/ plus synthetic grids of 1M+ vertices.
+// indexVBO_slow is quadratic and is skipped above 60k corners.
+// Run from the Transformations folder. Usage : vboindexer_bench [gridSide]
+// Build : compile with sources/vboindexer.cpp, sources/objloader.cpp, sources/mappedfile.cpp and sources/threadpool.cpp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <objloader.hpp>
+#include <vboindexer.hpp>
+
+typedef bool (*Indexer)(
+	std::vector<glm::vec3> &, std::vector<glm::vec2> &, std::vector<glm::vec3> &,
+	std::vector<unsigned short> &, std::vector<glm::vec3> &, std::vector<glm::vec2> &, std::vector<glm::vec3> &);
+
+struct Indexed{
+	std::vector<unsigned short> indices;
+	std::vector<glm::vec3> vertices, normals;
+	std::vector<glm::vec2> uvs;
+};
+
+static double timeIndexer(Indexer indexer, std::vector<glm::vec3> & vertices, std::vector<glm::vec2> & uvs, std::vector<glm::vec3> & normals, Indexed & out, int runs){
+	double best = 1e30;
+	for (int run = 0; run < runs; run++){
+		out = Indexed();
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		indexer(vertices, uvs, normals, out.indices, out.vertices, out.uvs, out.normals);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (elapsed.count() < best) best = elapsed.count();
+	}
+	return best;
+}
+
+static void benchmark(const char * name, std::vector<glm::vec3> & vertices, std::vector<glm::vec2> & uvs, std::vector<glm::vec3> & normals){
+	int runs = vertices.size() > 1000000 ? 1 : 10;
+	Indexed hashed, mapped, slow;
+	double hashTime = timeIndexer(indexVBO, vertices, uvs, normals, hashed, runs);
+	double mapTime = timeIndexer(indexVBO_map, vertices, uvs, normals, mapped, runs);
+	bool same = hashed.indices == mapped.indices && hashed.vertices.size() == mapped.vertices.size();
+
+	char slowText[32] = "skipped";
+	if (vertices.size() <= 60000){
+		double slowTime = timeIndexer(indexVBO_slow, vertices, uvs, normals, slow, 1);
+		sprintf(slowText, "%.3f", slowTime * 1000.0);
+	}
+
+	printf("%-22s %9u %9u %11.3f %11.3f %11s %8.2fx%s\n", name, (unsigned int)vertices.size(), (unsigned int)hashed.vertices.size(),
+		hashTime * 1000.0, mapTime * 1000.0, slowText, mapTime / hashTime, same ? "" : "  OUTPUT MISMATCH");
+}
+
+// side x side quads, every grid point a distinct vertex : (side+1)^2 unique vertices, 6*side^2 corners
+static void makeGrid(int side, std::vector<glm::vec3> & vertices, std::vector<glm::vec2> & uvs, std::vector<glm::vec3> & normals){
+	vertices.clear(); uvs.clear(); normals.clear();
+	const int corners[6][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}};
+	for (int y = 0; y < side; y++){
+		for (int x = 0; x < side; x++){
+			for (int c = 0; c < 6; c++){
+				float u = (float)(x + corners[c][0]) / side, v = (float)(y + corners[c][1]) / side;
+				vertices.push_back(glm::vec3(u * 10.0f, 0.0f, v * 10.0f));
+				uvs.push_back(glm::vec2(u, v));
+				normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+			}
+		}
+	}
+}
+
+int main(int argc, char ** argv){
+	const char * meshes[] = {"mesh/cube.obj", "mesh/esfera.obj", "mesh/g1.obj", "mesh/g2.obj", "mesh/g4.obj", "mesh/g5.obj", "mesh/suzanne.obj"};
+
+	printf("%-22s %9s %9s %11s %11s %11s %9s\n", "mesh", "corners", "unique", "hash ms", "map ms", "slow ms", "speedup");
+	for (size_t i = 0; i < sizeof(meshes) / sizeof(meshes[0]); i++){
+		std::vector<glm::vec3> vertices, normals;
+		std::vector<glm::vec2> uvs;
+		if (!loadOBJ_mmap(meshes[i], vertices, uvs, normals))
+			continue;
+		benchmark(meshes[i], vertices, uvs, normals);
+	}
+
+	// Index values wrap above 65535 vertices (16-bit indices) ; only the welding cost matters here
+	int largest = argc > 1 ? atoi(argv[1]) : 1000;
+	int sides[] = {100, 300, largest};
+	for (int i = 0; i < 3; i++){
+		std::vector<glm::vec3> vertices, normals;
+		std::vector<glm::vec2> uvs;
+		makeGrid(sides[i], vertices, uvs, normals);
+		char name[64];
+		sprintf(name, "grid %dx%d", sides[i], sides[i]);
+		benchmark(name, vertices, uvs, normals);
+	}
+	return 0;
+}
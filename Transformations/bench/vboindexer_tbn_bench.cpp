@@ -0,0 +1,94 @@
+// indexVBO_TBN (spatial hash grid) against indexVBO_TBN_slow (quadratic search) : time and identical output.
+// Meshes from mesh/ plus grids of growing size, to show the linear scaling.
+// indexVBO_TBN_slow is skipped above 60k corners.
+// Run from the Transformations folder. Usage : vboindexer_tbn_bench [largestGridSide]
+// Build : compile with sources/vboindexer.cpp, sources/tangentspace.cpp, sources/objloader.cpp, sources/mappedfile.cpp and sources/threadpool.cpp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <objloader.hpp>
+#include <vboindexer.hpp>
+#include <tangentspace.hpp>
+
+typedef bool (*TBNIndexer)(
+	std::vector<glm::vec3> &, std::vector<glm::vec2> &, std::vector<glm::vec3> &, std::vector<glm::vec3> &, std::vector<glm::vec3> &,
+	std::vector<unsigned short> &, std::vector<glm::vec3> &, std::vector<glm::vec2> &, std::vector<glm::vec3> &, std::vector<glm::vec3> &, std::vector<glm::vec3> &);
+
+struct IndexedTBN{
+	std::vector<unsigned short> indices;
+	std::vector<glm::vec3> vertices, normals, tangents, bitangents;
+	std::vector<glm::vec2> uvs;
+};
+
+static double run(TBNIndexer indexer, std::vector<glm::vec3> & vertices, std::vector<glm::vec2> & uvs, std::vector<glm::vec3> & normals,
+	std::vector<glm::vec3> & tangents, std::vector<glm::vec3> & bitangents, IndexedTBN & out){
+	out = IndexedTBN();
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	indexer(vertices, uvs, normals, tangents, bitangents, out.indices, out.vertices, out.uvs, out.normals, out.tangents, out.bitangents);
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count();
+}
+
+static void benchmark(const char * name, std::vector<glm::vec3> & vertices, std::vector<glm::vec2> & uvs, std::vector<glm::vec3> & normals){
+	std::vector<glm::vec3> tangents, bitangents;
+	computeTangentBasis(vertices, uvs, normals, tangents, bitangents);
+
+	IndexedTBN grid, slow;
+	double gridTime = run(indexVBO_TBN, vertices, uvs, normals, tangents, bitangents, grid);
+	if (vertices.size() > 60000){
+		printf("%-22s %9u %9u %11.3f %11s %12.1f\n", name, (unsigned int)vertices.size(), (unsigned int)grid.vertices.size(),
+			gridTime * 1000.0, "skipped", gridTime * 1e9 / vertices.size());
+		return;
+	}
+	double slowTime = run(indexVBO_TBN_slow, vertices, uvs, normals, tangents, bitangents, slow);
+	bool same = grid.indices == slow.indices && grid.tangents.size() == slow.tangents.size() &&
+		memcmp(&grid.tangents[0], &slow.tangents[0], grid.tangents.size() * sizeof(glm::vec3)) == 0 &&
+		memcmp(&grid.bitangents[0], &slow.bitangents[0], grid.bitangents.size() * sizeof(glm::vec3)) == 0;
+	printf("%-22s %9u %9u %11.3f %11.3f %12.1f%s\n", name, (unsigned int)vertices.size(), (unsigned int)grid.vertices.size(),
+		gridTime * 1000.0, slowTime * 1000.0, gridTime * 1e9 / vertices.size(), same ? "" : "  OUTPUT MISMATCH");
+}
+
+// side x side quads over a 10x10 square : grid points are 10/side apart
+static void makeGrid(int side, std::vector<glm::vec3> & vertices, std::vector<glm::vec2> & uvs, std::vector<glm::vec3> & normals){
+	const int corners[6][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}};
+	for (int y = 0; y < side; y++){
+		for (int x = 0; x < side; x++){
+			for (int c = 0; c < 6; c++){
+				float u = (float)(x + corners[c][0]) / side, v = (float)(y + corners[c][1]) / side;
+				vertices.push_back(glm::vec3(u * 10.0f, 0.0f, v * 10.0f));
+				uvs.push_back(glm::vec2(u, v));
+				normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f));
+			}
+		}
+	}
+}
+
+int main(int argc, char ** argv){
+	const char * meshes[] = {"mesh/cube.obj", "mesh/esfera.obj", "mesh/g4.obj", "mesh/g5.obj", "mesh/suzanne.obj"};
+
+	printf("%-22s %9s %9s %11s %11s %12s\n", "mesh", "corners", "unique", "grid ms", "slow ms", "ns/corner");
+	for (size_t i = 0; i < sizeof(meshes) / sizeof(meshes[0]); i++){
+		std::vector<glm::vec3> vertices, normals;
+		std::vector<glm::vec2> uvs;
+		if (loadOBJ_mmap(meshes[i], vertices, uvs, normals))
+			benchmark(meshes[i], vertices, uvs, normals);
+	}
+
+	// Index values wrap above 65535 vertices (16-bit indices) ; only the search cost matters here
+	int largest = argc > 1 ? atoi(argv[1]) : 400;
+	for (int side = 25; side <= largest; side *= 2){
+		std::vector<glm::vec3> vertices, normals;
+		std::vector<glm::vec2> uvs;
+		makeGrid(side, vertices, uvs, normals);
+		char name[64];
+		sprintf(name, "grid %dx%d", side, side);
+		benchmark(name, vertices, uvs, normals);
+	}
+	return 0;
+}
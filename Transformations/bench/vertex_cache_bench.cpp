@@ -0,0 +1,47 @@
+// Post-transform vertex cache efficiency of every mesh in mesh/, in OBJ face order and after
+// optimizeVertexCache + optimizeVertexFetch, with a FIFO cache of 16 and VERTEX_CACHE_SIZE entries.
+// ACMR : vertex shader runs per triangle (lower is better, 0.5 is ideal for a regular grid).
+// ATVR : vertex shader runs per vertex (lower is better, 1 is ideal).
+// Run from the Transformations folder. Usage : vertex_cache_bench
+// Build : compile with sources/meshoptimize.cpp, sources/objloader.cpp, sources/vboindexer.cpp, sources/mappedfile.cpp and sources/threadpool.cpp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <objloader.hpp>
+#include <meshoptimize.hpp>
+
+static const char * meshes[] = {"mesh/cube.obj", "mesh/esfera.obj", "mesh/suzanne.obj", "mesh/g1.obj", "mesh/g2.obj", "mesh/g4.obj", "mesh/g5.obj"};
+
+static void report(const char * name, const char * order, const std::vector<unsigned int> & indices, size_t vertexCount, double ms){
+	VertexCacheStats small = analyzeVertexCache(indices, vertexCount, 16);
+	VertexCacheStats large = analyzeVertexCache(indices, vertexCount, VERTEX_CACHE_SIZE);
+	printf("%-20s %-10s %9u %9u %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, order, (unsigned int)vertexCount, (unsigned int)(indices.size() / 3),
+		small.acmr, small.atvr, large.acmr, large.atvr, ms);
+}
+
+int main(){
+	printf("%-20s %-10s %9s %9s %10s %10s %10s %10s %10s\n", "mesh", "order", "vertices", "triangles",
+		"ACMR 16", "ATVR 16", "ACMR 32", "ATVR 32", "ms");
+	for (size_t m = 0; m < sizeof(meshes) / sizeof(meshes[0]); m++){
+		std::vector<unsigned int> indices;
+		std::vector<glm::vec3> positions, normals;
+		std::vector<glm::vec2> uvs;
+		if (!loadOBJ_indexed(meshes[m], indices, positions, uvs, normals)){
+			printf("%-20s could not be loaded\n", meshes[m]);
+			continue;
+		}
+		report(meshes[m], "obj", indices, positions.size(), 0.0);
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		optimizeVertexCache(indices, positions.size());
+		optimizeVertexFetch(indices, positions, uvs, normals);
+		double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		report(meshes[m], "optimized", indices, positions.size(), elapsed * 1000.0);
+	}
+	return 0;
+}
@@ -0,0 +1,43 @@
+// Quantized vertices (GpuMesh::QUANTIZED) against float ones, on every mesh in mesh/ :
+// bytes per vertex and buffer size, then the largest error the shader sees after decoding.
+// Position error is given in model units and relative to the bounding box diagonal.
+// Run from the Transformations folder. Usage : vertex_quantization_bench
+// Build : compile with sources/vboindexer.cpp, sources/meshcache.cpp, sources/meshoptimize.cpp, sources/meshsimplify.cpp, sources/objloader.cpp, sources/mappedfile.cpp and sources/threadpool.cpp.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <meshcache.hpp>
+#include <vboindexer.hpp>
+
+static const char * meshes[] = {"mesh/cube.obj", "mesh/esfera.obj", "mesh/suzanne.obj", "mesh/g1.obj", "mesh/g2.obj", "mesh/g4.obj", "mesh/g5.obj"};
+
+int main(){
+	printf("%-20s %9s %10s %10s %9s %12s %10s %10s %10s %10s\n", "mesh", "vertices", "float KB", "quant KB", "B/vertex",
+		"pos error", "pos/diag", "normal deg", "uv error", "quant ms");
+	for (size_t m = 0; m < sizeof(meshes) / sizeof(meshes[0]); m++){
+		CachedMesh mesh;
+		if (!loadMeshCached(meshes[m], mesh)){
+			printf("%-20s could not be loaded\n", meshes[m]);
+			continue;
+		}
+
+		std::vector<QuantizedVertex> quantized;
+		QuantizationError error;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		quantizeVertices(mesh.positions, mesh.normals, mesh.uvs, mesh.vertexCount, mesh.boundsMin, mesh.boundsMax, quantized, error);
+		double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		float diagonal = glm::length(mesh.boundsMax - mesh.boundsMin);
+		printf("%-20s %9u %10.1f %10.1f %9u %12.3g %10.3g %10.4f %10.3g %10.3f\n", meshes[m], mesh.vertexCount,
+			mesh.vertexCount * sizeof(InterleavedVertex) / 1024.0, quantized.size() * sizeof(QuantizedVertex) / 1024.0,
+			(unsigned int)sizeof(QuantizedVertex), error.position, diagonal > 0 ? error.position / diagonal : 0.0f,
+			error.normal, error.uv, elapsed * 1000.0);
+		releaseMesh(mesh);
+	}
+	return 0;
+}
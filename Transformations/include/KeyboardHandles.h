@@ -23,20 +23,17 @@ void handle_input(int *selected_model, std::vector<Model> &my_models, double las
 	//inserts new models
 	if (glfwGetKey(g_pWindow, GLFW_KEY_1) == GLFW_PRESS) {
 		if (glfwGetKey(g_pWindow, GLFW_KEY_1) == GLFW_RELEASE) {
-			Model *new_model = new Model("mesh/cube.obj", glm::vec3(1, 0, 0));
-			my_models.push_back(*new_model);
+			my_models.push_back(Model("mesh/cube.obj", glm::vec3(1, 0, 0), GpuMesh::QUANTIZED, true));
 		}
 	}
 	else if (glfwGetKey(g_pWindow, GLFW_KEY_2) == GLFW_PRESS) {
 		if (glfwGetKey(g_pWindow, GLFW_KEY_2) == GLFW_RELEASE) {
-			Model *new_model = new Model("mesh/goose.obj", glm::vec3(2, 0, 0));
-			my_models.push_back(*new_model);
+			my_models.push_back(Model("mesh/goose.obj", glm::vec3(2, 0, 0), GpuMesh::QUANTIZED, true));
 		}
 	}
 	else if (glfwGetKey(g_pWindow, GLFW_KEY_3) == GLFW_PRESS) {
 		if (glfwGetKey(g_pWindow, GLFW_KEY_3) == GLFW_RELEASE) {
-			Model *new_model = new Model("mesh/suzanne.obj", glm::vec3(3, 0, 0));
-			my_models.push_back(*new_model);
+			my_models.push_back(Model("mesh/suzanne.obj", glm::vec3(3, 0, 0), GpuMesh::QUANTIZED, true));
 		}
 	}
 
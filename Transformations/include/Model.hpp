@@ -1,6 +1,7 @@
 // Include standard headers
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <vector>
 
 using namespace std;
@@ -21,6 +22,15 @@ using namespace glm;
 #include <objloader.hpp>
 #include <vboindexer.hpp>
 #include <glerror.hpp>
+#include <glstate.hpp>
+#include <meshcache.hpp>
+#include <meshregistry.hpp>
+
+// A level of detail is good enough while its error covers less than this many pixels on screen
+#define LOD_PIXEL_ERROR 1.0f
+// Hysteresis : a coarser level is only taken once its error is below this fraction of LOD_PIXEL_ERROR,
+// so a model sitting at the switch distance does not flicker between two levels
+#define LOD_HYSTERESIS 0.7f
 
 
 #pragma once
@@ -29,18 +39,10 @@ class Model
 public:
 	enum Direction{UP, DOWN, LEFT, RIGHT, IN, OUT};
 	enum Axis{X, Y, Z};
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec2> uvs;
-	std::vector<glm::vec3> normals;
-	std::vector<unsigned short> indices;
-	std::vector<glm::vec3> indexed_vertices;
-	std::vector<glm::vec2> indexed_uvs;
-	std::vector<glm::vec3> indexed_normals;
-
-	GLuint vertexbuffer;
-	GLuint uvbuffer;
-	GLuint normalbuffer;
-	GLuint elementbuffer;
+
+	//shared with every other model loaded from the same file (see meshregistry.hpp)
+	std::shared_ptr<const GpuMesh> mesh;
+	unsigned int lod = 0; // level drawn by drawGeometry, see selectLod
 
 	glm::mat4 modelMatrix = glm::mat4(1.0);
 	std::vector<glm::mat4> transformations;
@@ -81,7 +83,22 @@ public:
 	bool catmull;
 	float t_catmull = 0.0f;
 
-	Model(char * path, glm::vec3 initialPos);
+	// async : load the mesh on the worker pool (acquireMeshAsync) ; the model draws nothing until it is uploaded
+	Model(char * path, glm::vec3 initialPos, GpuMesh::Layout layout = GpuMesh::INTERLEAVED, bool async = false);
 	~Model();
+
+	// Picks the coarsest level of detail whose error stays under LOD_PIXEL_ERROR once projected.
+	// pixelsPerUnit : pixels covered by one world unit at distance 1 (projection[1][1] * viewport height / 2)
+	void selectLod(const glm::vec3 & cameraPosition, float pixelsPerUnit);
+
+	// Bounding sphere of the mesh once moved by modelMatrix ; radius 0 while the mesh is still loading
+	void worldBounds(glm::vec3 & out_center, float & out_radius) const;
+
+	// Binds the model VAO (through glstate.hpp) and issues its glDrawElements for the current lod, counted in g_glCallCount.
+	// Nothing is drawn while an async load of the mesh is pending.
+	void drawGeometry() const;
+
+	// The glDrawElements alone, for a caller that has bound mesh->vertexArray already (see renderqueue.hpp)
+	void drawElements() const;
 };
 
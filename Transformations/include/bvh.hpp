@@ -0,0 +1,77 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Bounding volume hierarchy over the world boxes of a scene's instances, for the spatial queries that
+// would otherwise walk every model : frustum culling, ray picking and proximity.
+// Built top-down with the surface area heuristic ; when instances move, refit updates the boxes
+// bottom-up without changing the tree, and needsRebuild says when the tree has drifted too far.
+
+// Axis aligned box
+struct Aabb{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+// 32 bytes : a leaf holds items [first, first + count), an inner node has count 0 and its children at first and first + 1
+struct BvhNode{
+	glm::vec3 boundsMin;
+	unsigned int first;
+	glm::vec3 boundsMax;
+	unsigned int count;
+};
+
+class Bvh
+{
+public:
+	Bvh() : buildCost(0) {}
+
+	// One item per box, numbered by its index in boxes
+	void build(const std::vector<Aabb> & boxes);
+
+	// New boxes for the same items (same count as the last build) ; the tree keeps its shape
+	void refit(const std::vector<Aabb> & boxes);
+
+	// True once refits have made the tree's SAH cost twice what it was when built : time to build again
+	bool needsRebuild() const;
+
+	// Items whose box touches the frustum of the six planes (see extractFrustumPlanes), appended to out_items
+	void queryFrustum(const glm::vec4 planes[6], std::vector<unsigned int> & out_items) const;
+
+	// Items whose box the ray crosses within maxDistance (direction need not be normalized : distances are in its units)
+	void queryRay(const glm::vec3 & origin, const glm::vec3 & direction, float maxDistance, std::vector<unsigned int> & out_items) const;
+
+	// Item whose box the ray enters first, -1 if none ; out_distance is where it enters (0 when the origin is inside)
+	int raycast(const glm::vec3 & origin, const glm::vec3 & direction, float maxDistance, float & out_distance) const;
+
+	// Items whose box overlaps the sphere
+	void querySphere(const glm::vec3 & center, float radius, std::vector<unsigned int> & out_items) const;
+
+	size_t itemCount() const { return items.size(); }
+	size_t nodeCount() const { return nodes.size(); }
+
+	// SAH cost of the tree : expected nodes visited plus items tested by a random ray, relative to the root
+	float cost() const;
+
+private:
+	std::vector<BvhNode> nodes; // children always come after their parent, so a backward walk is bottom-up
+	std::vector<unsigned int> items; // item indices, leaf by leaf
+	std::vector<Aabb> itemBoxes; // their boxes in the same order, so leaves read memory in sequence
+	float buildCost;
+
+	// Splits a leaf in two along the cheapest binned SAH plane ; false when keeping the leaf is cheaper.
+	// centroids are in the order of items, and partitioned with them
+	bool split(unsigned int node, std::vector<glm::vec3> & centroids);
+};
+
+// The tests the queries use, exposed so linear scans can give the very same answers
+bool aabbOutsidePlane(const Aabb & box, const glm::vec4 & plane);
+bool aabbInFrustum(const Aabb & box, const glm::vec4 planes[6]);
+bool aabbOverlapsSphere(const Aabb & box, const glm::vec3 & center, float radius);
+// Slab test ; inverseDirection = 1 / direction per axis. out_entry is clamped to 0
+bool aabbHitByRay(const Aabb & box, const glm::vec3 & origin, const glm::vec3 & inverseDirection, float maxDistance, float & out_entry);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef FRAMECONSTANTS_HPP
+#define FRAMECONSTANTS_HPP
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Per-frame constants shared by every program : one uniform buffer, uploaded once per frame and bound at
+// FRAMECONSTANTS_BINDING, read by the std140 block FrameConstants of the shaders. Per-object uniforms (the model
+// matrix, the position decoding of quantized meshes) are then the only uniforms a draw sends.
+//
+// GLSL side, to be repeated unchanged in every stage that reads it :
+//	struct Light{ vec3 position; vec3 ambient; vec3 diffuse; vec3 specular; };
+//	layout(std140) uniform FrameConstants{
+//		mat4 view; mat4 projection; mat4 viewProjection;
+//		vec3 viewPos; int lightCount;
+//		Light lights[FRAMECONSTANTS_MAX_LIGHTS];
+//	};
+
+#define FRAMECONSTANTS_BINDING 0
+#define FRAMECONSTANTS_MAX_LIGHTS 4
+
+// std140 : every vec3 of a light starts a new 16-byte slot, w is padding
+struct FrameLight{
+	glm::vec4 position;
+	glm::vec4 ambient;
+	glm::vec4 diffuse;
+	glm::vec4 specular;
+};
+
+// std140 : viewPos ends at 204 and lightCount fills the rest of its slot
+struct FrameConstants{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec3 viewPos;
+	int lightCount;
+	FrameLight lights[FRAMECONSTANTS_MAX_LIGHTS];
+};
+
+// Creates the buffer and binds it at FRAMECONSTANTS_BINDING ; once, after the context
+void initFrameConstants();
+
+// Points the program's FrameConstants block at FRAMECONSTANTS_BINDING ; after every LoadShaders (the binding is
+// program state and is not part of a cached program binary). Programs without the block are left alone
+void bindFrameConstantsBlock(GLuint programID);
+
+// One upload for the whole frame, before its first draw
+void uploadFrameConstants(const FrameConstants & constants);
+
+void cleanupFrameConstants();
+
+#endif
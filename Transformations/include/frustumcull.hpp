@@ -0,0 +1,44 @@
+#ifndef FRUSTUMCULL_HPP
+#define FRUSTUMCULL_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Batched view frustum culling : every instance is a bounding sphere, stored as a structure of arrays so
+// one SIMD register holds the same coordinate of 4 (SSE) or 8 (AVX, when built with /arch:AVX or -mavx)
+// spheres. Large batches are split over defaultThreadPool.
+
+// Sphere centered on the AABB of positions that holds all of them ; not the smallest one, but close for most meshes
+void computeBoundingSphere(const glm::vec3 * positions, size_t count, glm::vec3 & out_center, float & out_radius);
+
+// Upper bound of how much matrix stretches a length, to scale a model space radius or size to world space :
+// the largest Gershgorin row of M^T M. Exact for rotations and axis scaling, still an upper bound with shearing
+float maxScale(const glm::mat4 & matrix);
+
+// The six planes of a clip matrix (Gribb & Hartmann), normalized and pointing inside :
+// a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them.
+// With projection * view the planes are in world space.
+void extractFrustumPlanes(const glm::mat4 & viewProjection, glm::vec4 out_planes[6]);
+
+// World space spheres, one entry per instance
+struct SphereBounds{
+	std::vector<float> x, y, z, radius;
+
+	size_t size() const { return x.size(); }
+	void resize(size_t count){ x.resize(count); y.resize(count); z.resize(count); radius.resize(count); }
+	void set(size_t i, const glm::vec3 & center, float r){ x[i] = center.x; y[i] = center.y; z[i] = center.z; radius[i] = r; }
+};
+
+struct CullStats{
+	unsigned int visible;
+	unsigned int culled;
+};
+
+// out_visible[i] = 1 when sphere i touches the frustum, 0 when it is entirely outside one plane
+CullStats cullSpheres(const glm::vec4 planes[6], const SphereBounds & spheres, std::vector<unsigned char> & out_visible, bool multithreaded = true);
+
+// Same test one sphere at a time on spheres [begin, end), without SIMD or threads ; returns the visible count
+unsigned int cullSpheresScalar(const glm::vec4 planes[6], const SphereBounds & spheres, size_t begin, size_t end, unsigned char * out_visible);
+
+#endif
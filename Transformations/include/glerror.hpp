@@ -14,6 +14,23 @@ void _check_gl_error(const char *file, int line);
 /// [... some opengl calls]
 /// glCheckError();
 ///
+/// glGetError makes the driver catch up with the calls queued so far : release builds (NDEBUG) skip it
+///
+#ifdef NDEBUG
+#define check_gl_error() ((void)0)
+#else
 #define check_gl_error() _check_gl_error(__FILE__,__LINE__)
+#endif
+
+// GL calls issued through counted_gl_call since the counter was last reset
+extern unsigned int g_glCallCount;
+
+///
+/// Usage
+/// g_glCallCount = 0;
+/// counted_gl_call(glBindVertexArray(vao));
+/// printf("%u GL calls\n", g_glCallCount);
+///
+#define counted_gl_call(call) (++g_glCallCount, call)
 
 #endif // GLERROR_H
@@ -0,0 +1,52 @@
+#ifndef GLSTATE_HPP
+#define GLSTATE_HPP
+
+#include <GL/glew.h>
+
+// Shadow of the GL state the renderer sets : every glState* call compares with the last value set through
+// this layer and only reaches the driver when it differs. All rendering code binds through it, so the shadow
+// stays true ; code outside it (AntTweakBar) changes the state behind its back, so call glStateInvalidate after.
+// Deleting through glStateDelete* forgets the bindings of the deleted names, which GL unbinds and may hand out again.
+//
+// Tracked : program, active unit, GL_TEXTURE_2D per unit, the buffer targets below, vertex array, the enabled
+// attributes of each vertex array, GL_BLEND / GL_DEPTH_TEST / GL_CULL_FACE, blend function, depth function and
+// mask, cull face. Anything else passes straight through and counts as issued.
+
+// Texture units shadowed ; higher units pass through
+#define GLSTATE_TEXTURE_UNITS 16
+
+// Calls that reached GL and calls dropped as no-ops, since the caller last reset them (once per frame in draw)
+struct GlStateStats{
+	unsigned int issued;
+	unsigned int filtered;
+};
+extern GlStateStats g_glStateStats;
+
+// Forget everything : the next call of each kind reaches GL
+void glStateInvalidate();
+
+void glStateUseProgram(GLuint program);
+void glStateActiveTexture(GLenum unit);
+// Binds on the active unit
+void glStateBindTexture(GLenum target, GLuint texture);
+// GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER (part of the bound vertex array), GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+// GL_UNIFORM_BUFFER
+void glStateBindBuffer(GLenum target, GLuint buffer);
+void glStateBindVertexArray(GLuint vertexArray);
+// On the bound vertex array
+void glStateEnableVertexAttribArray(GLuint index);
+void glStateDisableVertexAttribArray(GLuint index);
+
+void glStateEnable(GLenum capability);
+void glStateDisable(GLenum capability);
+void glStateBlendFunc(GLenum source, GLenum destination);
+void glStateDepthFunc(GLenum function);
+void glStateDepthMask(GLboolean mask);
+void glStateCullFace(GLenum mode);
+
+void glStateDeleteProgram(GLuint program);
+void glStateDeleteTextures(GLsizei count, const GLuint * textures);
+void glStateDeleteBuffers(GLsizei count, const GLuint * buffers);
+void glStateDeleteVertexArrays(GLsizei count, const GLuint * vertexArrays);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <stddef.h>
+
+// Read-only view of a whole file, mapped straight into our address space.
+// Nothing is copied : pages are faulted in by the OS the first time they are touched.
+struct MappedFile{
+	const char * data;
+	size_t size;
+#ifdef _WIN32
+	void * fileHandle;
+	void * mappingHandle;
+#else
+	int fd;
+#endif
+};
+
+// Maps the file at "path". An empty file maps successfully with data == NULL and size == 0.
+bool mapFile(const char * path, MappedFile & out_file);
+
+void unmapFile(MappedFile & file);
+
+#endif
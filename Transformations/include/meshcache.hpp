@@ -0,0 +1,71 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include <vector>
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+
+#include "mappedfile.hpp"
+#include "meshsimplify.hpp"
+
+// Binary cache of an indexed mesh, stored next to its OBJ as "<file>.obj.meshcache".
+// Layout : MeshCacheHeader, then positions, UVs, normals, indices and the LOD table, each 16-byte aligned.
+// Triangles and vertices are stored already reordered for the vertex cache and fetch (meshoptimize.hpp).
+// The indices hold every level of detail one after the other (meshsimplify.hpp), all using the same vertices.
+// The header keeps a hash of the OBJ bytes ; a cache whose hash, size or version
+// does not match is rebuilt from the OBJ.
+
+#define MESHCACHE_VERSION 5
+
+struct MeshCacheHeader{
+	char magic[4];          // "MSHC"
+	uint32_t version;       // MESHCACHE_VERSION
+	uint64_t sourceHash;    // hashMeshSource() of the OBJ file
+	uint64_t sourceSize;    // size of the OBJ file in bytes
+	uint32_t vertexCount;
+	uint32_t indexCount;    // all levels of detail
+	uint32_t indexSize;     // bytes per index : 1, 2 or 4, the narrowest that fits vertexCount
+	uint32_t lodCount;      // MeshLod entries at lodsOffset, the full mesh first
+	float boundsMin[3];
+	float boundsMax[3];
+	uint64_t positionsOffset; // from the start of the file
+	uint64_t uvsOffset;
+	uint64_t normalsOffset;
+	uint64_t indicesOffset;
+	uint64_t lodsOffset;
+	LodSettings lodSettings; // the chain was built with these ; a cache built with others is rebuilt
+};
+
+// An indexed mesh ready for glBufferData. The pointers either point into the mapped
+// cache file or into the owned vectors (when the mesh was just built from the OBJ).
+struct CachedMesh{
+	const glm::vec3 * positions;
+	const glm::vec2 * uvs;
+	const glm::vec3 * normals;
+	const void * indices;
+	unsigned int indexSize; // 1, 2 or 4 bytes
+	unsigned int vertexCount;
+	unsigned int indexCount; // all levels of detail
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	std::vector<MeshLod> lods; // level 0 is the full mesh
+
+	MappedFile file;
+	bool mapped;
+	std::vector<glm::vec3> ownedPositions;
+	std::vector<glm::vec2> ownedUVs;
+	std::vector<glm::vec3> ownedNormals;
+	std::vector<unsigned char> ownedIndices;
+};
+
+// 64-bit hash used to key the cache on the source bytes
+uint64_t hashMeshSource(const void * data, size_t size);
+
+// Loads objPath through its cache, building (and writing) the cache first if it is missing or stale.
+// The LOD chain is built with lodSettings. Release with releaseMesh once the buffers are uploaded.
+bool loadMeshCached(const char * objPath, CachedMesh & out_mesh, const LodSettings & lodSettings = defaultLodSettings());
+
+void releaseMesh(CachedMesh & mesh);
+
+#endif
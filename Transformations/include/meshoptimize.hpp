@@ -0,0 +1,36 @@
+#ifndef MESHOPTIMIZE_HPP
+#define MESHOPTIMIZE_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Post-indexing optimizations. Run optimizeVertexCache first, then optimizeVertexFetch :
+// the first one orders the triangles, the second one lays the vertices out in that order.
+
+// Size of the post-transform cache the triangle order is tuned for
+#define VERTEX_CACHE_SIZE 32
+
+// Reorders the triangles of an indexed triangle list so that vertices are reused while they are
+// still in the post-transform cache (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation").
+// Linear in the number of triangles ; the set of triangles does not change.
+void optimizeVertexCache(std::vector<unsigned int> & indices, size_t vertexCount);
+
+// Renumbers the vertices in the order the indices first use them and moves the attributes to match,
+// so the vertex fetch walks the buffers forward. Vertices no triangle uses are dropped.
+void optimizeVertexFetch(
+	std::vector<unsigned int> & indices,
+	std::vector<glm::vec3> & positions,
+	std::vector<glm::vec2> & uvs,
+	std::vector<glm::vec3> & normals
+);
+
+struct VertexCacheStats{
+	float acmr; // average cache miss ratio : vertex shader runs per triangle, 0.5 at best for a regular grid, 3 at worst
+	float atvr; // average transform to vertex ratio : vertex shader runs per vertex, 1 at best
+};
+
+// Simulates a FIFO post-transform cache of cacheSize entries over the index list
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> & indices, size_t vertexCount, unsigned int cacheSize);
+
+#endif
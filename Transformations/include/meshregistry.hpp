@@ -0,0 +1,65 @@
+#ifndef MESHREGISTRY_HPP
+#define MESHREGISTRY_HPP
+
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "meshsimplify.hpp"
+
+// Geometry of one OBJ file once it lives on the GPU. Immutable after upload and shared
+// by every Model built from the same file : models only keep their own transform and animation state.
+struct GpuMesh{
+	// SEPARATE : one VBO per attribute ; INTERLEAVED : a single position/normal/uv VBO ;
+	// QUANTIZED : a single VBO of 16-byte QuantizedVertex (see vboindexer.hpp)
+	// Either way the attribute setup is recorded once in the VAO
+	enum Layout{SEPARATE, INTERLEAVED, QUANTIZED};
+
+	Layout layout;
+	GLuint vertexArray;
+	GLuint vertexbuffer; // interleaved stream when layout is INTERLEAVED
+	GLuint uvbuffer;
+	GLuint normalbuffer;
+	GLuint elementbuffer;
+	GLsizei indexCount; // full mesh, level 0
+	GLenum indexType; // narrowest type for the mesh : GL_UNSIGNED_BYTE, _SHORT or _INT
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	glm::vec3 sphereCenter; // bounding sphere, model space (see computeBoundingSphere)
+	float sphereRadius;
+	// Decoded position = attribute * positionScale + positionOffset ; (1,1,1) and (0,0,0) unless QUANTIZED
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+	// Ranges of the element buffer, the full mesh first ; coarser levels reuse the same vertices
+	std::vector<MeshLod> lods;
+	bool ready; // false while an acquireMeshAsync load is still on its way ; nothing to draw yet
+
+	GpuMesh() : layout(INTERLEAVED), vertexArray(0), vertexbuffer(0), uvbuffer(0), normalbuffer(0), elementbuffer(0),
+		indexCount(0), indexType(GL_UNSIGNED_SHORT), boundsMin(0, 0, 0), boundsMax(0, 0, 0),
+		sphereCenter(0, 0, 0), sphereRadius(0), positionScale(1, 1, 1), positionOffset(0, 0, 0), ready(false) {}
+};
+
+// Returns the GPU mesh for path, loading and uploading it only if no live handle to the same
+// file (by canonical path) and layout exists. The GL objects are deleted with the last handle,
+// so drop every handle before the GL context goes away. Must be called on the GL thread.
+// A mesh whose acquireMeshAsync load is still pending is returned as is, not ready yet.
+// A file that cannot be loaded is reported and never becomes ready ; it is not kept in the registry.
+std::shared_ptr<const GpuMesh> acquireMesh(const char * path, GpuMesh::Layout layout = GpuMesh::INTERLEAVED);
+
+// Same lookup, but a new mesh is loaded, parsed and indexed on the worker pool : the handle comes back
+// at once with ready == false and is filled in by a later pumpMeshUploads. Must be called on the GL thread.
+std::shared_ptr<const GpuMesh> acquireMeshAsync(const char * path, GpuMesh::Layout layout = GpuMesh::INTERLEAVED);
+
+// Uploads finished async loads until budgetSeconds is spent, at least one per call.
+// Call once per frame on the GL thread. Returns the number of meshes uploaded.
+unsigned int pumpMeshUploads(double budgetSeconds);
+
+// Async loads not uploaded yet
+unsigned int pendingMeshLoads();
+
+// Number of distinct meshes currently alive in the registry
+size_t registeredMeshCount();
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef MESHSIMPLIFY_HPP
+#define MESHSIMPLIFY_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Quadric error metric simplification (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics").
+// Errors are distances relative to the mesh bounding box diagonal : 0.01 is 1% of the mesh size.
+
+// One level of detail : a range of the element buffer, and the error its simplification reached
+struct MeshLod{
+	unsigned int firstIndex;
+	unsigned int indexCount;
+	float error;
+};
+
+struct LodSettings{
+	unsigned int maxLevels;    // levels in the chain, the full mesh included ; 0 : as many as minTriangles and maxError allow
+	float reduction;           // triangle count of a level over the one before
+	unsigned int minTriangles; // no level goes below this
+	float maxError;            // no level goes above this
+};
+
+// Halving the triangles each time, down to 64 triangles or 5% error : a 65k triangle mesh gets 11 levels, and
+// all of them together take less than twice the indices of the full one
+LodSettings defaultLodSettings();
+
+// Collapses edges by increasing error until the list is down to targetIndexCount indices, or the next collapse
+// would cost more than maxError. A collapse moves a vertex onto one of its neighbours, so out_indices still
+// index the same vertex buffer ; vertices sharing a position (UV or normal seams) move together, and seams and
+// open borders are kept in place. Returns the largest error of the collapses done.
+float simplifyMesh(
+	const std::vector<unsigned int> & indices,
+	const glm::vec3 * positions,
+	size_t vertexCount,
+	size_t targetIndexCount,
+	float maxError,
+	std::vector<unsigned int> & out_indices
+);
+
+// Replaces indices (level 0) by the whole chain, level after level, each simplified from level 0 and ordered
+// for the vertex cache. All levels share the vertex buffer. out_lods[0] is the full mesh.
+void buildLodChain(
+	std::vector<unsigned int> & indices,
+	const glm::vec3 * positions,
+	size_t vertexCount,
+	const LodSettings & settings,
+	std::vector<MeshLod> & out_lods
+);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef MPSCQUEUE_HPP
+#define MPSCQUEUE_HPP
+
+#include <atomic>
+
+// Unbounded lock-free queue for many producer threads and a single consumer thread
+// (Vyukov's intrusive MPSC list). push never blocks : one atomic exchange per element.
+// pop may miss an element whose push is still in progress ; it shows up on a later pop.
+template<typename T>
+class MPSCQueue
+{
+public:
+	MPSCQueue() : tail(new Node()) { head.store(tail); }
+
+	~MPSCQueue(){
+		T value;
+		while (pop(value)) {}
+		delete tail;
+	}
+
+	// Any thread
+	void push(const T & value){
+		Node * node = new Node();
+		node->value = value;
+		Node * previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	// Consumer thread only
+	bool pop(T & out_value){
+		Node * next = tail->next.load(std::memory_order_acquire);
+		if (next == NULL)
+			return false;
+		out_value = next->value;
+		delete tail;
+		tail = next; // next becomes the new stub
+		return true;
+	}
+
+private:
+	struct Node{
+		std::atomic<Node *> next;
+		T value;
+		Node() : next(NULL), value() {}
+	};
+
+	std::atomic<Node *> head; // last pushed node
+	Node * tail;              // stub : its successor is the next element to pop
+
+	MPSCQueue(const MPSCQueue &);
+	MPSCQueue & operator=(const MPSCQueue &);
+};
+
+#endif
@@ -9,6 +9,37 @@ bool loadOBJ(
 );
 
 
+// Same output as loadOBJ, but the file is memory-mapped and parsed in place
+// (no fscanf, no per-token copies). Also accepts "f v", "f v/vt" and "f v//vn"
+// faces (missing attributes are zero) and triangulates polygons as fans.
+bool loadOBJ_mmap(
+	const char * path, 
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs, 
+	std::vector<glm::vec3> & out_normals
+);
+// Same output as loadOBJ_mmap. The mapped file is split at line boundaries and the
+// chunks are parsed and resolved on defaultThreadPool(). threadCount == 0 uses every core;
+// small files are parsed as a single chunk.
+bool loadOBJ_parallel(
+	const char * path, 
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs, 
+	std::vector<glm::vec3> & out_normals,
+	unsigned int threadCount = 0
+);
+// Loads an OBJ straight into indexed buffers, like loadOBJ followed by indexVBO but in one pass :
+// (v, vt, vn) index triples are welded while the faces are parsed, so the de-indexed arrays never exist.
+// Corners are welded by OBJ index, not by value, so a file that repeats identical values
+// under different indices may give a few more vertices than indexVBO.
+// Indices are 32-bit ; narrow them with narrowestIndexSize/packIndices (vboindexer.hpp) before upload.
+bool loadOBJ_indexed(
+	const char * path,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+);
 
 bool loadAssImp(
 	const char * path, 
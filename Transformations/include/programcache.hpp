@@ -0,0 +1,40 @@
+#ifndef PROGRAMCACHE_HPP
+#define PROGRAMCACHE_HPP
+
+#include <string>
+#include <stdint.h>
+
+#include <GL/glew.h>
+
+// Binary cache of a linked program (glGetProgramBinary), stored next to its vertex shader as
+// "<file>.programcache" : loading it skips compiling and linking the GLSL.
+// Layout : ProgramCacheHeader, then the driver's binary. The header keeps a key hashing the GLSL sources with
+// the vendor, renderer and version strings of the context ; a cache whose key or version does not match, or that
+// the driver refuses (glProgramBinary may do so after any driver update), is rebuilt from the sources.
+// A vertex shader shared by several programs keeps the cache of the last one linked.
+
+#define PROGRAMCACHE_VERSION 1
+
+struct ProgramCacheHeader{
+	char magic[4];         // "PRGC"
+	uint32_t version;      // PROGRAMCACHE_VERSION
+	uint64_t key;          // programCacheKey() of the sources
+	uint32_t binaryFormat; // as returned by glGetProgramBinary
+	uint32_t binarySize;   // bytes following the header
+};
+
+// False when the context cannot hand out program binaries (before GL 4.1 without ARB_get_program_binary, or
+// with no binary format at all) : the functions below then do nothing
+bool programBinarySupported();
+
+// Hashes the sources of a program, in order, with the driver strings
+uint64_t programCacheKey(const std::string * sources, int count);
+
+// The program stored at cachePath, linked ; 0 when there is none, it was made from other sources or by another
+// driver, or the driver refuses it
+GLuint loadCachedProgram(const char * cachePath, uint64_t key);
+
+// Stores a linked program. Set GL_PROGRAM_BINARY_RETRIEVABLE_HINT on it before linking
+bool saveCachedProgram(const char * cachePath, uint64_t key, GLuint program);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef RENDERQUEUE_HPP
+#define RENDERQUEUE_HPP
+
+#include <stdint.h>
+#include <vector>
+
+// Render queue : every draw of a frame is a packet with a 64-bit sort key, the queue is radix sorted and walked
+// in key order, so draws sharing a program, a material and a vertex array come one after the other and a
+// RenderStateTracker lets the walk skip the binds that would not change anything.
+
+// Key fields, most significant first : pass, program, material (texture set), vertex array, depth.
+// Names wider than their field are folded into it : sorting gets worse, never wrong, the tracker compares the full names
+#define RENDER_KEY_PASS_BITS 4
+#define RENDER_KEY_PROGRAM_BITS 12
+#define RENDER_KEY_MATERIAL_BITS 16
+#define RENDER_KEY_VERTEX_ARRAY_BITS 16
+#define RENDER_KEY_DEPTH_BITS 16
+
+enum RenderPass{
+	RENDER_PASS_OPAQUE = 0, // front to back, so early depth testing drops what is hidden
+	RENDER_PASS_BLENDED = 1 // back to front, drawn after every opaque draw
+};
+
+// depth : distance to the camera, clamped to [0, farDepth] ; inverted for blended passes
+uint64_t makeSortKey(RenderPass pass, unsigned int program, unsigned int material, unsigned int vertexArray, float depth, float farDepth);
+
+// One draw : item is whatever the caller needs to issue it (a model index in draw())
+struct RenderPacket{
+	uint64_t key;
+	unsigned int item;
+};
+
+class RenderQueue
+{
+public:
+	void clear() { packets.clear(); }
+	void push(uint64_t key, unsigned int item);
+
+	// LSD radix sort on the keys, a byte per pass ; bytes equal in every key are skipped, so a frame with one
+	// program and one material only pays for the vertex array and depth bytes. Stable
+	void sort();
+
+	size_t size() const { return packets.size(); }
+	const RenderPacket & operator[](size_t i) const { return packets[i]; }
+
+private:
+	std::vector<RenderPacket> packets;
+	std::vector<RenderPacket> scratch;
+};
+
+// Last state set by the walk ; each call says whether the value differs from the current one (and keeps it),
+// the caller issues the GL call only then. stateChanges counts the changes since reset
+class RenderStateTracker
+{
+public:
+	RenderStateTracker() { reset(); }
+
+	// state unknown : the next value of each kind is always a change
+	void reset();
+
+	bool useProgram(unsigned int program);
+	bool bindMaterial(unsigned int material);
+	bool bindVertexArray(unsigned int vertexArray);
+
+	unsigned int stateChanges;
+
+private:
+	unsigned int program, material, vertexArray;
+	bool known[3];
+
+	bool change(unsigned int & current, bool & isKnown, unsigned int value);
+};
+
+#endif
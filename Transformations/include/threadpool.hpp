@@ -0,0 +1,40 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed set of worker threads pulling jobs from one queue.
+class ThreadPool
+{
+public:
+	// 0 threads = one per hardware thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	unsigned int size() const { return (unsigned int)workers.size(); }
+
+	// Queues a job and returns immediately
+	void run(std::function<void()> job);
+
+	// Runs job(0) ... job(count-1) on the workers and the calling thread, and waits for all of them
+	void parallelFor(unsigned int count, const std::function<void(unsigned int)> & job);
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()> > jobs;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	bool stopping;
+
+	void workerLoop();
+};
+
+// Pool shared by the loaders, created on first use with one thread per hardware thread
+ThreadPool & defaultThreadPool();
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef VBOINDEXER_HPP
 #define VBOINDEXER_HPP
 
-void indexVBO(
+// Every indexer returns true once its outputs are filled. The ones with unsigned short indices return false,
+// and leave the outputs as they were, when the mesh needs more than 65536 vertices : use an unsigned int
+// version for it, or pack the 32-bit indices to the narrowest size that fits (see narrowestIndexSize and packIndices)
+bool indexVBO(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
 	std::vector<glm::vec3> & in_normals,
@@ -12,8 +15,77 @@ void indexVBO(
 	std::vector<glm::vec3> & out_normals
 );
 
+// 32-bit version, for meshes with more than 65536 unique vertices ; every vertex count fits, so it returns true
+bool indexVBO(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+);
+
+// Same output as indexVBO, with the std::map welder it used before (kept for benchmarks)
+bool indexVBO_map(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+);
+
+// Quadratic search with a 0.01 tolerance on every component (kept for benchmarks)
+bool indexVBO_slow(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+);
+
+// Welds vertices whose position, UV and normal all lie within 0.01 of an already exported one,
+// summing their tangents and bitangents. Candidates come from a spatial hash grid, so this is linear in the vertex count.
+bool indexVBO_TBN(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	std::vector<glm::vec3> & in_tangents,
+	std::vector<glm::vec3> & in_bitangents,
+
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<glm::vec3> & out_tangents,
+	std::vector<glm::vec3> & out_bitangents
+);
+
+// 32-bit version, for meshes with more than 65536 unique vertices ; every vertex count fits, so it returns true
+bool indexVBO_TBN(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	std::vector<glm::vec3> & in_tangents,
+	std::vector<glm::vec3> & in_bitangents,
 
-void indexVBO_TBN(
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<glm::vec3> & out_tangents,
+	std::vector<glm::vec3> & out_bitangents
+);
+
+// Same output as indexVBO_TBN, searching every exported vertex (quadratic, kept for benchmarks)
+bool indexVBO_TBN_slow(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
 	std::vector<glm::vec3> & in_normals,
@@ -28,4 +100,56 @@ void indexVBO_TBN(
 	std::vector<glm::vec3> & out_bitangents
 );
 
+// Bytes per index needed to address vertexCount vertices : 1, 2 or 4
+unsigned int narrowestIndexSize(size_t vertexCount);
+
+// Narrows 32-bit indices to indexSize bytes each (see narrowestIndexSize)
+void packIndices(const std::vector<unsigned int> & indices, unsigned int indexSize, std::vector<unsigned char> & out_data);
+
+// One vertex of an interleaved buffer : 32 bytes, so a vertex never straddles two 64-byte cache lines
+struct InterleavedVertex{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+};
+
+// Packs separate position/normal/UV streams into a single position/normal/uv stream
+void interleaveVertices(
+	const glm::vec3 * positions,
+	const glm::vec3 * normals,
+	const glm::vec2 * uvs,
+	size_t count,
+	std::vector<InterleavedVertex> & out_vertices
+);
+
+// One vertex of a quantized buffer : 16 bytes instead of InterleavedVertex's 32
+//  position : 16-bit unsigned normalized, relative to the mesh bounding box (w is padding)
+//  normal   : GL_INT_2_10_10_10_REV, signed normalized (w unused)
+//  uv       : half floats
+struct QuantizedVertex{
+	unsigned short position[4];
+	unsigned int normal;
+	unsigned short uv[2];
+};
+
+// Largest difference between the float attributes and what the shader decodes from the quantized ones
+struct QuantizationError{
+	float position; // model units
+	float normal;   // degrees
+	float uv;       // texture coordinate units
+};
+
+// Quantizes separate position/normal/UV streams into QuantizedVertex. The shader rebuilds a position
+// as boundsMin + decoded * (boundsMax - boundsMin), see StandardShading.vertexshader.
+void quantizeVertices(
+	const glm::vec3 * positions,
+	const glm::vec3 * normals,
+	const glm::vec2 * uvs,
+	size_t count,
+	const glm::vec3 & boundsMin,
+	const glm::vec3 & boundsMax,
+	std::vector<QuantizedVertex> & out_vertices,
+	QuantizationError & out_error
+);
+
 #endif
\ No newline at end of file
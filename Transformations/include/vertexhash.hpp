@@ -0,0 +1,112 @@
+#ifndef VERTEXHASH_HPP
+#define VERTEXHASH_HPP
+
+#include <vector>
+#include <string.h> // for memcmp
+#include <stdint.h>
+
+// Flat open-addressing table used to weld vertices.
+// Key is any packed, padding-free struct (a vertex, a set of OBJ indices...) : keys are hashed
+// and compared byte for byte, like the memcmp-based PackedVertex ordering used to be.
+// Every new key gets the next index in insertion order, which is exactly the output
+// vertex number an indexer needs. Linear probing, load factor kept under 1/2.
+template <typename Key>
+class VertexHashTable
+{
+public:
+	explicit VertexHashTable(size_t expectedKeys = 0){
+		size_t capacity = 16;
+		while (capacity < expectedKeys * 2)
+			capacity *= 2;
+		slots.assign(capacity, 0);
+		keys.reserve(expectedKeys);
+		hashes.reserve(expectedKeys);
+	}
+
+	// Index of "key" in insertion order ; the key is added if it is new.
+	unsigned int findOrInsert(const Key & key, bool & inserted){
+		if ((keys.size() + 1) * 2 > slots.size())
+			grow();
+		uint32_t h = hash(key);
+		size_t mask = slots.size() - 1;
+		size_t slot = h & mask;
+		while (slots[slot] != 0){
+			unsigned int index = slots[slot] - 1;
+			if (hashes[index] == h && memcmp(&keys[index], &key, sizeof(Key)) == 0){
+				inserted = false;
+				return index;
+			}
+			slot = (slot + 1) & mask;
+		}
+		keys.push_back(key);
+		hashes.push_back(h);
+		slots[slot] = (uint32_t)keys.size();
+		inserted = true;
+		return (unsigned int)keys.size() - 1;
+	}
+
+	unsigned int findOrInsert(const Key & key){
+		bool inserted;
+		return findOrInsert(key, inserted);
+	}
+
+	// Looks "key" up without inserting it
+	bool find(const Key & key, unsigned int & index) const{
+		uint32_t h = hash(key);
+		size_t mask = slots.size() - 1;
+		size_t slot = h & mask;
+		while (slots[slot] != 0){
+			unsigned int candidate = slots[slot] - 1;
+			if (hashes[candidate] == h && memcmp(&keys[candidate], &key, sizeof(Key)) == 0){
+				index = candidate;
+				return true;
+			}
+			slot = (slot + 1) & mask;
+		}
+		return false;
+	}
+
+	size_t size() const { return keys.size(); }
+	const Key & key(unsigned int index) const { return keys[index]; }
+
+	static uint32_t hash(const Key & key){
+		// murmur3-style mixing over the 32-bit words of the key
+		const unsigned char * bytes = (const unsigned char *)&key;
+		uint32_t h = 0x9747B28Cu;
+		for (size_t i = 0; i + 4 <= sizeof(Key); i += 4){
+			uint32_t word;
+			memcpy(&word, bytes + i, 4);
+			word *= 0xCC9E2D51u;
+			word = (word << 15) | (word >> 17);
+			word *= 0x1B873593u;
+			h ^= word;
+			h = (h << 13) | (h >> 19);
+			h = h * 5 + 0xE6546B64u;
+		}
+		h ^= h >> 16;
+		h *= 0x85EBCA6Bu;
+		h ^= h >> 13;
+		h *= 0xC2B2AE35u;
+		h ^= h >> 16;
+		return h;
+	}
+
+private:
+	std::vector<uint32_t> slots;  // index + 1, 0 = empty
+	std::vector<Key> keys;        // in insertion order
+	std::vector<uint32_t> hashes; // hash of keys[i], so that growing does not rehash
+
+	void grow(){
+		std::vector<uint32_t> bigger(slots.size() * 2, 0);
+		size_t mask = bigger.size() - 1;
+		for (size_t i = 0; i < keys.size(); i++){
+			size_t slot = hashes[i] & mask;
+			while (bigger[slot] != 0)
+				slot = (slot + 1) & mask;
+			bigger[slot] = (uint32_t)i + 1;
+		}
+		slots.swap(bigger);
+	}
+};
+
+#endif
@@ -1,29 +1,13 @@
 #include "Model.hpp"
+#include "frustumcull.hpp"
 
 
-Model::Model(char * path, glm::vec3 initialPos)
+Model::Model(char * path, glm::vec3 initialPos, GpuMesh::Layout layout, bool async)
 {
 	//sets model initial pos
 	this->initialPos = initialPos;
-	//loads model
-	bool res = loadOBJ(path, vertices, uvs, normals);
-	indexVBO(vertices, uvs, normals, indices, indexed_vertices, indexed_uvs, indexed_normals);
-	//generate buffers for model
-	glGenBuffers(1, &vertexbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-	glBufferData(GL_ARRAY_BUFFER, indexed_vertices.size() * sizeof(glm::vec3), &indexed_vertices[0], GL_STATIC_DRAW);
-
-	glGenBuffers(1, &uvbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-	glBufferData(GL_ARRAY_BUFFER, indexed_uvs.size() * sizeof(glm::vec2), &indexed_uvs[0], GL_STATIC_DRAW);
-
-	glGenBuffers(1, &normalbuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-	glBufferData(GL_ARRAY_BUFFER, indexed_normals.size() * sizeof(glm::vec3), &indexed_normals[0], GL_STATIC_DRAW);
-
-	glGenBuffers(1, &elementbuffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), &indices[0], GL_STATIC_DRAW);
+	//shares the GPU mesh when this file is already loaded, loads and uploads it otherwise
+	mesh = async ? acquireMeshAsync(path, layout) : acquireMesh(path, layout);
 
 	//generates model matrix
 	modelMatrix = glm::translate(glm::mat4(1.0), initialPos);
@@ -35,3 +19,66 @@ Model::Model(char * path, glm::vec3 initialPos)
 Model::~Model()
 {
 }
+
+void Model::selectLod(const glm::vec3 & cameraPosition, float pixelsPerUnit)
+{
+	const std::vector<MeshLod> & lods = mesh->lods;
+	if (!mesh->ready || lods.size() < 2){
+		lod = 0;
+		return;
+	}
+
+	// World size of the mesh : its bounding box diagonal, scaled like the model
+	float size = glm::length(mesh->boundsMax - mesh->boundsMin) * maxScale(modelMatrix);
+	glm::vec3 center = glm::vec3(modelMatrix * glm::vec4((mesh->boundsMin + mesh->boundsMax) * 0.5f, 1.0f));
+	// Distance to the nearest point of the bounding sphere, the camera may be inside it
+	float distance = glm::max(glm::length(center - cameraPosition) - size * 0.5f, 0.001f);
+	float projectedSize = size * pixelsPerUnit / distance;
+
+	// Level errors are relative to the diagonal : error * projectedSize is in pixels
+	if (lod >= lods.size())
+		lod = (unsigned int)lods.size() - 1;
+	while (lod > 0 && lods[lod].error * projectedSize > LOD_PIXEL_ERROR)
+		lod--;
+	while (lod + 1 < lods.size() && lods[lod + 1].error * projectedSize < LOD_PIXEL_ERROR * LOD_HYSTERESIS)
+		lod++;
+}
+
+void Model::worldBounds(glm::vec3 & out_center, float & out_radius) const
+{
+	out_center = glm::vec3(modelMatrix * glm::vec4(mesh->sphereCenter, 1.0f));
+	out_radius = mesh->sphereRadius * maxScale(modelMatrix);
+}
+
+void Model::drawGeometry() const
+{
+	// still loading
+	if (!mesh->ready)
+		return;
+
+	glStateBindVertexArray(mesh->vertexArray);
+	drawElements();
+}
+
+void Model::drawElements() const
+{
+	if (!mesh->ready)
+		return;
+
+	// Every level lives in the same element buffer, one after the other
+	GLsizei count = mesh->indexCount;
+	size_t firstIndex = 0;
+	if (lod < mesh->lods.size()){
+		count = (GLsizei)mesh->lods[lod].indexCount;
+		firstIndex = mesh->lods[lod].firstIndex;
+	}
+	size_t indexSize = mesh->indexType == GL_UNSIGNED_BYTE ? 1 : (mesh->indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+
+	// Draw the triangles !
+	counted_gl_call(glDrawElements(
+		GL_TRIANGLES,                    // mode
+		count,                           // count
+		mesh->indexType,                 // type
+		(void*)(firstIndex * indexSize)  // element array buffer offset
+	));
+}
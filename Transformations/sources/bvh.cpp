@@ -0,0 +1,355 @@
+#include <float.h>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bvh.hpp"
+
+// SAH split candidates per axis
+#define BVH_BINS 12
+// Cost of visiting a node against testing one item, for the SAH
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_ITEM_COST 1.0f
+// Leaves are not split below this many items
+#define BVH_MIN_LEAF_SIZE 2
+// needsRebuild once the cost grows past this factor of the built tree's
+#define BVH_REBUILD_FACTOR 2.0f
+
+static float surfaceArea(const glm::vec3 & boundsMin, const glm::vec3 & boundsMax){
+	glm::vec3 e = glm::max(boundsMax - boundsMin, glm::vec3(0, 0, 0));
+	return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+bool aabbOutsidePlane(const Aabb & box, const glm::vec4 & plane){
+	// the corner furthest along the plane normal
+	glm::vec3 corner(plane.x >= 0 ? box.max.x : box.min.x, plane.y >= 0 ? box.max.y : box.min.y, plane.z >= 0 ? box.max.z : box.min.z);
+	return plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0;
+}
+
+// The corner least along the normal is in front : the whole box is
+static bool aabbInsidePlane(const glm::vec3 & boundsMin, const glm::vec3 & boundsMax, const glm::vec4 & plane){
+	glm::vec3 corner(plane.x >= 0 ? boundsMin.x : boundsMax.x, plane.y >= 0 ? boundsMin.y : boundsMax.y, plane.z >= 0 ? boundsMin.z : boundsMax.z);
+	return plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w >= 0;
+}
+
+bool aabbInFrustum(const Aabb & box, const glm::vec4 planes[6]){
+	for (int p = 0; p < 6; p++)
+		if (aabbOutsidePlane(box, planes[p]))
+			return false;
+	return true;
+}
+
+bool aabbOverlapsSphere(const Aabb & box, const glm::vec3 & center, float radius){
+	glm::vec3 d = center - glm::clamp(center, box.min, box.max);
+	return glm::dot(d, d) <= radius * radius;
+}
+
+bool aabbHitByRay(const Aabb & box, const glm::vec3 & origin, const glm::vec3 & inverseDirection, float maxDistance, float & out_entry){
+	glm::vec3 t0 = (box.min - origin) * inverseDirection;
+	glm::vec3 t1 = (box.max - origin) * inverseDirection;
+	glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+	float entry = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+	float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+	out_entry = entry;
+	return entry <= exit;
+}
+
+static void setBounds(BvhNode & node, const std::vector<Aabb> & itemBoxes){
+	node.boundsMin = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (unsigned int i = node.first; i < node.first + node.count; i++){
+		node.boundsMin = glm::min(node.boundsMin, itemBoxes[i].min);
+		node.boundsMax = glm::max(node.boundsMax, itemBoxes[i].max);
+	}
+}
+
+void Bvh::build(const std::vector<Aabb> & boxes){
+	unsigned int count = (unsigned int)boxes.size();
+	nodes.clear();
+	items.resize(count);
+	itemBoxes = boxes;
+	std::vector<glm::vec3> centroids(count);
+	for (unsigned int i = 0; i < count; i++){
+		items[i] = i;
+		centroids[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+	}
+	buildCost = 0;
+	if (count == 0)
+		return;
+
+	nodes.reserve(count * 2);
+	BvhNode root;
+	root.first = 0;
+	root.count = count;
+	setBounds(root, itemBoxes);
+	nodes.push_back(root);
+	// depth first, the nodes still to split
+	std::vector<unsigned int> stack(1, 0);
+	while (!stack.empty()){
+		unsigned int node = stack.back();
+		stack.pop_back();
+		if (split(node, centroids)){
+			stack.push_back(nodes[node].first);
+			stack.push_back(nodes[node].first + 1);
+		}
+	}
+	buildCost = cost();
+}
+
+bool Bvh::split(unsigned int node, std::vector<glm::vec3> & centroids){
+	BvhNode parent = nodes[node];
+	if (parent.count <= BVH_MIN_LEAF_SIZE)
+		return false;
+
+	glm::vec3 centroidMin(FLT_MAX, FLT_MAX, FLT_MAX), centroidMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (unsigned int i = parent.first; i < parent.first + parent.count; i++){
+		centroidMin = glm::min(centroidMin, centroids[i]);
+		centroidMax = glm::max(centroidMax, centroids[i]);
+	}
+
+	// Cheapest plane over the bins of every axis
+	float bestCost = parent.count * BVH_ITEM_COST * surfaceArea(parent.boundsMin, parent.boundsMax); // as a leaf
+	int bestAxis = -1, bestBin = 0;
+	for (int axis = 0; axis < 3; axis++){
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0)
+			continue;
+		float toBin = BVH_BINS / extent;
+		unsigned int binCount[BVH_BINS] = {0};
+		glm::vec3 binMin[BVH_BINS], binMax[BVH_BINS];
+		for (int b = 0; b < BVH_BINS; b++){
+			binMin[b] = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+			binMax[b] = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		}
+		for (unsigned int i = parent.first; i < parent.first + parent.count; i++){
+			int b = glm::min((int)((centroids[i][axis] - centroidMin[axis]) * toBin), BVH_BINS - 1);
+			binCount[b]++;
+			binMin[b] = glm::min(binMin[b], itemBoxes[i].min);
+			binMax[b] = glm::max(binMax[b], itemBoxes[i].max);
+		}
+		// sweep from the right, then from the left : cost of splitting after bin b
+		float rightArea[BVH_BINS];
+		unsigned int rightCount[BVH_BINS];
+		glm::vec3 sweepMin(FLT_MAX, FLT_MAX, FLT_MAX), sweepMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		unsigned int sweepCount = 0;
+		for (int b = BVH_BINS - 1; b > 0; b--){
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+			sweepCount += binCount[b];
+			rightArea[b] = surfaceArea(sweepMin, sweepMax);
+			rightCount[b] = sweepCount;
+		}
+		sweepMin = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+		sweepMax = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		sweepCount = 0;
+		for (int b = 0; b < BVH_BINS - 1; b++){
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+			sweepCount += binCount[b];
+			if (sweepCount == 0 || rightCount[b + 1] == 0)
+				continue;
+			float splitCost = BVH_TRAVERSAL_COST * surfaceArea(parent.boundsMin, parent.boundsMax)
+				+ BVH_ITEM_COST * (sweepCount * surfaceArea(sweepMin, sweepMax) + rightCount[b + 1] * rightArea[b + 1]);
+			if (splitCost < bestCost){
+				bestCost = splitCost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+	if (bestAxis < 0)
+		return false;
+
+	// Partition items (and their boxes) around the plane
+	float toBin = BVH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+	unsigned int left = parent.first, right = parent.first + parent.count;
+	while (left < right){
+		int b = glm::min((int)((centroids[left][bestAxis] - centroidMin[bestAxis]) * toBin), BVH_BINS - 1);
+		if (b <= bestBin)
+			left++;
+		else {
+			right--;
+			std::swap(items[left], items[right]);
+			std::swap(itemBoxes[left], itemBoxes[right]);
+			std::swap(centroids[left], centroids[right]);
+		}
+	}
+
+	BvhNode children[2];
+	children[0].first = parent.first;
+	children[0].count = left - parent.first;
+	children[1].first = left;
+	children[1].count = parent.count - children[0].count;
+	setBounds(children[0], itemBoxes);
+	setBounds(children[1], itemBoxes);
+	nodes[node].first = (unsigned int)nodes.size();
+	nodes[node].count = 0;
+	nodes.push_back(children[0]);
+	nodes.push_back(children[1]);
+	return true;
+}
+
+void Bvh::refit(const std::vector<Aabb> & boxes){
+	for (size_t i = 0; i < items.size(); i++)
+		itemBoxes[i] = boxes[items[i]];
+	for (size_t n = nodes.size(); n-- > 0;){
+		BvhNode & node = nodes[n];
+		if (node.count > 0)
+			setBounds(node, itemBoxes);
+		else {
+			const BvhNode & a = nodes[node.first];
+			const BvhNode & b = nodes[node.first + 1];
+			node.boundsMin = glm::min(a.boundsMin, b.boundsMin);
+			node.boundsMax = glm::max(a.boundsMax, b.boundsMax);
+		}
+	}
+}
+
+float Bvh::cost() const{
+	if (nodes.empty())
+		return 0;
+	float rootArea = surfaceArea(nodes[0].boundsMin, nodes[0].boundsMax);
+	if (rootArea <= 0)
+		return (float)items.size() * BVH_ITEM_COST;
+	float total = 0;
+	for (size_t n = 0; n < nodes.size(); n++){
+		const BvhNode & node = nodes[n];
+		float area = surfaceArea(node.boundsMin, node.boundsMax);
+		total += area * (node.count > 0 ? node.count * BVH_ITEM_COST : BVH_TRAVERSAL_COST);
+	}
+	return total / rootArea;
+}
+
+bool Bvh::needsRebuild() const{
+	return buildCost > 0 && cost() > buildCost * BVH_REBUILD_FACTOR;
+}
+
+void Bvh::queryFrustum(const glm::vec4 planes[6], std::vector<unsigned int> & out_items) const{
+	if (nodes.empty())
+		return;
+	// each entry carries the planes its box still straddles ; once none is left the whole subtree is inside
+	std::vector<std::pair<unsigned int, unsigned int> > stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(0u, 0x3fu));
+	while (!stack.empty()){
+		const BvhNode & node = nodes[stack.back().first];
+		unsigned int planeMask = stack.back().second;
+		stack.pop_back();
+		if (planeMask != 0){
+			Aabb box = {node.boundsMin, node.boundsMax};
+			bool outside = false;
+			for (int p = 0; p < 6 && !outside; p++){
+				if (!(planeMask & (1u << p)))
+					continue;
+				if (aabbOutsidePlane(box, planes[p]))
+					outside = true;
+				else if (aabbInsidePlane(node.boundsMin, node.boundsMax, planes[p]))
+					planeMask &= ~(1u << p);
+			}
+			if (outside)
+				continue;
+		}
+		if (node.count == 0){
+			stack.push_back(std::make_pair(node.first + 1, planeMask));
+			stack.push_back(std::make_pair(node.first, planeMask));
+			continue;
+		}
+		for (unsigned int i = node.first; i < node.first + node.count; i++)
+			if (planeMask == 0 || aabbInFrustum(itemBoxes[i], planes))
+				out_items.push_back(items[i]);
+	}
+}
+
+void Bvh::queryRay(const glm::vec3 & origin, const glm::vec3 & direction, float maxDistance, std::vector<unsigned int> & out_items) const{
+	if (nodes.empty())
+		return;
+	glm::vec3 inverseDirection = 1.0f / direction;
+	float entry;
+	std::vector<unsigned int> stack(1, 0);
+	while (!stack.empty()){
+		const BvhNode & node = nodes[stack.back()];
+		stack.pop_back();
+		Aabb box = {node.boundsMin, node.boundsMax};
+		if (!aabbHitByRay(box, origin, inverseDirection, maxDistance, entry))
+			continue;
+		if (node.count == 0){
+			stack.push_back(node.first + 1);
+			stack.push_back(node.first);
+			continue;
+		}
+		for (unsigned int i = node.first; i < node.first + node.count; i++)
+			if (aabbHitByRay(itemBoxes[i], origin, inverseDirection, maxDistance, entry))
+				out_items.push_back(items[i]);
+	}
+}
+
+int Bvh::raycast(const glm::vec3 & origin, const glm::vec3 & direction, float maxDistance, float & out_distance) const{
+	int best = -1;
+	float bestDistance = maxDistance;
+	if (nodes.empty())
+		return best;
+	glm::vec3 inverseDirection = 1.0f / direction;
+	float entry;
+	// nodes with the distance the ray enters them : the nearer child is visited first, and
+	// nothing entered past the best hit so far can hold a nearer one
+	std::vector<std::pair<unsigned int, float> > stack;
+	stack.reserve(64);
+	Aabb rootBox = {nodes[0].boundsMin, nodes[0].boundsMax};
+	if (aabbHitByRay(rootBox, origin, inverseDirection, maxDistance, entry))
+		stack.push_back(std::make_pair(0u, entry));
+	while (!stack.empty()){
+		unsigned int n = stack.back().first;
+		float nodeEntry = stack.back().second;
+		stack.pop_back();
+		if (nodeEntry > bestDistance)
+			continue;
+		const BvhNode & node = nodes[n];
+		if (node.count > 0){
+			for (unsigned int i = node.first; i < node.first + node.count; i++){
+				if (!aabbHitByRay(itemBoxes[i], origin, inverseDirection, bestDistance, entry))
+					continue;
+				// equal distances go to the lowest item, as a linear scan would
+				if (best < 0 || entry < bestDistance || (entry == bestDistance && items[i] < (unsigned int)best)){
+					best = (int)items[i];
+					bestDistance = entry;
+				}
+			}
+			continue;
+		}
+		float entries[2];
+		bool hits[2];
+		for (int c = 0; c < 2; c++){
+			Aabb box = {nodes[node.first + c].boundsMin, nodes[node.first + c].boundsMax};
+			hits[c] = aabbHitByRay(box, origin, inverseDirection, bestDistance, entries[c]);
+		}
+		int nearer = hits[1] && (!hits[0] || entries[1] < entries[0]) ? 1 : 0;
+		if (hits[1 - nearer])
+			stack.push_back(std::make_pair(node.first + 1 - nearer, entries[1 - nearer]));
+		if (hits[nearer])
+			stack.push_back(std::make_pair(node.first + nearer, entries[nearer]));
+	}
+	out_distance = bestDistance;
+	return best;
+}
+
+void Bvh::querySphere(const glm::vec3 & center, float radius, std::vector<unsigned int> & out_items) const{
+	if (nodes.empty())
+		return;
+	std::vector<unsigned int> stack(1, 0);
+	while (!stack.empty()){
+		const BvhNode & node = nodes[stack.back()];
+		stack.pop_back();
+		Aabb box = {node.boundsMin, node.boundsMax};
+		if (!aabbOverlapsSphere(box, center, radius))
+			continue;
+		if (node.count == 0){
+			stack.push_back(node.first + 1);
+			stack.push_back(node.first);
+			continue;
+		}
+		for (unsigned int i = node.first; i < node.first + node.count; i++)
+			if (aabbOverlapsSphere(itemBoxes[i], center, radius))
+				out_items.push_back(items[i]);
+	}
+}
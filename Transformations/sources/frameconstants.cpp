@@ -0,0 +1,40 @@
+#include <stddef.h>
+
+#include <GL/glew.h>
+
+#include "frameconstants.hpp"
+#include "glstate.hpp"
+#include "glerror.hpp"
+
+// The offsets the std140 block has
+static_assert(offsetof(FrameConstants, viewPos) == 192, "FrameConstants does not match the std140 block");
+static_assert(offsetof(FrameConstants, lightCount) == 204, "FrameConstants does not match the std140 block");
+static_assert(offsetof(FrameConstants, lights) == 208, "FrameConstants does not match the std140 block");
+static_assert(sizeof(FrameLight) == 64, "FrameLight does not match the std140 struct");
+
+static GLuint frameConstantsBuffer = 0;
+
+void initFrameConstants(){
+	glGenBuffers(1, &frameConstantsBuffer);
+	glStateBindBuffer(GL_UNIFORM_BUFFER, frameConstantsBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), NULL, GL_DYNAMIC_DRAW);
+	// also binds the generic GL_UNIFORM_BUFFER point, to the buffer glstate.hpp already has there
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAMECONSTANTS_BINDING, frameConstantsBuffer);
+}
+
+void bindFrameConstantsBlock(GLuint programID){
+	GLuint blockIndex = glGetUniformBlockIndex(programID, "FrameConstants");
+	if (blockIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(programID, blockIndex, FRAMECONSTANTS_BINDING);
+}
+
+void uploadFrameConstants(const FrameConstants & constants){
+	glStateBindBuffer(GL_UNIFORM_BUFFER, frameConstantsBuffer);
+	// a whole new store : the draws of the last frame may still read the old one
+	counted_gl_call(glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), &constants, GL_DYNAMIC_DRAW));
+}
+
+void cleanupFrameConstants(){
+	glStateDeleteBuffers(1, &frameConstantsBuffer);
+	frameConstantsBuffer = 0;
+}
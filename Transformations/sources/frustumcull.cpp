@@ -0,0 +1,175 @@
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUMCULL_AVX
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUMCULL_SSE
+#endif
+
+#include <glm/glm.hpp>
+
+#include "frustumcull.hpp"
+#include "threadpool.hpp"
+
+// Spheres per job when a batch is split over the pool : big enough that scheduling stays in the noise
+#define CULL_CHUNK_SIZE 65536
+
+void computeBoundingSphere(const glm::vec3 * positions, size_t count, glm::vec3 & out_center, float & out_radius){
+	out_center = glm::vec3(0, 0, 0);
+	out_radius = 0.0f;
+	if (count == 0)
+		return;
+	glm::vec3 boundsMin = positions[0], boundsMax = positions[0];
+	for (size_t i = 1; i < count; i++){
+		boundsMin = glm::min(boundsMin, positions[i]);
+		boundsMax = glm::max(boundsMax, positions[i]);
+	}
+	out_center = (boundsMin + boundsMax) * 0.5f;
+	float radius2 = 0.0f;
+	for (size_t i = 0; i < count; i++){
+		glm::vec3 d = positions[i] - out_center;
+		radius2 = glm::max(radius2, glm::dot(d, d));
+	}
+	out_radius = sqrtf(radius2);
+}
+
+float maxScale(const glm::mat4 & matrix){
+	glm::vec3 axes[3] = {glm::vec3(matrix[0]), glm::vec3(matrix[1]), glm::vec3(matrix[2])};
+	float largest = 0.0f;
+	for (int i = 0; i < 3; i++){
+		float row = 0.0f;
+		for (int j = 0; j < 3; j++)
+			row += fabsf(glm::dot(axes[i], axes[j]));
+		largest = glm::max(largest, row);
+	}
+	return sqrtf(largest);
+}
+
+void extractFrustumPlanes(const glm::mat4 & viewProjection, glm::vec4 out_planes[6]){
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++)
+		row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	out_planes[0] = row[3] + row[0]; // left
+	out_planes[1] = row[3] - row[0]; // right
+	out_planes[2] = row[3] + row[1]; // bottom
+	out_planes[3] = row[3] - row[1]; // top
+	out_planes[4] = row[3] + row[2]; // near
+	out_planes[5] = row[3] - row[2]; // far
+	for (int i = 0; i < 6; i++)
+		out_planes[i] = out_planes[i] * (1.0f / glm::length(glm::vec3(out_planes[i])));
+}
+
+unsigned int cullSpheresScalar(const glm::vec4 planes[6], const SphereBounds & spheres, size_t begin, size_t end, unsigned char * out_visible){
+	unsigned int visible = 0;
+	for (size_t i = begin; i < end; i++){
+		bool inside = true;
+		for (int p = 0; p < 6; p++)
+			// summed in the same order as the SIMD paths, so both give the same answer on the boundary
+			inside = inside && (planes[p].x * spheres.x[i] + planes[p].y * spheres.y[i]) + (planes[p].z * spheres.z[i] + planes[p].w) >= -spheres.radius[i];
+		out_visible[i] = inside ? 1 : 0;
+		visible += inside ? 1 : 0;
+	}
+	return visible;
+}
+
+// Movemask bits -> one 0/1 byte per sphere, written with a single store
+struct MaskBytes{
+	unsigned long long bytes[256];
+	unsigned char bits[256];
+
+	MaskBytes(){
+		for (unsigned int mask = 0; mask < 256; mask++){
+			unsigned char expanded[8];
+			bits[mask] = 0;
+			for (int k = 0; k < 8; k++){
+				expanded[k] = (mask >> k) & 1;
+				bits[mask] += expanded[k];
+			}
+			memcpy(&bytes[mask], expanded, 8);
+		}
+	}
+};
+static const MaskBytes maskBytes;
+
+// Spheres [begin, end) : the SIMD loop, then the tail one at a time
+static unsigned int cullRange(const glm::vec4 planes[6], const SphereBounds & spheres, size_t begin, size_t end, unsigned char * out_visible){
+	const float * x = &spheres.x[0];
+	const float * y = &spheres.y[0];
+	const float * z = &spheres.z[0];
+	const float * r = &spheres.radius[0];
+	unsigned int visible = 0;
+	size_t i = begin;
+#if defined(FRUSTUMCULL_AVX)
+	__m256 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; p++){
+		px[p] = _mm256_set1_ps(planes[p].x);
+		py[p] = _mm256_set1_ps(planes[p].y);
+		pz[p] = _mm256_set1_ps(planes[p].z);
+		pw[p] = _mm256_set1_ps(planes[p].w);
+	}
+	for (; i + 8 <= end; i += 8){
+		__m256 cx = _mm256_loadu_ps(x + i), cy = _mm256_loadu_ps(y + i), cz = _mm256_loadu_ps(z + i);
+		__m256 minusRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(r + i));
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++){
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, px[p]), _mm256_mul_ps(cy, py[p])), _mm256_add_ps(_mm256_mul_ps(cz, pz[p]), pw[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, minusRadius, _CMP_GE_OQ));
+		}
+		int mask = _mm256_movemask_ps(inside);
+		memcpy(out_visible + i, &maskBytes.bytes[mask], 8);
+		visible += maskBytes.bits[mask];
+	}
+#elif defined(FRUSTUMCULL_SSE)
+	__m128 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; p++){
+		px[p] = _mm_set1_ps(planes[p].x);
+		py[p] = _mm_set1_ps(planes[p].y);
+		pz[p] = _mm_set1_ps(planes[p].z);
+		pw[p] = _mm_set1_ps(planes[p].w);
+	}
+	for (; i + 4 <= end; i += 4){
+		__m128 cx = _mm_loadu_ps(x + i), cy = _mm_loadu_ps(y + i), cz = _mm_loadu_ps(z + i);
+		__m128 minusRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(r + i));
+		__m128 inside = _mm_cmpeq_ps(minusRadius, minusRadius); // all ones, radii are never NaN
+		for (int p = 0; p < 6; p++){
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, px[p]), _mm_mul_ps(cy, py[p])), _mm_add_ps(_mm_mul_ps(cz, pz[p]), pw[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, minusRadius));
+		}
+		int mask = _mm_movemask_ps(inside);
+		memcpy(out_visible + i, &maskBytes.bytes[mask], 4);
+		visible += maskBytes.bits[mask];
+	}
+#endif
+	return visible + cullSpheresScalar(planes, spheres, i, end, out_visible);
+}
+
+CullStats cullSpheres(const glm::vec4 planes[6], const SphereBounds & spheres, std::vector<unsigned char> & out_visible, bool multithreaded){
+	size_t count = spheres.size();
+	out_visible.resize(count);
+	CullStats stats;
+	stats.visible = 0;
+	stats.culled = 0;
+	if (count == 0)
+		return stats;
+
+	unsigned int chunks = (unsigned int)((count + CULL_CHUNK_SIZE - 1) / CULL_CHUNK_SIZE);
+	if (!multithreaded || chunks == 1)
+		stats.visible = cullRange(planes, spheres, 0, count, &out_visible[0]);
+	else {
+		std::vector<unsigned int> visible(chunks);
+		unsigned char * out = &out_visible[0];
+		defaultThreadPool().parallelFor(chunks, [&](unsigned int chunk){
+			size_t begin = (size_t)chunk * CULL_CHUNK_SIZE;
+			size_t end = begin + CULL_CHUNK_SIZE < count ? begin + CULL_CHUNK_SIZE : count;
+			visible[chunk] = cullRange(planes, spheres, begin, end, out);
+		});
+		for (unsigned int chunk = 0; chunk < chunks; chunk++)
+			stats.visible += visible[chunk];
+	}
+	stats.culled = (unsigned int)count - stats.visible;
+	return stats;
+}
@@ -2,6 +2,8 @@
 
 using namespace std;
 
+unsigned int g_glCallCount = 0;
+
 void _check_gl_error(const char *file, int line) {
         GLenum err (glGetError());
 
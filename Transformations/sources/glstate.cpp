@@ -0,0 +1,247 @@
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include "glstate.hpp"
+#include "glerror.hpp"
+
+GlStateStats g_glStateStats = {0, 0};
+
+// Buffer targets shadowed, in the order of GlState::buffers
+static const GLenum bufferTargets[] = {GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GL_UNIFORM_BUFFER};
+#define GLSTATE_BUFFER_TARGETS (sizeof(bufferTargets) / sizeof(bufferTargets[0]))
+#define GLSTATE_ELEMENT_BUFFER 1
+
+// A shadowed value ; unknown until set through the layer
+struct Shadow{
+	GLuint value;
+	bool known;
+};
+
+// Enabled attributes of one vertex array : bit i of enabled is attribute i, meaningful where known has it
+struct AttribShadow{
+	unsigned int enabled;
+	unsigned int known;
+};
+
+static struct GlState{
+	Shadow program;
+	Shadow activeTexture;
+	Shadow textures[GLSTATE_TEXTURE_UNITS];
+	Shadow buffers[GLSTATE_BUFFER_TARGETS];
+	Shadow vertexArray;
+	Shadow blend, depthTest, cullFace;
+	Shadow blendSource, blendDestination, depthFunction, depthMask, cullMode;
+	std::unordered_map<GLuint, AttribShadow> attribs; // by vertex array
+} state;
+
+static void forget(Shadow & shadow){
+	shadow.known = false;
+}
+
+// True when value is new : the caller issues the call. Counts either way
+static bool update(Shadow & shadow, GLuint value){
+	if (shadow.known && shadow.value == value){
+		g_glStateStats.filtered++;
+		return false;
+	}
+	shadow.value = value;
+	shadow.known = true;
+	g_glStateStats.issued++;
+	return true;
+}
+
+static void passThrough(){
+	g_glStateStats.issued++;
+}
+
+void glStateInvalidate(){
+	forget(state.program);
+	forget(state.activeTexture);
+	for (int i = 0; i < GLSTATE_TEXTURE_UNITS; i++)
+		forget(state.textures[i]);
+	for (size_t i = 0; i < GLSTATE_BUFFER_TARGETS; i++)
+		forget(state.buffers[i]);
+	forget(state.vertexArray);
+	forget(state.blend);
+	forget(state.depthTest);
+	forget(state.cullFace);
+	forget(state.blendSource);
+	forget(state.blendDestination);
+	forget(state.depthFunction);
+	forget(state.depthMask);
+	forget(state.cullMode);
+	state.attribs.clear();
+}
+
+void glStateUseProgram(GLuint program){
+	if (update(state.program, program))
+		counted_gl_call(glUseProgram(program));
+}
+
+void glStateActiveTexture(GLenum unit){
+	if (update(state.activeTexture, unit))
+		counted_gl_call(glActiveTexture(unit));
+}
+
+void glStateBindTexture(GLenum target, GLuint texture){
+	GLuint unit = state.activeTexture.known ? state.activeTexture.value - GL_TEXTURE0 : GLSTATE_TEXTURE_UNITS;
+	if (target != GL_TEXTURE_2D || unit >= GLSTATE_TEXTURE_UNITS){
+		passThrough();
+		counted_gl_call(glBindTexture(target, texture));
+		return;
+	}
+	if (update(state.textures[unit], texture))
+		counted_gl_call(glBindTexture(target, texture));
+}
+
+static Shadow * bufferShadow(GLenum target){
+	for (size_t i = 0; i < GLSTATE_BUFFER_TARGETS; i++)
+		if (bufferTargets[i] == target)
+			return &state.buffers[i];
+	return NULL;
+}
+
+void glStateBindBuffer(GLenum target, GLuint buffer){
+	Shadow * shadow = bufferShadow(target);
+	if (shadow == NULL)
+		passThrough();
+	else if (!update(*shadow, buffer))
+		return;
+	counted_gl_call(glBindBuffer(target, buffer));
+}
+
+void glStateBindVertexArray(GLuint vertexArray){
+	if (!update(state.vertexArray, vertexArray))
+		return;
+	counted_gl_call(glBindVertexArray(vertexArray));
+	// the element buffer binding belongs to the vertex array
+	forget(state.buffers[GLSTATE_ELEMENT_BUFFER]);
+}
+
+// The attribute bits of the bound vertex array, or NULL when it is not known
+static AttribShadow * boundAttribs(){
+	if (!state.vertexArray.known)
+		return NULL;
+	AttribShadow & attribs = state.attribs[state.vertexArray.value];
+	return &attribs;
+}
+
+static bool updateAttrib(GLuint index, bool enable){
+	AttribShadow * attribs = boundAttribs();
+	if (attribs == NULL || index >= 32){
+		passThrough();
+		return true;
+	}
+	unsigned int bit = 1u << index;
+	if ((attribs->known & bit) && ((attribs->enabled & bit) != 0) == enable){
+		g_glStateStats.filtered++;
+		return false;
+	}
+	attribs->known |= bit;
+	attribs->enabled = enable ? attribs->enabled | bit : attribs->enabled & ~bit;
+	g_glStateStats.issued++;
+	return true;
+}
+
+void glStateEnableVertexAttribArray(GLuint index){
+	if (updateAttrib(index, true))
+		counted_gl_call(glEnableVertexAttribArray(index));
+}
+
+void glStateDisableVertexAttribArray(GLuint index){
+	if (updateAttrib(index, false))
+		counted_gl_call(glDisableVertexAttribArray(index));
+}
+
+static Shadow * capabilityShadow(GLenum capability){
+	switch (capability){
+		case GL_BLEND: return &state.blend;
+		case GL_DEPTH_TEST: return &state.depthTest;
+		case GL_CULL_FACE: return &state.cullFace;
+	}
+	return NULL;
+}
+
+void glStateEnable(GLenum capability){
+	Shadow * shadow = capabilityShadow(capability);
+	if (shadow == NULL)
+		passThrough();
+	else if (!update(*shadow, GL_TRUE))
+		return;
+	counted_gl_call(glEnable(capability));
+}
+
+void glStateDisable(GLenum capability){
+	Shadow * shadow = capabilityShadow(capability);
+	if (shadow == NULL)
+		passThrough();
+	else if (!update(*shadow, GL_FALSE))
+		return;
+	counted_gl_call(glDisable(capability));
+}
+
+void glStateBlendFunc(GLenum source, GLenum destination){
+	if (state.blendSource.known && state.blendDestination.known && state.blendSource.value == source && state.blendDestination.value == destination){
+		g_glStateStats.filtered++;
+		return;
+	}
+	state.blendSource.value = source;
+	state.blendDestination.value = destination;
+	state.blendSource.known = state.blendDestination.known = true;
+	g_glStateStats.issued++;
+	counted_gl_call(glBlendFunc(source, destination));
+}
+
+void glStateDepthFunc(GLenum function){
+	if (update(state.depthFunction, function))
+		counted_gl_call(glDepthFunc(function));
+}
+
+void glStateDepthMask(GLboolean mask){
+	if (update(state.depthMask, mask))
+		counted_gl_call(glDepthMask(mask));
+}
+
+void glStateCullFace(GLenum mode){
+	if (update(state.cullMode, mode))
+		counted_gl_call(glCullFace(mode));
+}
+
+// A deleted name bound somewhere reads as 0 afterwards
+static void unbind(Shadow & shadow, GLuint name){
+	if (shadow.known && shadow.value == name)
+		shadow.value = 0;
+}
+
+void glStateDeleteProgram(GLuint program){
+	// a program in use is only flagged for deletion and stays bound : forgetting it is enough
+	if (state.program.known && state.program.value == program)
+		forget(state.program);
+	counted_gl_call(glDeleteProgram(program));
+}
+
+void glStateDeleteTextures(GLsizei count, const GLuint * textures){
+	for (GLsizei i = 0; i < count; i++)
+		for (int unit = 0; unit < GLSTATE_TEXTURE_UNITS; unit++)
+			unbind(state.textures[unit], textures[i]);
+	counted_gl_call(glDeleteTextures(count, textures));
+}
+
+void glStateDeleteBuffers(GLsizei count, const GLuint * buffers){
+	for (GLsizei i = 0; i < count; i++)
+		for (size_t target = 0; target < GLSTATE_BUFFER_TARGETS; target++)
+			unbind(state.buffers[target], buffers[i]);
+	counted_gl_call(glDeleteBuffers(count, buffers));
+}
+
+void glStateDeleteVertexArrays(GLsizei count, const GLuint * vertexArrays){
+	for (GLsizei i = 0; i < count; i++){
+		if (state.vertexArray.known && state.vertexArray.value == vertexArrays[i]){
+			state.vertexArray.value = 0;
+			forget(state.buffers[GLSTATE_ELEMENT_BUFFER]);
+		}
+		state.attribs.erase(vertexArrays[i]);
+	}
+	counted_gl_call(glDeleteVertexArrays(count, vertexArrays));
+}
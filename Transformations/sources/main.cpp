@@ -30,17 +30,49 @@ using namespace glm;
 #include <objloader.hpp>
 #include <vboindexer.hpp>
 #include <glerror.hpp>
+#include <glstate.hpp>
+#include <frameconstants.hpp>
+#include <frustumcull.hpp>
+#include <bvh.hpp>
+#include <renderqueue.hpp>
 
 #include "Model.hpp"
 #include "Transformations.h"
 #include "KeyboardHandles.h"
 
+// Models drawn and skipped by the frustum test of the last frame
+CullStats g_cullStats = {0, 0};
+
+// World boxes of my_models, refit by draw when they move ; frustum culling and picking query it
+Bvh g_sceneBvh;
+std::vector<Aabb> g_sceneBoxes;
+
+// The visible models of a frame in sort key order, and the binds the walk really issued
+RenderQueue g_renderQueue;
+RenderStateTracker g_renderState;
+
+// Depth range of the sort keys : the far plane of getProjectionMatrix
+#define SORT_FAR_DEPTH 100.0f
+
+// The model under the cursor, -1 if none : a ray from the eye through the pixel, against the scene BVH
+int pickModel(double cursorX, double cursorY){
+	glm::vec2 ndc((float)(2.0 * cursorX / g_nWidth - 1.0), (float)(1.0 - 2.0 * cursorY / g_nHeight));
+	glm::mat4 inverseViewProjection = glm::inverse(getProjectionMatrix() * getViewMatrix());
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+	glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+	glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - origin;
+	float distance;
+	return g_sceneBvh.raycast(origin, direction, 1.0f, distance);
+}
+
 
 
 void draw(
 	std::vector<Model> &my_models,
 	int nUseMouse, int nbFrames, double lastTime,
-	GLuint MatrixID, GLuint ViewMatrixID, GLuint ModelMatrixID, GLuint LightID, GLuint Texture, GLuint TextureID, GLuint programID
+	GLuint ModelMatrixID, GLuint Texture, GLuint TextureID, GLuint programID,
+	GLuint PositionScaleID, GLuint PositionOffsetID
 );
 
 
@@ -116,23 +148,23 @@ int main(void)
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
 
 	// Enable depth test
-	glEnable(GL_DEPTH_TEST);
+	glStateEnable(GL_DEPTH_TEST);
 	// Accept fragment if it closer to the camera than the former one
-	glDepthFunc(GL_LESS);
+	glStateDepthFunc(GL_LESS);
 
 	// Cull triangles which normal is not towards the camera
-	glEnable(GL_CULL_FACE);
+	glStateEnable(GL_CULL_FACE);
 
-	GLuint VertexArrayID;
-	glGenVertexArrays(1, &VertexArrayID);
-	glBindVertexArray(VertexArrayID);
-
-	// Create and compile our GLSL program from the shaders
+	// Create and compile our GLSL program from the shaders ; from the second run on, the program cache skips the compile
+	double shaderStartTime = glfwGetTime();
 	GLuint programID = LoadShaders("shaders/StandardShading.vertexshader", "shaders/StandardShading.fragmentshader");
+	printf("Shaders ready in %.1f ms\n", (glfwGetTime() - shaderStartTime) * 1000.0);
+
+	// View, projection and lights come from one uniform buffer per frame (frameconstants.hpp)
+	initFrameConstants();
+	bindFrameConstantsBlock(programID);
 
-	// Get a handle for our "MVP" uniform
-	GLuint MatrixID = glGetUniformLocation(programID, "MVP");
-	GLuint ViewMatrixID = glGetUniformLocation(programID, "V");
+	// Get a handle for our "M" uniform, the only matrix sent per model
 	GLuint ModelMatrixID = glGetUniformLocation(programID, "M");
 
 	// Load the texture
@@ -142,10 +174,11 @@ int main(void)
 	GLuint TextureID = glGetUniformLocation(programID, "myTextureSampler");
 
 
+	glStateUseProgram(programID);
 
-	// Get a handle for our "LightPosition" uniform
-	glUseProgram(programID);
-	GLuint LightID = glGetUniformLocation(programID, "LightPosition_worldspace");
+	// Get a handle for the position decoding of quantized meshes
+	GLuint PositionScaleID = glGetUniformLocation(programID, "PositionScale");
+	GLuint PositionOffsetID = glGetUniformLocation(programID, "PositionOffset");
 
 	// For speed computation
 	double lastTime = glfwGetTime();
@@ -153,28 +186,39 @@ int main(void)
 
 	std::vector<Model> my_models;
 	
-	//creates examples
-	Model * su = new Model("mesh/cube.obj", glm::vec3(6, 0, 0));
-	Model * su2 = new Model("mesh/suzanne.obj", glm::vec3(0, 0, 0));
-	Model * su3 = new Model("mesh/suzanne.obj", glm::vec3(-4, 0, 0));
+	//creates examples ; su2 and su3 share the same suzanne mesh
+	{
+		Model su("mesh/cube.obj", glm::vec3(6, 0, 0));
+		Model su2("mesh/suzanne.obj", glm::vec3(0, 0, 0));
+		Model su3("mesh/suzanne.obj", glm::vec3(-4, 0, 0));
 
-	su->anim_init_time = glfwGetTime(); su->translate = false; su->rotate = false; su->isExample = true; su->rotate_about = true;
-	su->finalPos = glm::vec3(6, 0, 0);
-	
-	su2->isExample = true; su2->rotate = true; su2->translate = true;
-	su2->anim_init_time = glfwGetTime();
+		su.anim_init_time = glfwGetTime(); su.translate = false; su.rotate = false; su.isExample = true; su.rotate_about = true;
+		su.finalPos = glm::vec3(6, 0, 0);
+
+		su2.isExample = true; su2.rotate = true; su2.translate = true;
+		su2.anim_init_time = glfwGetTime();
 
-	su3->isExample = true; su3->scaling = true; su3->scale = 1;
+		su3.isExample = true; su3.scaling = true; su3.scale = 1;
 
-	my_models.push_back(*su);
-	my_models.push_back(*su2);
-	my_models.push_back(*su3);
+		my_models.push_back(su);
+		my_models.push_back(su2);
+		my_models.push_back(su3);
+	}
 	int selected_model = 0;
 	do {
 
 		//printf("My model size: %uz", my_models.size());
 
 		handle_input(&selected_model, my_models, lastTime);
+
+		// with the mouse freed, a click selects the model under the cursor
+		if (nUseMouse == 0 && glfwGetMouseButton(g_pWindow, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+			double cursorX, cursorY;
+			glfwGetCursorPos(g_pWindow, &cursorX, &cursorY);
+			int picked = pickModel(cursorX, cursorY);
+			if (picked >= 0 && picked < (int)my_models.size())
+				selected_model = picked;
+		}
 		printf("Current model: %d\n", selected_model);
 		
 
@@ -193,17 +237,23 @@ int main(void)
 		if (currentTime - lastTime >= 1.0) { // If last prinf() was more than 1sec ago
 			// printf and reset
 			//printf("%f ms/frame\n", 1000.0 / double(nbFrames));
+			printf("%u GL calls/frame (%u state calls issued, %u filtered), %u state changes, %u models visible, %u culled\n", g_glCallCount,
+				g_glStateStats.issued, g_glStateStats.filtered, g_renderState.stateChanges, g_cullStats.visible, g_cullStats.culled);
 			nbFrames = 0;
 			lastTime += 1.0;
 		}
 
-		draw(my_models,nUseMouse, nbFrames, lastTime, MatrixID, ViewMatrixID, ModelMatrixID,
-			LightID, Texture, TextureID, programID);
+		// Upload meshes that finished loading in the background, 2 ms per frame at most
+		pumpMeshUploads(0.002);
+
+		draw(my_models,nUseMouse, nbFrames, lastTime, ModelMatrixID,
+			Texture, TextureID, programID, PositionScaleID, PositionOffsetID);
 
 
 
-		// Draw tweak bars
+		// Draw tweak bars ; they set their own GL state, so the shadow of glstate.hpp is stale afterwards
 		TwDraw();
+		glStateInvalidate();
 
 		// Swap buffers
 		glfwSwapBuffers(g_pWindow);
@@ -213,9 +263,11 @@ int main(void)
 		glfwWindowShouldClose(g_pWindow) == 0);
 
 
-	glDeleteProgram(programID);
-	glDeleteTextures(1, &Texture);
-	glDeleteVertexArrays(1, &VertexArrayID);
+	// Drop the last mesh handles while the GL context is still alive
+	my_models.clear();
+	glStateDeleteProgram(programID);
+	glStateDeleteTextures(1, &Texture);
+	cleanupFrameConstants();
 
 	// Terminate AntTweakBar and GLFW
 	TwTerminate();
@@ -228,13 +280,16 @@ int main(void)
 void draw(
 	std::vector<Model> &my_models,
 	int nUseMouse, int nbFrames, double lastTime,
-	GLuint MatrixID, GLuint ViewMatrixID, GLuint ModelMatrixID, GLuint LightID, GLuint Texture, GLuint TextureID, GLuint programID
+	GLuint ModelMatrixID, GLuint Texture, GLuint TextureID, GLuint programID,
+	GLuint PositionScaleID, GLuint PositionOffsetID
 ) {
-	// Clear the screen
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// Count the GL calls of this frame (see glerror.hpp), and how many state calls the shadow dropped (glstate.hpp)
+	g_glCallCount = 0;
+	g_glStateStats.issued = 0;
+	g_glStateStats.filtered = 0;
 
-	// Use our shader
-	glUseProgram(programID);
+	// Clear the screen
+	counted_gl_call(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
 	for (int i = 0; i < my_models.size(); ++i) {
 
@@ -375,85 +430,125 @@ void draw(
 
 			}
 		}
+	}
 
+	// Compute the MVP matrix from keyboard and mouse input
+	computeMatricesFromInputs(nUseMouse, g_nWidth, g_nHeight);
+	glm::mat4 ProjectionMatrix = getProjectionMatrix();
+	glm::mat4 ViewMatrix = getViewMatrix();
+
+	// Keep the scene BVH on the models' world boxes (the cubes around their bounding spheres) : refit
+	// when some of them moved, build again when models were added or the refits have worn the tree out
+	size_t builtCount = g_sceneBoxes.size();
+	bool moved = false;
+	g_sceneBoxes.resize(my_models.size());
+	for (size_t i = 0; i < my_models.size(); ++i) {
+		glm::vec3 center;
+		float radius;
+		my_models[i].worldBounds(center, radius);
+		Aabb box;
+		box.min = center - glm::vec3(radius, radius, radius);
+		box.max = center + glm::vec3(radius, radius, radius);
+		if (box.min != g_sceneBoxes[i].min || box.max != g_sceneBoxes[i].max) {
+			g_sceneBoxes[i] = box;
+			moved = true;
+		}
+	}
+	if (builtCount != g_sceneBoxes.size())
+		g_sceneBvh.build(g_sceneBoxes);
+	else if (moved) {
+		g_sceneBvh.refit(g_sceneBoxes);
+		if (g_sceneBvh.needsRebuild())
+			g_sceneBvh.build(g_sceneBoxes);
+	}
 
+	// Skip the models entirely outside the view : the BVH visits only the subtrees that touch the frustum,
+	// and the models it returns have their bounding spheres tested in SIMD batches (cullSpheres), which
+	// drops the ones only their box corners reach into the view
+	static std::vector<unsigned int> inView;
+	static SphereBounds candidates;
+	static std::vector<unsigned char> candidateVisible;
+	static std::vector<unsigned char> visible;
+	glm::vec4 planes[6];
+	extractFrustumPlanes(ProjectionMatrix * ViewMatrix, planes);
+	inView.clear();
+	g_sceneBvh.queryFrustum(planes, inView);
+	candidates.resize(inView.size());
+	for (size_t i = 0; i < inView.size(); ++i) {
+		const Aabb & box = g_sceneBoxes[inView[i]];
+		candidates.set(i, (box.min + box.max) * 0.5f, (box.max.x - box.min.x) * 0.5f);
+	}
+	g_cullStats = cullSpheres(planes, candidates, candidateVisible);
+	g_cullStats.culled = (unsigned int)(my_models.size() - g_cullStats.visible);
+	visible.assign(my_models.size(), 0);
+	for (size_t i = 0; i < inView.size(); ++i)
+		visible[inView[i]] = candidateVisible[i];
+
+	// Queue the visible models under their sort keys : models sharing a mesh end up together, front to back
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(ViewMatrix)[3]);
+	g_renderQueue.clear();
+	for (size_t i = 0; i < my_models.size(); ++i) {
+		if (!visible[i] || !my_models[i].mesh->ready)
+			continue;
+
+		// Coarser level of detail when the model is small on screen
+		my_models[i].selectLod(cameraPosition, ProjectionMatrix[1][1] * g_nHeight * 0.5f);
+
+		glm::vec3 center = (g_sceneBoxes[i].min + g_sceneBoxes[i].max) * 0.5f;
+		g_renderQueue.push(makeSortKey(RENDER_PASS_OPAQUE, programID, Texture, my_models[i].mesh->vertexArray,
+			glm::length(center - cameraPosition), SORT_FAR_DEPTH), (unsigned int)i);
+	}
+	g_renderQueue.sort();
+
+	// Camera and light for every program of the frame, in one upload
+	FrameConstants frame;
+	frame.view = ViewMatrix;
+	frame.projection = ProjectionMatrix;
+	frame.viewProjection = ProjectionMatrix * ViewMatrix;
+	frame.viewPos = cameraPosition;
+	frame.lightCount = 1;
+	frame.lights[0].position = glm::vec4(4, 4, 4, 1);
+	frame.lights[0].ambient = glm::vec4(0.1f, 0.1f, 0.1f, 0);
+	frame.lights[0].diffuse = glm::vec4(1, 1, 1, 0);
+	frame.lights[0].specular = glm::vec4(1, 1, 1, 0);
+	uploadFrameConstants(frame);
+
+	// Walk the queue : program, texture and mesh state only when they change. The tweak bar draws
+	// in between frames, so the walk starts from unknown state
+	g_renderState.reset();
+	for (size_t p = 0; p < g_renderQueue.size(); ++p) {
+		const Model & model = my_models[g_renderQueue[p].item];
+		const GpuMesh & mesh = *model.mesh;
+
+		if (g_renderState.useProgram(programID)) {
+			// Use our shader ; the view and the light are in the frame constants already
+			glStateUseProgram(programID);
+			// Set our "myTextureSampler" sampler to user Texture Unit 0
+			counted_gl_call(glUniform1i(TextureID, 0));
+		}
 
-		
+		if (g_renderState.bindMaterial(Texture)) {
+			// Bind our texture in Texture Unit 0
+			glStateActiveTexture(GL_TEXTURE0);
+			glStateBindTexture(GL_TEXTURE_2D, Texture);
+		}
 
-		// Compute the MVP matrix from keyboard and mouse input
-		computeMatricesFromInputs(nUseMouse, g_nWidth, g_nHeight);
-		glm::mat4 ProjectionMatrix = getProjectionMatrix();
-		glm::mat4 ViewMatrix = getViewMatrix();
-		//glm::mat4 ModelMatrix = glm::mat4(1.0);
-		glm::mat4 ModelMatrix = my_models[i].modelMatrix;
-		glm::mat4 MVP = ProjectionMatrix * ViewMatrix * ModelMatrix;
-
-		// Send our transformation to the currently bound shader,
-		// in the "MVP" uniform
-		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-		glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrix[0][0]);
-		glUniformMatrix4fv(ViewMatrixID, 1, GL_FALSE, &ViewMatrix[0][0]);
-
-		glm::vec3 lightPos = glm::vec3(4, 4, 4);
-		glUniform3f(LightID, lightPos.x, lightPos.y, lightPos.z);
-
-		// Bind our texture in Texture Unit 0
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, Texture);
-		// Set our "myTextureSampler" sampler to user Texture Unit 0
-		glUniform1i(TextureID, 0);
-
-		// 1rst attribute buffer : vertices
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, my_models[i].vertexbuffer);
-		glVertexAttribPointer(
-			0,                  // attribute
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		// 2nd attribute buffer : UVs
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, my_models[i].uvbuffer);
-		glVertexAttribPointer(
-			1,                                // attribute
-			2,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// 3rd attribute buffer : normals
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, my_models[i].normalbuffer);
-		glVertexAttribPointer(
-			2,                                // attribute
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// Index buffer
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, my_models[i].elementbuffer);
+		if (g_renderState.bindVertexArray(mesh.vertexArray)) {
+			glStateBindVertexArray(mesh.vertexArray);
+			// Bounding box of quantized positions, identity for float ones
+			counted_gl_call(glUniform3f(PositionScaleID, mesh.positionScale.x, mesh.positionScale.y, mesh.positionScale.z));
+			counted_gl_call(glUniform3f(PositionOffsetID, mesh.positionOffset.x, mesh.positionOffset.y, mesh.positionOffset.z));
+		}
 
-		// Draw the triangles !
-		glDrawElements(
-			GL_TRIANGLES,        // mode
-			(GLsizei)my_models[i].indices.size(),      // count
-			GL_UNSIGNED_SHORT,   // type
-			(void*)0             // element array buffer offset
-		);
+		//glm::mat4 ModelMatrix = glm::mat4(1.0);
+		glm::mat4 ModelMatrix = model.modelMatrix;
 
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
+		// Send our transformation to the currently bound shader, in the "M" uniform ; the shader
+		// multiplies it with the frame's viewProjection
+		counted_gl_call(glUniformMatrix4fv(ModelMatrixID, 1, GL_FALSE, &ModelMatrix[0][0]));
 
+		// Draw the triangles !
+		model.drawElements();
 	}
 }
 
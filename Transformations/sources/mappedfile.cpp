@@ -0,0 +1,115 @@
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mappedfile.hpp"
+
+#ifdef _WIN32
+
+bool mapFile(const char * path, MappedFile & out_file){
+	out_file.data = NULL;
+	out_file.size = 0;
+	out_file.fileHandle = INVALID_HANDLE_VALUE;
+	out_file.mappingHandle = NULL;
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE){
+		printf("Impossible to open %s for mapping.\n", path);
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)){
+		CloseHandle(file);
+		return false;
+	}
+	out_file.fileHandle = file;
+	if (size.QuadPart == 0)
+		return true; // CreateFileMapping refuses empty files
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL){
+		CloseHandle(file);
+		out_file.fileHandle = INVALID_HANDLE_VALUE;
+		return false;
+	}
+	void * view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL){
+		CloseHandle(mapping);
+		CloseHandle(file);
+		out_file.fileHandle = INVALID_HANDLE_VALUE;
+		return false;
+	}
+
+	out_file.mappingHandle = mapping;
+	out_file.data = (const char *)view;
+	out_file.size = (size_t)size.QuadPart;
+	return true;
+}
+
+void unmapFile(MappedFile & file){
+	if (file.data != NULL)
+		UnmapViewOfFile(file.data);
+	if (file.mappingHandle != NULL)
+		CloseHandle(file.mappingHandle);
+	if (file.fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(file.fileHandle);
+	file.data = NULL;
+	file.size = 0;
+	file.mappingHandle = NULL;
+	file.fileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool mapFile(const char * path, MappedFile & out_file){
+	out_file.data = NULL;
+	out_file.size = 0;
+	out_file.fd = open(path, O_RDONLY);
+	if (out_file.fd < 0){
+		printf("Impossible to open %s for mapping.\n", path);
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(out_file.fd, &st) != 0){
+		close(out_file.fd);
+		out_file.fd = -1;
+		return false;
+	}
+	if (st.st_size == 0)
+		return true; // mmap refuses zero-length mappings
+
+	void * view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, out_file.fd, 0);
+	if (view == MAP_FAILED){
+		close(out_file.fd);
+		out_file.fd = -1;
+		return false;
+	}
+	// We walk the file front to back exactly once
+	madvise(view, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	out_file.data = (const char *)view;
+	out_file.size = (size_t)st.st_size;
+	return true;
+}
+
+void unmapFile(MappedFile & file){
+	if (file.data != NULL)
+		munmap((void *)file.data, file.size);
+	if (file.fd >= 0)
+		close(file.fd);
+	file.data = NULL;
+	file.size = 0;
+	file.fd = -1;
+}
+
+#endif
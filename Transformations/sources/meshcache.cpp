@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#include "meshcache.hpp"
+#include "objloader.hpp"
+#include "vboindexer.hpp"
+#include "meshoptimize.hpp"
+#include "meshsimplify.hpp"
+
+static const char meshCacheMagic[4] = {'M', 'S', 'H', 'C'};
+
+uint64_t hashMeshSource(const void * data, size_t size){
+	// 8 bytes per step, multiply-xorshift mixing ; we only need to detect edits, not resist attacks
+	const unsigned char * bytes = (const unsigned char *)data;
+	const uint64_t prime = 0x9E3779B97F4A7C15ull;
+	uint64_t h = 0xCBF29CE484222325ull ^ (size * prime);
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8){
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		h = (h ^ word) * prime;
+		h ^= h >> 29;
+	}
+	uint64_t tail = 0;
+	for (size_t j = 0; i + j < size; j++)
+		tail |= (uint64_t)bytes[i + j] << (8 * j);
+	h = (h ^ tail) * prime;
+	h ^= h >> 32;
+	return h;
+}
+
+static uint64_t alignTo16(uint64_t offset){
+	return (offset + 15) & ~(uint64_t)15;
+}
+
+static std::string cachePathFor(const char * objPath){
+	return std::string(objPath) + ".meshcache";
+}
+
+// Maps the cache and checks it against the source. On success, out_mesh points into the mapping.
+static bool openCache(const std::string & cachePath, uint64_t sourceHash, uint64_t sourceSize, const LodSettings & lodSettings, CachedMesh & out_mesh){
+	MappedFile file;
+	FILE * probe = fopen(cachePath.c_str(), "rb");
+	if (probe == NULL)
+		return false; // no cache yet, nothing to report
+	fclose(probe);
+	if (!mapFile(cachePath.c_str(), file))
+		return false;
+
+	MeshCacheHeader header;
+	bool valid = file.size >= sizeof(header);
+	if (valid){
+		memcpy(&header, file.data, sizeof(header));
+		valid = memcmp(header.magic, meshCacheMagic, 4) == 0 &&
+			header.version == MESHCACHE_VERSION &&
+			header.sourceHash == sourceHash &&
+			header.sourceSize == sourceSize &&
+			(header.indexSize == 1 || header.indexSize == 2 || header.indexSize == 4) &&
+			header.positionsOffset + (uint64_t)header.vertexCount * sizeof(glm::vec3) <= file.size &&
+			header.uvsOffset       + (uint64_t)header.vertexCount * sizeof(glm::vec2) <= file.size &&
+			header.normalsOffset   + (uint64_t)header.vertexCount * sizeof(glm::vec3) <= file.size &&
+			header.indicesOffset   + (uint64_t)header.indexCount  * header.indexSize  <= file.size &&
+			header.lodsOffset      + (uint64_t)header.lodCount    * sizeof(MeshLod)   <= file.size &&
+			header.lodSettings.maxLevels == lodSettings.maxLevels &&
+			header.lodSettings.reduction == lodSettings.reduction &&
+			header.lodSettings.minTriangles == lodSettings.minTriangles &&
+			header.lodSettings.maxError == lodSettings.maxError;
+	}
+	if (!valid){
+		unmapFile(file);
+		return false;
+	}
+
+	out_mesh.file = file;
+	out_mesh.mapped = true;
+	out_mesh.positions = (const glm::vec3 *)(file.data + header.positionsOffset);
+	out_mesh.uvs = (const glm::vec2 *)(file.data + header.uvsOffset);
+	out_mesh.normals = (const glm::vec3 *)(file.data + header.normalsOffset);
+	out_mesh.indices = file.data + header.indicesOffset;
+	out_mesh.indexSize = header.indexSize;
+	out_mesh.vertexCount = header.vertexCount;
+	out_mesh.indexCount = header.indexCount;
+	out_mesh.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	out_mesh.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+	const MeshLod * lods = (const MeshLod *)(file.data + header.lodsOffset);
+	out_mesh.lods.assign(lods, lods + header.lodCount);
+	return true;
+}
+
+static bool writeBlock(FILE * file, uint64_t offset, const void * data, size_t size){
+	static const char zeros[16] = {0};
+	long position = ftell(file);
+	if (position < 0 || (uint64_t)position > offset)
+		return false;
+	if (offset > (uint64_t)position && fwrite(zeros, 1, (size_t)(offset - position), file) != offset - position)
+		return false;
+	return size == 0 || fwrite(data, 1, size, file) == size;
+}
+
+// Writes the cache to a temporary file and moves it into place, so a reader never sees half a cache
+static bool writeCache(const std::string & cachePath, uint64_t sourceHash, uint64_t sourceSize, const LodSettings & lodSettings, const CachedMesh & mesh){
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, meshCacheMagic, 4);
+	header.version = MESHCACHE_VERSION;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.vertexCount = mesh.vertexCount;
+	header.indexCount = mesh.indexCount;
+	header.indexSize = mesh.indexSize;
+	header.lodCount = (uint32_t)mesh.lods.size();
+	header.lodSettings = lodSettings;
+	for (int i = 0; i < 3; i++){
+		header.boundsMin[i] = mesh.boundsMin[i];
+		header.boundsMax[i] = mesh.boundsMax[i];
+	}
+	header.positionsOffset = alignTo16(sizeof(header));
+	header.uvsOffset       = alignTo16(header.positionsOffset + (uint64_t)mesh.vertexCount * sizeof(glm::vec3));
+	header.normalsOffset   = alignTo16(header.uvsOffset       + (uint64_t)mesh.vertexCount * sizeof(glm::vec2));
+	header.indicesOffset   = alignTo16(header.normalsOffset   + (uint64_t)mesh.vertexCount * sizeof(glm::vec3));
+	header.lodsOffset      = alignTo16(header.indicesOffset   + (uint64_t)mesh.indexCount  * mesh.indexSize);
+
+	// One temporary file per thread : async loads of the same OBJ may write its cache at the same time
+	char suffix[32];
+	sprintf(suffix, ".%llx.tmp", (unsigned long long)std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::string tempPath = cachePath + suffix;
+	FILE * file = fopen(tempPath.c_str(), "wb");
+	if (file == NULL)
+		return false;
+	bool res = writeBlock(file, 0, &header, sizeof(header)) &&
+		writeBlock(file, header.positionsOffset, mesh.positions, mesh.vertexCount * sizeof(glm::vec3)) &&
+		writeBlock(file, header.uvsOffset, mesh.uvs, mesh.vertexCount * sizeof(glm::vec2)) &&
+		writeBlock(file, header.normalsOffset, mesh.normals, mesh.vertexCount * sizeof(glm::vec3)) &&
+		writeBlock(file, header.indicesOffset, mesh.indices, mesh.indexCount * mesh.indexSize) &&
+		writeBlock(file, header.lodsOffset, mesh.lods.empty() ? NULL : &mesh.lods[0], mesh.lods.size() * sizeof(MeshLod));
+	res = (fclose(file) == 0) && res;
+	if (res){
+		remove(cachePath.c_str()); // rename() does not replace an existing file on Windows
+		res = rename(tempPath.c_str(), cachePath.c_str()) == 0;
+	}
+	if (!res)
+		remove(tempPath.c_str());
+	return res;
+}
+
+bool loadMeshCached(const char * objPath, CachedMesh & out_mesh, const LodSettings & lodSettings){
+	out_mesh.positions = NULL;
+	out_mesh.uvs = NULL;
+	out_mesh.normals = NULL;
+	out_mesh.indices = NULL;
+	out_mesh.indexSize = 2;
+	out_mesh.vertexCount = 0;
+	out_mesh.indexCount = 0;
+	out_mesh.mapped = false;
+	out_mesh.file.data = NULL;
+	out_mesh.file.size = 0;
+
+	// The source is hashed on every load : much cheaper than parsing it
+	MappedFile source;
+	if (!mapFile(objPath, source)){
+		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		return false;
+	}
+	uint64_t sourceSize = source.size;
+	uint64_t sourceHash = hashMeshSource(source.data, source.size);
+	unmapFile(source);
+
+	std::string cachePath = cachePathFor(objPath);
+	if (openCache(cachePath, sourceHash, sourceSize, lodSettings, out_mesh))
+		return true;
+
+	// Missing or stale : build from the OBJ
+	std::vector<unsigned int> indices;
+	if (!loadOBJ_indexed(objPath, indices, out_mesh.ownedPositions, out_mesh.ownedUVs, out_mesh.ownedNormals))
+		return false;
+
+	// OBJ face order has little locality : reorder once here, the cache keeps the result
+	optimizeVertexCache(indices, out_mesh.ownedPositions.size());
+	optimizeVertexFetch(indices, out_mesh.ownedPositions, out_mesh.ownedUVs, out_mesh.ownedNormals);
+	if (!out_mesh.ownedPositions.empty())
+		buildLodChain(indices, &out_mesh.ownedPositions[0], out_mesh.ownedPositions.size(), lodSettings, out_mesh.lods);
+	else
+		out_mesh.lods.clear();
+
+	out_mesh.vertexCount = (unsigned int)out_mesh.ownedPositions.size();
+	out_mesh.indexCount = (unsigned int)indices.size();
+	out_mesh.indexSize = narrowestIndexSize(out_mesh.vertexCount);
+	packIndices(indices, out_mesh.indexSize, out_mesh.ownedIndices);
+	out_mesh.positions = out_mesh.vertexCount ? &out_mesh.ownedPositions[0] : NULL;
+	out_mesh.uvs = out_mesh.vertexCount ? &out_mesh.ownedUVs[0] : NULL;
+	out_mesh.normals = out_mesh.vertexCount ? &out_mesh.ownedNormals[0] : NULL;
+	out_mesh.indices = out_mesh.indexCount ? &out_mesh.ownedIndices[0] : NULL;
+
+	out_mesh.boundsMin = glm::vec3(0.0f, 0.0f, 0.0f);
+	out_mesh.boundsMax = glm::vec3(0.0f, 0.0f, 0.0f);
+	if (out_mesh.vertexCount > 0){
+		out_mesh.boundsMin = out_mesh.boundsMax = out_mesh.positions[0];
+		for (unsigned int i = 1; i < out_mesh.vertexCount; i++){
+			out_mesh.boundsMin = glm::min(out_mesh.boundsMin, out_mesh.positions[i]);
+			out_mesh.boundsMax = glm::max(out_mesh.boundsMax, out_mesh.positions[i]);
+		}
+	}
+
+	// A read-only asset folder is not an error : we just parse again next time
+	if (!writeCache(cachePath, sourceHash, sourceSize, lodSettings, out_mesh))
+		printf("Could not write mesh cache %s\n", cachePath.c_str());
+	return true;
+}
+
+void releaseMesh(CachedMesh & mesh){
+	if (mesh.mapped)
+		unmapFile(mesh.file);
+	mesh.mapped = false;
+	std::vector<glm::vec3>().swap(mesh.ownedPositions);
+	std::vector<glm::vec2>().swap(mesh.ownedUVs);
+	std::vector<glm::vec3>().swap(mesh.ownedNormals);
+	std::vector<unsigned char>().swap(mesh.ownedIndices);
+	std::vector<MeshLod>().swap(mesh.lods);
+	mesh.positions = NULL;
+	mesh.uvs = NULL;
+	mesh.normals = NULL;
+	mesh.indices = NULL;
+}
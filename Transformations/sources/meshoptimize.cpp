@@ -0,0 +1,206 @@
+#include <vector>
+#include <math.h>
+
+#include <glm/glm.hpp>
+
+#include "meshoptimize.hpp"
+
+// Forsyth's scoring : the three most recent vertices get a fixed score (the triangle that just used them
+// is gone, so they are less interesting than the next ones), older cache entries decay with their position,
+// and vertices with few triangles left get a boost so they are finished off instead of left behind.
+static const float lastTriangleScore = 0.75f;
+static const float cacheDecayPower = 1.5f;
+static const float valenceBoostScale = 2.0f;
+static const float valenceBoostPower = 0.5f;
+
+// Score tables, built once : by cache position, and by number of triangles still to emit
+struct ForsythScores{
+	float cache[VERTEX_CACHE_SIZE];
+	float valence[64];
+
+	ForsythScores(){
+		for (int i = 0; i < VERTEX_CACHE_SIZE; i++){
+			if (i < 3)
+				cache[i] = lastTriangleScore;
+			else
+				cache[i] = powf(1.0f - (float)(i - 3) / (VERTEX_CACHE_SIZE - 3), cacheDecayPower);
+		}
+		valence[0] = 0.0f;
+		for (int i = 1; i < 64; i++)
+			valence[i] = valenceBoostScale * powf((float)i, -valenceBoostPower);
+	}
+};
+
+static float vertexScore(const ForsythScores & scores, int cachePosition, unsigned int activeTriangles){
+	// no triangle left : the vertex will never be used again
+	if (activeTriangles == 0)
+		return -1.0f;
+	float score = cachePosition < 0 ? 0.0f : scores.cache[cachePosition];
+	return score + (activeTriangles < 64 ? scores.valence[activeTriangles] : valenceBoostScale * powf((float)activeTriangles, -valenceBoostPower));
+}
+
+void optimizeVertexCache(std::vector<unsigned int> & indices, size_t vertexCount){
+	static const ForsythScores scores;
+	const size_t noTriangle = (size_t)-1;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles still to emit around each vertex, as one flat array : vertex v owns
+	// adjacency[offsets[v] .. offsets[v] + activeCount[v]]
+	std::vector<unsigned int> activeCount(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		activeCount[indices[i]]++;
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + activeCount[v];
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = vertexScore(scores, -1, activeCount[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	size_t best = 0;
+	for (size_t t = 0; t < triangleCount; t++){
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > triangleScores[best])
+			best = t;
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	// The 3 vertices of the emitted triangle are pushed in front of the cache, so it briefly holds 3 more entries
+	unsigned int cache[VERTEX_CACHE_SIZE + 3];
+	unsigned int newCache[VERTEX_CACHE_SIZE + 3];
+	unsigned int cacheCount = 0;
+	size_t cursor = 0; // next triangle in file order, for when nothing in the cache has triangles left
+
+	while (best != noTriangle){
+		emitted[best] = true;
+		const unsigned int * triangle = &indices[best * 3];
+		for (int k = 0; k < 3; k++){
+			unsigned int v = triangle[k];
+			output.push_back(v);
+
+			// drop the triangle from the vertex's list (swap with the last active entry)
+			unsigned int * list = &adjacency[offsets[v]];
+			for (unsigned int j = 0; j < activeCount[v]; j++){
+				if (list[j] == best){
+					list[j] = list[activeCount[v] - 1];
+					break;
+				}
+			}
+			activeCount[v]--;
+		}
+
+		// Move the triangle's vertices to the front, the others shift back and the oldest fall out
+		unsigned int newCount = 0;
+		newCache[newCount++] = triangle[0];
+		if (triangle[1] != triangle[0])
+			newCache[newCount++] = triangle[1];
+		if (triangle[2] != triangle[0] && triangle[2] != triangle[1])
+			newCache[newCount++] = triangle[2];
+		for (unsigned int i = 0; i < cacheCount; i++){
+			unsigned int v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache[newCount++] = v;
+		}
+
+		for (unsigned int i = 0; i < newCount; i++){
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < VERTEX_CACHE_SIZE ? (int)i : -1;
+			vertexScores[v] = vertexScore(scores, cachePosition[v], activeCount[v]);
+		}
+		cacheCount = newCount < VERTEX_CACHE_SIZE ? newCount : VERTEX_CACHE_SIZE;
+		for (unsigned int i = 0; i < cacheCount; i++)
+			cache[i] = newCache[i];
+
+		// Only triangles around vertices whose score changed need rescoring, and the next one comes from them
+		best = noTriangle;
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < newCount; i++){
+			unsigned int v = newCache[i];
+			const unsigned int * list = &adjacency[offsets[v]];
+			for (unsigned int j = 0; j < activeCount[v]; j++){
+				unsigned int t = list[j];
+				float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore){
+					bestScore = score;
+					best = t;
+				}
+			}
+		}
+
+		if (best == noTriangle){
+			while (cursor < triangleCount && emitted[cursor])
+				cursor++;
+			if (cursor < triangleCount)
+				best = cursor;
+		}
+	}
+
+	indices.swap(output);
+}
+
+void optimizeVertexFetch(
+	std::vector<unsigned int> & indices,
+	std::vector<glm::vec3> & positions,
+	std::vector<glm::vec2> & uvs,
+	std::vector<glm::vec3> & normals
+){
+	const unsigned int unused = (unsigned int)-1;
+	std::vector<unsigned int> remap(positions.size(), unused);
+	unsigned int vertexCount = 0;
+	for (size_t i = 0; i < indices.size(); i++){
+		unsigned int & index = remap[indices[i]];
+		if (index == unused)
+			index = vertexCount++;
+		indices[i] = index;
+	}
+
+	std::vector<glm::vec3> out_positions(vertexCount);
+	std::vector<glm::vec2> out_uvs(vertexCount);
+	std::vector<glm::vec3> out_normals(vertexCount);
+	for (size_t v = 0; v < remap.size(); v++){
+		if (remap[v] == unused)
+			continue;
+		out_positions[remap[v]] = positions[v];
+		out_uvs[remap[v]] = uvs[v];
+		out_normals[remap[v]] = normals[v];
+	}
+	positions.swap(out_positions);
+	uvs.swap(out_uvs);
+	normals.swap(out_normals);
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int> & indices, size_t vertexCount, unsigned int cacheSize){
+	// A vertex is still cached if fewer than cacheSize misses happened since it was loaded
+	std::vector<unsigned int> loadedAt(vertexCount, 0);
+	std::vector<bool> seen(vertexCount, false);
+	unsigned int misses = 0;
+	unsigned int used = 0;
+	for (size_t i = 0; i < indices.size(); i++){
+		unsigned int v = indices[i];
+		if (!seen[v]){
+			seen[v] = true;
+			used++;
+		}
+		else if (misses - loadedAt[v] < cacheSize)
+			continue;
+		loadedAt[v] = misses;
+		misses++;
+	}
+
+	VertexCacheStats stats;
+	stats.acmr = indices.size() >= 3 ? (float)misses / (indices.size() / 3) : 0.0f;
+	stats.atvr = used > 0 ? (float)misses / used : 0.0f;
+	return stats;
+}
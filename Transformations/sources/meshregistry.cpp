@@ -0,0 +1,287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+
+#include "meshregistry.hpp"
+#include "meshcache.hpp"
+#include "vboindexer.hpp"
+#include "threadpool.hpp"
+#include "mpscqueue.hpp"
+#include "frustumcull.hpp"
+#include "glstate.hpp"
+
+// Live meshes, keyed by canonical path and layout. A weak_ptr does not keep the mesh alive :
+// the entry is dropped by GpuMeshDeleter when the last Model using it goes away.
+static std::unordered_map<std::string, std::weak_ptr<GpuMesh> > liveMeshes;
+
+// Paths as the callers spell them, resolved once ; the next lookup of the same spelling is a single hash lookup.
+static std::unordered_map<std::string, std::string> canonicalPaths;
+
+static const std::string & canonicalPath(const char * path){
+	std::unordered_map<std::string, std::string>::iterator it = canonicalPaths.find(path);
+	if (it != canonicalPaths.end())
+		return it->second;
+
+	std::string canonical = path;
+#ifdef _WIN32
+	char buffer[_MAX_PATH];
+	if (_fullpath(buffer, path, _MAX_PATH) != NULL){
+		canonical = buffer;
+		// NTFS is case-insensitive : "Mesh\Cube.obj" and "mesh/cube.obj" are the same file
+		for (size_t i = 0; i < canonical.size(); i++){
+			if (canonical[i] == '\\') canonical[i] = '/';
+			else canonical[i] = (char)tolower((unsigned char)canonical[i]);
+		}
+	}
+#else
+	char * resolved = realpath(path, NULL);
+	if (resolved != NULL){
+		canonical = resolved;
+		free(resolved);
+	}
+#endif
+	return canonicalPaths[path] = canonical;
+}
+
+struct GpuMeshDeleter{
+	std::string key;
+
+	void operator()(const GpuMesh * mesh) const{
+		std::unordered_map<std::string, std::weak_ptr<GpuMesh> >::iterator it = liveMeshes.find(key);
+		if (it != liveMeshes.end() && it->second.expired())
+			liveMeshes.erase(it);
+
+		glStateDeleteBuffers(1, &mesh->vertexbuffer);
+		glStateDeleteBuffers(1, &mesh->uvbuffer);
+		glStateDeleteBuffers(1, &mesh->normalbuffer);
+		glStateDeleteBuffers(1, &mesh->elementbuffer);
+		glStateDeleteVertexArrays(1, &mesh->vertexArray);
+		delete mesh;
+	}
+};
+
+// CPU side of a mesh load, built on a worker thread for acquireMeshAsync
+struct MeshUpload{
+	std::string path;
+	GpuMesh::Layout layout;
+	CachedMesh mesh;
+	std::vector<InterleavedVertex> interleaved;
+	std::vector<QuantizedVertex> quantized;
+	glm::vec3 sphereCenter;
+	float sphereRadius;
+	std::weak_ptr<GpuMesh> target; // expired when every model using the mesh went away during the load
+	bool loaded; // false when the file could not be read or parsed : nothing to upload
+};
+
+// Finished loads, waiting for the GL thread (see pumpMeshUploads). The ones still queued when the
+// program exits are never uploaded : the queue frees them. The pool is created after the queue, on the
+// first load, so it is destroyed, and its workers have pushed their last load, before the queue
+static struct FinishedLoads : public MPSCQueue<MeshUpload *>{
+	~FinishedLoads(){
+		MeshUpload * upload;
+		while (pop(upload)){
+			releaseMesh(upload->mesh);
+			delete upload;
+		}
+	}
+} finishedLoads;
+static unsigned int loadsInFlight = 0; // GL thread only : queued on the pool and not yet uploaded
+
+// Everything that does not need GL : file I/O, parsing, welding, interleaving and quantization.
+// Sets upload.loaded ; a file that cannot be loaded is reported here
+static void prepareMesh(MeshUpload & upload){
+	//loads model, through its binary cache when it is up to date
+	upload.loaded = loadMeshCached(upload.path.c_str(), upload.mesh);
+	if (!upload.loaded){
+		printf("Could not load mesh %s\n", upload.path.c_str());
+		return;
+	}
+	const CachedMesh & mesh = upload.mesh;
+	computeBoundingSphere(mesh.positions, mesh.vertexCount, upload.sphereCenter, upload.sphereRadius);
+	if (upload.layout == GpuMesh::INTERLEAVED)
+		interleaveVertices(mesh.positions, mesh.normals, mesh.uvs, mesh.vertexCount, upload.interleaved);
+	else if (upload.layout == GpuMesh::QUANTIZED){
+		QuantizationError error;
+		quantizeVertices(mesh.positions, mesh.normals, mesh.uvs, mesh.vertexCount, mesh.boundsMin, mesh.boundsMax, upload.quantized, error);
+	}
+}
+
+static void uploadMesh(MeshUpload & upload, GpuMesh & gpu){
+	const CachedMesh & mesh = upload.mesh;
+	gpu.indexCount = (GLsizei)(mesh.lods.empty() ? mesh.indexCount : mesh.lods[0].indexCount);
+	gpu.lods = mesh.lods;
+	gpu.indexType = mesh.indexSize == 1 ? GL_UNSIGNED_BYTE : (mesh.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+	gpu.boundsMin = mesh.boundsMin;
+	gpu.boundsMax = mesh.boundsMax;
+	gpu.sphereCenter = upload.sphereCenter;
+	gpu.sphereRadius = upload.sphereRadius;
+	if (upload.layout == GpuMesh::QUANTIZED){
+		gpu.positionScale = mesh.boundsMax - mesh.boundsMin;
+		gpu.positionOffset = mesh.boundsMin;
+	}
+
+	//the element buffer binding is recorded in the VAO
+	glGenVertexArrays(1, &gpu.vertexArray);
+	glStateBindVertexArray(gpu.vertexArray);
+	if (upload.layout == GpuMesh::INTERLEAVED) {
+		const std::vector<InterleavedVertex> & vertices = upload.interleaved;
+
+		glGenBuffers(1, &gpu.vertexbuffer);
+		glStateBindBuffer(GL_ARRAY_BUFFER, gpu.vertexbuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(InterleavedVertex), vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+
+		//attribute setup is done once here, draws only bind the VAO
+		glStateEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(InterleavedVertex), (void*)offsetof(InterleavedVertex, position));
+		glStateEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(InterleavedVertex), (void*)offsetof(InterleavedVertex, uv));
+		glStateEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(InterleavedVertex), (void*)offsetof(InterleavedVertex, normal));
+	}
+	else if (upload.layout == GpuMesh::QUANTIZED) {
+		const std::vector<QuantizedVertex> & vertices = upload.quantized;
+
+		glGenBuffers(1, &gpu.vertexbuffer);
+		glStateBindBuffer(GL_ARRAY_BUFFER, gpu.vertexbuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(QuantizedVertex), vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+
+		//normalized integers are turned into floats by the vertex fetch, the shader only scales the position back
+		glStateEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, position));
+		glStateEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, uv));
+		glStateEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(QuantizedVertex), (void*)offsetof(QuantizedVertex, normal));
+	}
+	else {
+		// 1rst attribute buffer : vertices
+		glGenBuffers(1, &gpu.vertexbuffer);
+		glStateBindBuffer(GL_ARRAY_BUFFER, gpu.vertexbuffer);
+		glBufferData(GL_ARRAY_BUFFER, mesh.vertexCount * sizeof(glm::vec3), mesh.positions, GL_STATIC_DRAW);
+		glStateEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		// 2nd attribute buffer : UVs
+		glGenBuffers(1, &gpu.uvbuffer);
+		glStateBindBuffer(GL_ARRAY_BUFFER, gpu.uvbuffer);
+		glBufferData(GL_ARRAY_BUFFER, mesh.vertexCount * sizeof(glm::vec2), mesh.uvs, GL_STATIC_DRAW);
+		glStateEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		// 3rd attribute buffer : normals
+		glGenBuffers(1, &gpu.normalbuffer);
+		glStateBindBuffer(GL_ARRAY_BUFFER, gpu.normalbuffer);
+		glBufferData(GL_ARRAY_BUFFER, mesh.vertexCount * sizeof(glm::vec3), mesh.normals, GL_STATIC_DRAW);
+		glStateEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	}
+
+	glGenBuffers(1, &gpu.elementbuffer);
+	glStateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.elementbuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount * mesh.indexSize, mesh.indices, GL_STATIC_DRAW);
+
+	glStateBindVertexArray(0);
+	gpu.ready = true;
+}
+
+// Takes a mesh whose load failed out of the registry : its handles stay empty and never ready, and the
+// next acquire of the same file tries again
+static void unregisterMesh(const std::shared_ptr<GpuMesh> & mesh){
+	std::unordered_map<std::string, std::weak_ptr<GpuMesh> >::iterator it = liveMeshes.find(std::get_deleter<GpuMeshDeleter>(mesh)->key);
+	if (it != liveMeshes.end() && it->second.lock() == mesh)
+		liveMeshes.erase(it);
+}
+
+// Live entry for key, or a new empty GpuMesh registered under it (inserted set to true)
+static std::shared_ptr<GpuMesh> findOrCreateMesh(const char * path, GpuMesh::Layout layout, bool & inserted){
+	std::string key = canonicalPath(path);
+	if (layout == GpuMesh::SEPARATE)
+		key += "#separate";
+	else if (layout == GpuMesh::QUANTIZED)
+		key += "#quantized";
+
+	std::weak_ptr<GpuMesh> & entry = liveMeshes[key];
+	std::shared_ptr<GpuMesh> mesh = entry.lock();
+	inserted = !mesh;
+	if (mesh)
+		return mesh;
+
+	GpuMeshDeleter deleter;
+	deleter.key = key;
+	GpuMesh * empty = new GpuMesh();
+	empty->layout = layout;
+	mesh = std::shared_ptr<GpuMesh>(empty, deleter);
+	entry = mesh;
+	return mesh;
+}
+
+std::shared_ptr<const GpuMesh> acquireMesh(const char * path, GpuMesh::Layout layout){
+	bool inserted;
+	std::shared_ptr<GpuMesh> mesh = findOrCreateMesh(path, layout, inserted);
+	if (inserted){
+		MeshUpload upload;
+		upload.path = path;
+		upload.layout = layout;
+		prepareMesh(upload);
+		if (upload.loaded)
+			uploadMesh(upload, *mesh);
+		else
+			unregisterMesh(mesh);
+		//the driver has its own copy now
+		releaseMesh(upload.mesh);
+	}
+	return mesh;
+}
+
+std::shared_ptr<const GpuMesh> acquireMeshAsync(const char * path, GpuMesh::Layout layout){
+	bool inserted;
+	std::shared_ptr<GpuMesh> mesh = findOrCreateMesh(path, layout, inserted);
+	if (inserted){
+		MeshUpload * upload = new MeshUpload();
+		upload->path = path;
+		upload->layout = layout;
+		upload->target = mesh;
+		loadsInFlight++;
+		defaultThreadPool().run([upload](){
+			prepareMesh(*upload);
+			finishedLoads.push(upload);
+		});
+	}
+	return mesh;
+}
+
+unsigned int pumpMeshUploads(double budgetSeconds){
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	unsigned int uploaded = 0;
+	MeshUpload * upload;
+	while (finishedLoads.pop(upload)){
+		loadsInFlight--;
+		std::shared_ptr<GpuMesh> target = upload->target.lock();
+		if (target && upload->loaded){
+			uploadMesh(*upload, *target);
+			uploaded++;
+		}
+		else if (target)
+			unregisterMesh(target);
+		releaseMesh(upload->mesh);
+		delete upload;
+
+		// At least one upload per call, so a single large mesh cannot stall the queue
+		if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= budgetSeconds)
+			break;
+	}
+	return uploaded;
+}
+
+unsigned int pendingMeshLoads(){
+	return loadsInFlight;
+}
+
+size_t registeredMeshCount(){
+	return liveMeshes.size();
+}
@@ -0,0 +1,427 @@
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+#include <glm/glm.hpp>
+
+#include "meshsimplify.hpp"
+#include "meshoptimize.hpp"
+
+LodSettings defaultLodSettings(){
+	LodSettings settings;
+	settings.maxLevels = 0;
+	settings.reduction = 0.5f;
+	settings.minTriangles = 64;
+	settings.maxError = 0.05f;
+	return settings;
+}
+
+// Planes along seams and open borders weigh this much more than the surface, so they barely move
+static const double borderWeight = 4.0;
+
+// Sum of weighted squared distances to planes : p^T A p + 2 b.p + c, with A symmetric
+struct Quadric{
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+	double weight;
+};
+
+// Plane through point with unit normal n
+static void addPlane(Quadric & q, const glm::vec3 & n, const glm::vec3 & point, double weight){
+	double x = n.x, y = n.y, z = n.z;
+	double d = -(x * point.x + y * point.y + z * point.z);
+	q.a00 += weight * x * x; q.a01 += weight * x * y; q.a02 += weight * x * z;
+	q.a11 += weight * y * y; q.a12 += weight * y * z; q.a22 += weight * z * z;
+	q.b0 += weight * x * d; q.b1 += weight * y * d; q.b2 += weight * z * d;
+	q.c += weight * d * d;
+	q.weight += weight;
+}
+
+static void addQuadric(Quadric & q, const Quadric & r){
+	q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02;
+	q.a11 += r.a11; q.a12 += r.a12; q.a22 += r.a22;
+	q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+	q.c += r.c;
+	q.weight += r.weight;
+}
+
+// Root of the weighted mean squared distance : a distance, whatever the area around the vertex
+static float quadricError(const Quadric & q, const glm::vec3 & p){
+	double x = p.x, y = p.y, z = p.z;
+	double e = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z
+		+ 2 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+		+ 2 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+	if (e <= 0 || q.weight <= 0)
+		return 0.0f;
+	return (float)sqrt(e / q.weight);
+}
+
+// Triangle edge between two positions ; wedges are the actual vertices, which may differ in UV or normal
+struct HalfEdge{
+	unsigned int from, to;
+	unsigned int wedgeFrom, wedgeTo;
+	unsigned int triangle;
+
+	bool operator<(const HalfEdge & other) const{
+		return from != other.from ? from < other.from : to < other.to;
+	}
+};
+
+static void buildHalfEdges(const std::vector<unsigned int> & indices, const std::vector<unsigned int> & position, std::vector<HalfEdge> & out_edges){
+	out_edges.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++){
+		size_t next = i % 3 == 2 ? i - 2 : i + 1;
+		HalfEdge & edge = out_edges[i];
+		edge.wedgeFrom = indices[i];
+		edge.wedgeTo = indices[next];
+		edge.from = position[edge.wedgeFrom];
+		edge.to = position[edge.wedgeTo];
+		edge.triangle = (unsigned int)(i / 3);
+	}
+	std::sort(out_edges.begin(), out_edges.end());
+}
+
+// An open border has no triangle on the other side ; a seam has one, but it uses other vertices at both ends (UV or
+// normal split along the edge). When the other side shares the vertex at one end and not at the other, the split is
+// at that one point, like the pole of a UV sphere whose fan has a vertex per triangle : the edge stays free and
+// out_pointSplit is that position (~0u otherwise), which must not move but does not hold its neighbours back
+static bool isConstrained(const std::vector<HalfEdge> & edges, const HalfEdge & edge, bool & out_hasOpposite, unsigned int & out_pointSplit){
+	HalfEdge key;
+	key.from = edge.to;
+	key.to = edge.from;
+	std::pair<std::vector<HalfEdge>::const_iterator, std::vector<HalfEdge>::const_iterator> opposite = std::equal_range(edges.begin(), edges.end(), key);
+	out_hasOpposite = opposite.first != opposite.second;
+	out_pointSplit = ~0u;
+	for (std::vector<HalfEdge>::const_iterator it = opposite.first; it != opposite.second; ++it){
+		bool sameTo = it->wedgeFrom == edge.wedgeTo, sameFrom = it->wedgeTo == edge.wedgeFrom;
+		if (sameTo && sameFrom){
+			out_pointSplit = ~0u;
+			return false;
+		}
+		if (sameTo || sameFrom)
+			out_pointSplit = sameTo ? edge.from : edge.to;
+	}
+	return out_pointSplit == ~0u;
+}
+
+enum VertexKind{
+	FREE,        // inside a smooth surface : may collapse anywhere
+	CONSTRAINED, // on one seam or border line : may only slide along it
+	LOCKED       // where seams or borders meet : stays
+};
+
+struct Collapse{
+	unsigned int from, to; // positions
+	float error;
+
+	bool operator<(const Collapse & other) const{ return error < other.error; }
+};
+
+static glm::vec3 triangleNormal(const glm::vec3 & a, const glm::vec3 & b, const glm::vec3 & c){
+	return glm::cross(b - a, c - a);
+}
+
+// State of one simplification : the current index list and the quadrics it accumulated, so a LOD chain is
+// built by a single run that is paused at every level
+struct Simplifier{
+	size_t vertexCount;
+	std::vector<glm::vec3> scaled;      // positions in a unit-sized copy of the mesh, so errors come out relative
+	std::vector<unsigned int> position; // vertex -> the first vertex at the same place, which stands for all of them
+	std::vector<Quadric> quadrics;      // by position
+	std::vector<unsigned int> indices;
+	float reached;
+
+	// work buffers, kept from pass to pass
+	std::vector<HalfEdge> edges;
+	std::vector<bool> edgeConstrained, edgeHasOpposite;
+	std::vector<unsigned char> kind;
+	std::vector<unsigned char> pointSplit; // by position : its vertices differ around it, but along no edge
+	std::vector<unsigned int> constrainedEdges;
+	std::vector<unsigned int> triangleCount, offsets, adjacency, fill;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned char> touched;
+	std::vector<unsigned int> wedgeRemap;
+	std::vector<unsigned int> next;
+};
+
+static void initSimplifier(Simplifier & s, const std::vector<unsigned int> & indices, const glm::vec3 * positions, size_t vertexCount){
+	s.vertexCount = vertexCount;
+	s.indices.assign(indices.begin(), indices.end() - indices.size() % 3);
+	s.reached = 0.0f;
+	if (vertexCount == 0)
+		return;
+
+	glm::vec3 boundsMin = positions[0], boundsMax = positions[0];
+	for (size_t v = 1; v < vertexCount; v++){
+		boundsMin = glm::min(boundsMin, positions[v]);
+		boundsMax = glm::max(boundsMax, positions[v]);
+	}
+	float diagonal = glm::length(boundsMax - boundsMin);
+	float invScale = diagonal > 0 ? 1.0f / diagonal : 1.0f;
+	s.scaled.resize(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		s.scaled[v] = (positions[v] - boundsMin) * invScale;
+
+	// Vertices split for UVs or normals share a position
+	std::vector<unsigned int> order(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		order[v] = (unsigned int)v;
+	const std::vector<glm::vec3> & scaled = s.scaled;
+	std::sort(order.begin(), order.end(), [&scaled](unsigned int a, unsigned int b){
+		const glm::vec3 & pa = scaled[a];
+		const glm::vec3 & pb = scaled[b];
+		return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+	});
+	s.position.resize(vertexCount);
+	s.position[order[0]] = order[0];
+	for (size_t i = 1; i < vertexCount; i++)
+		s.position[order[i]] = scaled[order[i]] == scaled[order[i - 1]] ? s.position[order[i - 1]] : order[i];
+
+	// Each position starts with the planes of its triangles, weighted by area, plus planes standing on its seam and border edges
+	Quadric zero = {};
+	s.quadrics.assign(vertexCount, zero);
+	for (size_t t = 0; t < s.indices.size() / 3; t++){
+		unsigned int a = s.position[s.indices[t * 3]], b = s.position[s.indices[t * 3 + 1]], c = s.position[s.indices[t * 3 + 2]];
+		glm::vec3 normal = triangleNormal(scaled[a], scaled[b], scaled[c]);
+		float length = glm::length(normal);
+		if (length <= 0)
+			continue;
+		normal /= length;
+		addPlane(s.quadrics[a], normal, scaled[a], length * 0.5);
+		addPlane(s.quadrics[b], normal, scaled[a], length * 0.5);
+		addPlane(s.quadrics[c], normal, scaled[a], length * 0.5);
+	}
+	buildHalfEdges(s.indices, s.position, s.edges);
+	for (size_t i = 0; i < s.edges.size(); i++){
+		const HalfEdge & halfEdge = s.edges[i];
+		bool hasOpposite;
+		unsigned int pointSplit;
+		if (!isConstrained(s.edges, halfEdge, hasOpposite, pointSplit))
+			continue;
+		const unsigned int * triangle = &s.indices[halfEdge.triangle * 3];
+		glm::vec3 normal = triangleNormal(scaled[s.position[triangle[0]]], scaled[s.position[triangle[1]]], scaled[s.position[triangle[2]]]);
+		glm::vec3 edge = scaled[halfEdge.to] - scaled[halfEdge.from];
+		glm::vec3 side = glm::cross(edge, normal);
+		float length = glm::length(side);
+		if (length <= 0)
+			continue;
+		side /= length;
+		double weight = glm::dot(edge, edge) * borderWeight;
+		addPlane(s.quadrics[halfEdge.from], side, scaled[halfEdge.from], weight);
+		addPlane(s.quadrics[halfEdge.to], side, scaled[halfEdge.from], weight);
+	}
+
+	s.kind.resize(vertexCount);
+	s.pointSplit.resize(vertexCount);
+	s.constrainedEdges.resize(vertexCount);
+	s.triangleCount.resize(vertexCount);
+	s.offsets.resize(vertexCount + 1);
+	s.touched.resize(vertexCount);
+	s.wedgeRemap.resize(vertexCount);
+}
+
+// Collapses edges until s.indices is down to targetIndexCount or the next collapse would cost more than maxError.
+// Each pass collapses the cheapest edges whose neighbourhoods do not overlap, then rebuilds the list.
+static void runSimplifier(Simplifier & s, size_t targetIndexCount, float maxError){
+	const std::vector<glm::vec3> & scaled = s.scaled;
+	const std::vector<unsigned int> & position = s.position;
+	while (s.indices.size() > targetIndexCount){
+		std::vector<unsigned int> & indices = s.indices;
+		size_t triangles = indices.size() / 3;
+		buildHalfEdges(indices, position, s.edges);
+		const std::vector<HalfEdge> & edges = s.edges;
+
+		// Classify positions by the seam and border edges around them ; a split at a single point locks that point
+		std::fill(s.constrainedEdges.begin(), s.constrainedEdges.end(), 0);
+		std::fill(s.pointSplit.begin(), s.pointSplit.end(), 0);
+		s.edgeConstrained.resize(edges.size());
+		s.edgeHasOpposite.resize(edges.size());
+		for (size_t i = 0; i < edges.size(); i++){
+			bool hasOpposite;
+			unsigned int pointSplit;
+			s.edgeConstrained[i] = isConstrained(edges, edges[i], hasOpposite, pointSplit);
+			s.edgeHasOpposite[i] = hasOpposite;
+			if (pointSplit != ~0u)
+				s.pointSplit[pointSplit] = 1;
+			// a seam shows up from both sides : count it once
+			if (s.edgeConstrained[i] && (!hasOpposite || edges[i].from < edges[i].to)){
+				s.constrainedEdges[edges[i].from]++;
+				s.constrainedEdges[edges[i].to]++;
+			}
+		}
+		for (size_t v = 0; v < s.vertexCount; v++)
+			s.kind[v] = s.pointSplit[v] ? LOCKED : (s.constrainedEdges[v] == 0 ? FREE : (s.constrainedEdges[v] == 2 ? CONSTRAINED : LOCKED));
+
+		// Candidate collapses, one per edge, in the cheaper allowed direction
+		s.collapses.clear();
+		for (size_t i = 0; i < edges.size(); i++){
+			const HalfEdge & edge = edges[i];
+			if (s.edgeHasOpposite[i] && edge.from > edge.to)
+				continue;
+			Collapse best;
+			best.error = -1.0f;
+			for (int direction = 0; direction < 2; direction++){
+				unsigned int from = direction == 0 ? edge.from : edge.to;
+				unsigned int to = direction == 0 ? edge.to : edge.from;
+				if (s.kind[from] == LOCKED || (s.kind[from] == CONSTRAINED && !s.edgeConstrained[i]))
+					continue;
+				Quadric merged = s.quadrics[from];
+				addQuadric(merged, s.quadrics[to]);
+				float error = quadricError(merged, scaled[to]);
+				if (best.error < 0 || error < best.error){
+					best.from = from;
+					best.to = to;
+					best.error = error;
+				}
+			}
+			if (best.error >= 0 && best.error <= maxError)
+				s.collapses.push_back(best);
+		}
+		std::sort(s.collapses.begin(), s.collapses.end());
+
+		// Triangles around each position
+		std::fill(s.triangleCount.begin(), s.triangleCount.end(), 0);
+		for (size_t i = 0; i < indices.size(); i++)
+			s.triangleCount[position[indices[i]]]++;
+		s.offsets[0] = 0;
+		for (size_t v = 0; v < s.vertexCount; v++)
+			s.offsets[v + 1] = s.offsets[v] + s.triangleCount[v];
+		s.adjacency.resize(indices.size());
+		s.fill.assign(s.offsets.begin(), s.offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			s.adjacency[s.fill[position[indices[i]]]++] = (unsigned int)(i / 3);
+		const std::vector<unsigned int> & offsets = s.offsets;
+		const std::vector<unsigned int> & adjacency = s.adjacency;
+
+		std::fill(s.touched.begin(), s.touched.end(), 0);
+		for (size_t v = 0; v < s.vertexCount; v++)
+			s.wedgeRemap[v] = (unsigned int)v;
+		size_t needed = triangles - targetIndexCount / 3;
+		size_t removed = 0;
+		size_t done = 0;
+		for (size_t i = 0; i < s.collapses.size() && removed < needed; i++){
+			const Collapse & collapse = s.collapses[i];
+			unsigned int a = collapse.from, b = collapse.to;
+			if (s.touched[a] || s.touched[b])
+				continue;
+
+			// Refuse collapses that would fold a triangle over
+			bool flips = false;
+			size_t onEdge = 0;
+			for (unsigned int j = offsets[a]; j < offsets[a + 1] && !flips; j++){
+				const unsigned int * triangle = &indices[adjacency[j] * 3];
+				glm::vec3 before[3], after[3];
+				bool hasB = false;
+				for (int k = 0; k < 3; k++){
+					unsigned int p = position[triangle[k]];
+					hasB = hasB || p == b;
+					before[k] = scaled[p];
+					after[k] = p == a ? scaled[b] : scaled[p];
+				}
+				if (hasB){
+					onEdge++;
+					continue;
+				}
+				flips = glm::dot(triangleNormal(before[0], before[1], before[2]), triangleNormal(after[0], after[1], after[2])) <= 0;
+			}
+			if (flips)
+				continue;
+
+			// Each vertex at a follows the vertex at b it shares a triangle with, so UVs and normals stay on their side of a seam
+			for (unsigned int j = offsets[a]; j < offsets[a + 1]; j++){
+				const unsigned int * triangle = &indices[adjacency[j] * 3];
+				for (int k = 0; k < 3; k++){
+					if (position[triangle[k]] != a)
+						continue;
+					for (int m = 0; m < 3; m++)
+						if (position[triangle[m]] == b)
+							s.wedgeRemap[triangle[k]] = triangle[m];
+				}
+			}
+			for (unsigned int j = offsets[a]; j < offsets[a + 1]; j++){
+				const unsigned int * triangle = &indices[adjacency[j] * 3];
+				for (int k = 0; k < 3; k++){
+					if (position[triangle[k]] == a && s.wedgeRemap[triangle[k]] == triangle[k])
+						s.wedgeRemap[triangle[k]] = b;
+					s.touched[position[triangle[k]]] = 1;
+				}
+			}
+			addQuadric(s.quadrics[b], s.quadrics[a]);
+			s.reached = std::max(s.reached, collapse.error);
+			removed += onEdge;
+			done++;
+		}
+		if (done == 0)
+			break;
+
+		s.next.clear();
+		for (size_t t = 0; t < triangles; t++){
+			unsigned int w0 = s.wedgeRemap[indices[t * 3]], w1 = s.wedgeRemap[indices[t * 3 + 1]], w2 = s.wedgeRemap[indices[t * 3 + 2]];
+			unsigned int p0 = position[w0], p1 = position[w1], p2 = position[w2];
+			if (p0 == p1 || p1 == p2 || p0 == p2)
+				continue;
+			s.next.push_back(w0);
+			s.next.push_back(w1);
+			s.next.push_back(w2);
+		}
+		indices.swap(s.next);
+	}
+}
+
+float simplifyMesh(
+	const std::vector<unsigned int> & indices,
+	const glm::vec3 * positions,
+	size_t vertexCount,
+	size_t targetIndexCount,
+	float maxError,
+	std::vector<unsigned int> & out_indices
+){
+	Simplifier simplifier;
+	initSimplifier(simplifier, indices, positions, vertexCount);
+	if (vertexCount > 0)
+		runSimplifier(simplifier, targetIndexCount, maxError);
+	out_indices.swap(simplifier.indices);
+	return simplifier.reached;
+}
+
+void buildLodChain(
+	std::vector<unsigned int> & indices,
+	const glm::vec3 * positions,
+	size_t vertexCount,
+	const LodSettings & settings,
+	std::vector<MeshLod> & out_lods
+){
+	out_lods.clear();
+	MeshLod full;
+	full.firstIndex = 0;
+	full.indexCount = (unsigned int)indices.size();
+	full.error = 0.0f;
+	out_lods.push_back(full);
+	if (vertexCount == 0)
+		return;
+
+	// One run from the full mesh to the coarsest level, copied out each time it gets down to a level
+	Simplifier simplifier;
+	initSimplifier(simplifier, indices, positions, vertexCount);
+	size_t target = indices.size() / 3;
+	std::vector<unsigned int> lod;
+	for (unsigned int level = 1; settings.maxLevels == 0 || level < settings.maxLevels; level++){
+		target = (size_t)(target * settings.reduction);
+		if (target < settings.minTriangles)
+			break;
+		runSimplifier(simplifier, target * 3, settings.maxError);
+		// the error limit stopped it well before the target : coarser levels would be the same
+		if (simplifier.indices.size() * 10 > (size_t)out_lods.back().indexCount * 9)
+			break;
+
+		lod = simplifier.indices;
+		optimizeVertexCache(lod, vertexCount);
+		MeshLod simplified;
+		simplified.firstIndex = (unsigned int)indices.size();
+		simplified.indexCount = (unsigned int)lod.size();
+		simplified.error = simplifier.reached;
+		indices.insert(indices.end(), lod.begin(), lod.end());
+		out_lods.push_back(simplified);
+	}
+}
@@ -2,10 +2,15 @@
 #include <stdio.h>
 #include <string>
 #include <cstring>
+#include <stdlib.h>
+#include <stdint.h>
 
 #include <glm/glm.hpp>
 
 #include "objloader.hpp"
+#include "mappedfile.hpp"
+#include "threadpool.hpp"
+#include "vertexhash.hpp"
 
 // Very, VERY simple OBJ loader.
 // Here is a short list of features a real function would provide : 
@@ -17,6 +22,21 @@
 // - More secure. Change another line and you can inject code.
 // - Loading from memory, stream, etc
 
+// Raw OBJ records, before the faces are resolved against the attribute arrays.
+struct ObjRecords{
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
+
+	// Corners are (v, vt, vn) index triples
+	void addTriangle(const unsigned int a[3], const unsigned int b[3], const unsigned int c[3]){
+		vertexIndices.push_back(a[0]); vertexIndices.push_back(b[0]); vertexIndices.push_back(c[0]);
+		uvIndices    .push_back(a[1]); uvIndices    .push_back(b[1]); uvIndices    .push_back(c[1]);
+		normalIndices.push_back(a[2]); normalIndices.push_back(b[2]); normalIndices.push_back(c[2]);
+	}
+};
+
 bool loadOBJ(
 	const char * path, 
 	std::vector<glm::vec3> & out_vertices, 
@@ -110,6 +130,475 @@ bool loadOBJ(
 }
 
 
+
+// In-place tokenizer used by loadOBJ_mmap.
+// Every helper gets the current position and the end of the line it may read :
+// a mapped file is not NUL-terminated, so nothing here may look past "end".
+
+static inline bool isObjSpace(char c){
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isObjDigit(char c){
+	return (unsigned char)(c - '0') < 10;
+}
+
+static inline const char * skipObjSpaces(const char * p, const char * end){
+	while (p < end && isObjSpace(*p))
+		p++;
+	return p;
+}
+
+// Slow path : copies the token and hands it to strtof (exponents out of range, "inf", "nan", very long mantissas...)
+static const char * parseFloatSlow(const char * p, const char * end, float & out){
+	char token[64];
+	size_t length = 0;
+	while (p + length < end && !isObjSpace(p[length]) && length < sizeof(token) - 1){
+		token[length] = p[length];
+		length++;
+	}
+	token[length] = '\0';
+	char * tokenEnd;
+	out = strtof(token, &tokenEnd);
+	if (tokenEnd == token)
+		return NULL;
+	return p + (tokenEnd - token);
+}
+
+// Exact powers of ten : all of them fit in a float mantissa.
+static const float objPow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+// Parses a float exactly like "%f" would.
+// When the decimal mantissa fits in 24 bits and the exponent is at most 10, both the mantissa
+// and the power of ten are exact floats, so one multiplication/division rounds correctly.
+// That covers what every exporter we use writes (6 decimals); anything else takes the strtof path.
+static const char * parseObjFloat(const char * p, const char * end, float & out){
+	p = skipObjSpaces(p, end);
+	const char * start = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')){
+		negative = (*p == '-');
+		p++;
+	}
+
+	uint32_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigit = false;
+	while (p < end && isObjDigit(*p)){
+		if (mantissa != 0 || *p != '0') significantDigits++;
+		if (significantDigits <= 9) mantissa = mantissa * 10 + (*p - '0');
+		else exponent++;
+		anyDigit = true;
+		p++;
+	}
+	if (p < end && *p == '.'){
+		p++;
+		while (p < end && isObjDigit(*p)){
+			if (mantissa != 0 || *p != '0') significantDigits++;
+			if (significantDigits <= 9){
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
+			}
+			anyDigit = true;
+			p++;
+		}
+	}
+	if (!anyDigit)
+		return parseFloatSlow(start, end, out);
+
+	if (p < end && (*p == 'e' || *p == 'E')){
+		const char * q = p + 1;
+		bool negativeExponent = false;
+		if (q < end && (*q == '-' || *q == '+')){
+			negativeExponent = (*q == '-');
+			q++;
+		}
+		if (q < end && isObjDigit(*q)){
+			int value = 0;
+			while (q < end && isObjDigit(*q)){
+				if (value < 10000) value = value * 10 + (*q - '0');
+				q++;
+			}
+			exponent += negativeExponent ? -value : value;
+			p = q;
+		}
+	}
+
+	if (significantDigits > 9 || mantissa > (1u << 24) || exponent < -10 || exponent > 10)
+		return parseFloatSlow(start, end, out);
+
+	float value = (float)mantissa;
+	value = exponent < 0 ? value / objPow10[-exponent] : value * objPow10[exponent];
+	out = negative ? -value : value;
+	return p;
+}
+
+// Parses an index like "%d" does. Returns NULL if there is no number here.
+static const char * parseObjIndex(const char * p, const char * end, unsigned int & out){
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')){
+		negative = (*p == '-');
+		p++;
+	}
+	if (p >= end || !isObjDigit(*p))
+		return NULL;
+	unsigned int value = 0;
+	while (p < end && isObjDigit(*p)){
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+	out = negative ? 0u - value : value;
+	return p;
+}
+
+// Parses one face corner : "v", "v/vt", "v//vn" or "v/vt/vn".
+// A missing attribute is returned as index 0, which OBJ never uses (indices are 1-based).
+static const char * parseObjCorner(const char * p, const char * end, unsigned int & v, unsigned int & vt, unsigned int & vn){
+	vt = 0;
+	vn = 0;
+	p = parseObjIndex(p, end, v);
+	if (p == NULL)
+		return NULL;
+	if (p < end && *p == '/'){
+		p++;
+		if (p < end && *p != '/'){
+			p = parseObjIndex(p, end, vt);
+			if (p == NULL)
+				return NULL;
+		}
+		if (p < end && *p == '/'){
+			p++;
+			p = parseObjIndex(p, end, vn);
+			if (p == NULL)
+				return NULL;
+		}
+	}
+	if (p < end && !isObjSpace(*p))
+		return NULL;
+	return p;
+}
+
+// Parses every record in [begin, end) into "records".
+// Records is ObjRecords or IndexedObjRecords : attributes go to its vertices/uvs/normals arrays,
+// faces to its addTriangle(). Polygons with more than 3 corners are triangulated as a fan.
+template <typename Records>
+static bool parseOBJRecords(const char * begin, const char * end, Records & records){
+	const char * p = begin;
+	while (p < end){
+		const char * lineEnd = (const char *)memchr(p, '\n', end - p);
+		if (lineEnd == NULL)
+			lineEnd = end;
+
+		p = skipObjSpaces(p, lineEnd);
+		size_t length = lineEnd - p;
+
+		if (length >= 2 && p[0] == 'v' && isObjSpace(p[1])){
+			glm::vec3 vertex;
+			const char * q = parseObjFloat(p + 2, lineEnd, vertex.x);
+			if (q) q = parseObjFloat(q, lineEnd, vertex.y);
+			if (q) q = parseObjFloat(q, lineEnd, vertex.z);
+			if (q == NULL) return false;
+			records.vertices.push_back(vertex);
+		}else if (length >= 3 && p[0] == 'v' && p[1] == 't' && isObjSpace(p[2])){
+			glm::vec2 uv;
+			const char * q = parseObjFloat(p + 3, lineEnd, uv.x);
+			if (q) q = parseObjFloat(q, lineEnd, uv.y);
+			if (q == NULL) return false;
+			uv.y = -uv.y; // Same DDS convention as loadOBJ
+			records.uvs.push_back(uv);
+		}else if (length >= 3 && p[0] == 'v' && p[1] == 'n' && isObjSpace(p[2])){
+			glm::vec3 normal;
+			const char * q = parseObjFloat(p + 3, lineEnd, normal.x);
+			if (q) q = parseObjFloat(q, lineEnd, normal.y);
+			if (q) q = parseObjFloat(q, lineEnd, normal.z);
+			if (q == NULL) return false;
+			records.normals.push_back(normal);
+		}else if (length >= 2 && p[0] == 'f' && isObjSpace(p[1])){
+			unsigned int first[3], previous[3], current[3];
+			int corners = 0;
+			const char * q = skipObjSpaces(p + 2, lineEnd);
+			while (q < lineEnd){
+				q = parseObjCorner(q, lineEnd, current[0], current[1], current[2]);
+				if (q == NULL) return false;
+				if (corners == 0){
+					memcpy(first, current, sizeof(first));
+				}else if (corners >= 2){
+					records.addTriangle(first, previous, current);
+				}
+				memcpy(previous, current, sizeof(previous));
+				corners++;
+				q = skipObjSpaces(q, lineEnd);
+			}
+			if (corners < 3) return false;
+		}
+		// Anything else (comments, o, g, s, usemtl, mtllib...) is skipped
+
+		p = lineEnd < end ? lineEnd + 1 : end;
+	}
+	return true;
+}
+
+// Resolves the 1-based face indices of corners [first, last) into flat per-corner arrays, like loadOBJ does.
+// out_XXX point to the slot of corner 0 and must already be large enough.
+// A corner without UV or normal gets a zero UV / normal.
+static bool expandOBJRange(
+	const ObjRecords & records,
+	size_t first, size_t last,
+	glm::vec3 * out_vertices,
+	glm::vec2 * out_uvs,
+	glm::vec3 * out_normals
+){
+	for (size_t i = first; i < last; i++){
+		unsigned int vertexIndex = records.vertexIndices[i];
+		unsigned int uvIndex = records.uvIndices[i];
+		unsigned int normalIndex = records.normalIndices[i];
+
+		if (vertexIndex - 1 >= records.vertices.size() ||
+			(uvIndex != 0 && uvIndex - 1 >= records.uvs.size()) ||
+			(normalIndex != 0 && normalIndex - 1 >= records.normals.size())){
+			printf("Face %u references an attribute that does not exist\n", (unsigned int)(i / 3));
+			return false;
+		}
+
+		out_vertices[i] = records.vertices[vertexIndex - 1];
+		out_uvs     [i] = uvIndex != 0 ? records.uvs[uvIndex - 1] : glm::vec2(0.0f, 0.0f);
+		out_normals [i] = normalIndex != 0 ? records.normals[normalIndex - 1] : glm::vec3(0.0f, 0.0f, 0.0f);
+	}
+	return true;
+}
+
+// Appends every corner of "records" to out_XXX
+static bool expandOBJRecords(
+	const ObjRecords & records,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	size_t base = out_vertices.size();
+	size_t count = records.vertexIndices.size();
+	if (count == 0)
+		return true;
+	out_vertices.resize(base + count);
+	out_uvs     .resize(base + count);
+	out_normals .resize(base + count);
+	return expandOBJRange(records, 0, count, &out_vertices[base], &out_uvs[base], &out_normals[base]);
+}
+
+bool loadOBJ_mmap(
+	const char * path, 
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	printf("Loading OBJ file %s...\n", path);
+
+	MappedFile file;
+	if (!mapFile(path, file)){
+		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		return false;
+	}
+
+	ObjRecords records;
+	bool res = parseOBJRecords(file.data, file.data + file.size, records);
+	unmapFile(file);
+	if (!res){
+		printf("File can't be read by our simple parser :-( Try exporting with other options\n");
+		return false;
+	}
+
+	return expandOBJRecords(records, out_vertices, out_uvs, out_normals);
+}
+
+
+template <typename T>
+static void copyInto(const std::vector<T> & source, std::vector<T> & destination, size_t offset){
+	if (!source.empty())
+		memcpy(&destination[offset], &source[0], source.size() * sizeof(T));
+}
+
+bool loadOBJ_parallel(
+	const char * path, 
+	std::vector<glm::vec3> & out_vertices, 
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	unsigned int threadCount
+){
+	printf("Loading OBJ file %s...\n", path);
+
+	MappedFile file;
+	if (!mapFile(path, file)){
+		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		return false;
+	}
+
+	ThreadPool & pool = defaultThreadPool();
+	if (threadCount == 0)
+		threadCount = pool.size() + 1; // the calling thread works too
+
+	// Below a few pages per chunk, waking the workers costs more than it saves
+	const size_t minChunkSize = 256 * 1024;
+	size_t maxChunks = file.size / minChunkSize;
+	unsigned int chunkCount = maxChunks < threadCount ? (unsigned int)maxChunks : threadCount;
+	if (chunkCount == 0)
+		chunkCount = 1;
+
+	// Split the file in equal parts, each boundary moved forward to the start of the next line
+	const char * begin = file.data;
+	const char * end = file.data + file.size;
+	std::vector<const char *> bounds(chunkCount + 1);
+	bounds[0] = begin;
+	bounds[chunkCount] = end;
+	for (unsigned int i = 1; i < chunkCount; i++){
+		const char * p = begin + file.size / chunkCount * i;
+		if (p < bounds[i - 1])
+			p = bounds[i - 1];
+		const char * newline = (const char *)memchr(p, '\n', end - p);
+		bounds[i] = newline ? newline + 1 : end;
+	}
+
+	std::vector<ObjRecords> chunks(chunkCount);
+	std::vector<char> chunkOK(chunkCount, 0);
+	pool.parallelFor(chunkCount, [&](unsigned int i){
+		chunkOK[i] = parseOBJRecords(bounds[i], bounds[i + 1], chunks[i]);
+	});
+	unmapFile(file);
+	for (unsigned int i = 0; i < chunkCount; i++){
+		if (!chunkOK[i]){
+			printf("File can't be read by our simple parser :-( Try exporting with other options\n");
+			return false;
+		}
+	}
+
+	// Prefix sums : where the records of each chunk land in the merged arrays.
+	// Chunks stay in file order, so the (absolute) face indices resolve exactly as in a sequential parse.
+	std::vector<size_t> vertexOffset(chunkCount + 1, 0), uvOffset(chunkCount + 1, 0), normalOffset(chunkCount + 1, 0), cornerOffset(chunkCount + 1, 0);
+	for (unsigned int i = 0; i < chunkCount; i++){
+		vertexOffset[i + 1] = vertexOffset[i] + chunks[i].vertices.size();
+		uvOffset    [i + 1] = uvOffset[i]     + chunks[i].uvs.size();
+		normalOffset[i + 1] = normalOffset[i] + chunks[i].normals.size();
+		cornerOffset[i + 1] = cornerOffset[i] + chunks[i].vertexIndices.size();
+	}
+
+	ObjRecords merged;
+	if (chunkCount == 1){
+		merged.vertices.swap(chunks[0].vertices);
+		merged.uvs.swap(chunks[0].uvs);
+		merged.normals.swap(chunks[0].normals);
+		merged.vertexIndices.swap(chunks[0].vertexIndices);
+		merged.uvIndices.swap(chunks[0].uvIndices);
+		merged.normalIndices.swap(chunks[0].normalIndices);
+	}else{
+		merged.vertices.resize(vertexOffset[chunkCount]);
+		merged.uvs.resize(uvOffset[chunkCount]);
+		merged.normals.resize(normalOffset[chunkCount]);
+		merged.vertexIndices.resize(cornerOffset[chunkCount]);
+		merged.uvIndices.resize(cornerOffset[chunkCount]);
+		merged.normalIndices.resize(cornerOffset[chunkCount]);
+		pool.parallelFor(chunkCount, [&](unsigned int i){
+			copyInto(chunks[i].vertices, merged.vertices, vertexOffset[i]);
+			copyInto(chunks[i].uvs, merged.uvs, uvOffset[i]);
+			copyInto(chunks[i].normals, merged.normals, normalOffset[i]);
+			copyInto(chunks[i].vertexIndices, merged.vertexIndices, cornerOffset[i]);
+			copyInto(chunks[i].uvIndices, merged.uvIndices, cornerOffset[i]);
+			copyInto(chunks[i].normalIndices, merged.normalIndices, cornerOffset[i]);
+			chunks[i] = ObjRecords(); // release the chunk as soon as it is merged
+		});
+	}
+
+	// Resolve the faces, each thread taking the corners its chunk produced
+	size_t base = out_vertices.size();
+	size_t count = cornerOffset[chunkCount];
+	if (count == 0)
+		return true;
+	out_vertices.resize(base + count);
+	out_uvs     .resize(base + count);
+	out_normals .resize(base + count);
+	pool.parallelFor(chunkCount, [&](unsigned int i){
+		chunkOK[i] = expandOBJRange(merged, cornerOffset[i], cornerOffset[i + 1], &out_vertices[base], &out_uvs[base], &out_normals[base]);
+	});
+	for (unsigned int i = 0; i < chunkCount; i++){
+		if (!chunkOK[i])
+			return false;
+	}
+	return true;
+}
+
+
+// One face corner. Corners are welded by their exact OBJ indices : two corners share
+// a vertex only if they use the same three indices.
+struct ObjCorner{
+	unsigned int v, vt, vn;
+};
+
+// OBJ records where faces are welded as they are parsed : only the unique corners and the index buffer are kept.
+struct IndexedObjRecords{
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	VertexHashTable<ObjCorner> table;
+	std::vector<unsigned int> indices;
+
+	void addTriangle(const unsigned int a[3], const unsigned int b[3], const unsigned int c[3]){
+		ObjCorner corners[3] = {{a[0], a[1], a[2]}, {b[0], b[1], b[2]}, {c[0], c[1], c[2]}};
+		indices.push_back(table.findOrInsert(corners[0]));
+		indices.push_back(table.findOrInsert(corners[1]));
+		indices.push_back(table.findOrInsert(corners[2]));
+	}
+};
+
+bool loadOBJ_indexed(
+	const char * path,
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	printf("Loading OBJ file %s...\n", path);
+
+	MappedFile file;
+	if (!mapFile(path, file)){
+		printf("Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details\n");
+		return false;
+	}
+
+	IndexedObjRecords records;
+	bool res = parseOBJRecords(file.data, file.data + file.size, records);
+	unmapFile(file);
+	if (!res){
+		printf("File can't be read by our simple parser :-( Try exporting with other options\n");
+		return false;
+	}
+
+	size_t base = out_vertices.size();
+	unsigned int count = (unsigned int)records.table.size();
+
+	// Resolve the unique corners only, in first-use order (the same order indexVBO produces)
+	out_vertices.reserve(base + count);
+	out_uvs     .reserve(base + count);
+	out_normals .reserve(base + count);
+	for (unsigned int i = 0; i < count; i++){
+		const ObjCorner & key = records.table.key(i);
+		const unsigned int corner[3] = {key.v, key.vt, key.vn};
+		if (corner[0] - 1 >= records.vertices.size() ||
+			(corner[1] != 0 && corner[1] - 1 >= records.uvs.size()) ||
+			(corner[2] != 0 && corner[2] - 1 >= records.normals.size())){
+			printf("A face references an attribute that does not exist\n");
+			return false;
+		}
+		out_vertices.push_back(records.vertices[corner[0] - 1]);
+		out_uvs     .push_back(corner[1] != 0 ? records.uvs[corner[1] - 1] : glm::vec2(0.0f, 0.0f));
+		out_normals .push_back(corner[2] != 0 ? records.normals[corner[2] - 1] : glm::vec3(0.0f, 0.0f, 0.0f));
+	}
+
+	out_indices.reserve(out_indices.size() + records.indices.size());
+	for (size_t i = 0; i < records.indices.size(); i++)
+		out_indices.push_back((unsigned int)(base + records.indices[i]));
+	return true;
+}
+
+
 #ifdef USE_ASSIMP // don't use this #define, it's only for me (it AssImp fails to compile on your machine, at least all the other tutorials still work)
 
 // Include AssImp
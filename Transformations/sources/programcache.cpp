@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "programcache.hpp"
+#include "meshcache.hpp"
+
+static const char programCacheMagic[4] = {'P', 'R', 'G', 'C'};
+
+bool programBinarySupported(){
+	if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+static void appendDriverString(std::string & text, GLenum name){
+	const GLubyte * value = glGetString(name);
+	if (value != NULL)
+		text += (const char *)value;
+	text += '\0';
+}
+
+uint64_t programCacheKey(const std::string * sources, int count){
+	// The zeros keep "ab" + "c" and "a" + "bc" apart
+	std::string text;
+	for (int i = 0; i < count; i++){
+		text += sources[i];
+		text += '\0';
+	}
+	appendDriverString(text, GL_VENDOR);
+	appendDriverString(text, GL_RENDERER);
+	appendDriverString(text, GL_VERSION);
+	return hashMeshSource(text.data(), text.size());
+}
+
+GLuint loadCachedProgram(const char * cachePath, uint64_t key){
+	if (!programBinarySupported())
+		return 0;
+	FILE * file = fopen(cachePath, "rb");
+	if (file == NULL)
+		return 0; // no cache yet, nothing to report
+
+	ProgramCacheHeader header;
+	std::vector<char> binary;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+		memcmp(header.magic, programCacheMagic, 4) == 0 &&
+		header.version == PROGRAMCACHE_VERSION &&
+		header.key == key &&
+		header.binarySize > 0;
+	if (valid){
+		binary.resize(header.binarySize);
+		valid = fread(&binary[0], 1, binary.size(), file) == binary.size();
+	}
+	fclose(file);
+	if (!valid){
+		printf("Program cache %s is out of date\n", cachePath);
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.binaryFormat, &binary[0], (GLsizei)binary.size());
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE){
+		printf("Program cache %s was refused by the driver\n", cachePath);
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+// Writes the cache to a temporary file and moves it into place, so a reader never sees half a cache
+bool saveCachedProgram(const char * cachePath, uint64_t key, GLuint program){
+	if (!programBinarySupported())
+		return false;
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+	std::vector<char> binary(length);
+	GLsizei written = 0;
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &written, &format, &binary[0]);
+	if (written <= 0)
+		return false;
+
+	ProgramCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, programCacheMagic, 4);
+	header.version = PROGRAMCACHE_VERSION;
+	header.key = key;
+	header.binaryFormat = format;
+	header.binarySize = (uint32_t)written;
+
+	std::string tempPath = std::string(cachePath) + ".tmp";
+	FILE * file = fopen(tempPath.c_str(), "wb");
+	if (file == NULL)
+		return false;
+	bool res = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(&binary[0], 1, written, file) == (size_t)written;
+	res = (fclose(file) == 0) && res;
+	if (res){
+		remove(cachePath); // rename() does not replace an existing file on Windows
+		res = rename(tempPath.c_str(), cachePath) == 0;
+	}
+	if (!res)
+		remove(tempPath.c_str());
+	return res;
+}
@@ -0,0 +1,101 @@
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "renderqueue.hpp"
+
+#define RENDER_KEY_DEPTH_SHIFT 0
+#define RENDER_KEY_VERTEX_ARRAY_SHIFT (RENDER_KEY_DEPTH_SHIFT + RENDER_KEY_DEPTH_BITS)
+#define RENDER_KEY_MATERIAL_SHIFT (RENDER_KEY_VERTEX_ARRAY_SHIFT + RENDER_KEY_VERTEX_ARRAY_BITS)
+#define RENDER_KEY_PROGRAM_SHIFT (RENDER_KEY_MATERIAL_SHIFT + RENDER_KEY_MATERIAL_BITS)
+#define RENDER_KEY_PASS_SHIFT (RENDER_KEY_PROGRAM_SHIFT + RENDER_KEY_PROGRAM_BITS)
+
+static uint64_t keyField(unsigned int value, unsigned int bits, unsigned int shift){
+	return (uint64_t)(value & ((1u << bits) - 1)) << shift;
+}
+
+uint64_t makeSortKey(RenderPass pass, unsigned int program, unsigned int material, unsigned int vertexArray, float depth, float farDepth){
+	const unsigned int depthMax = (1u << RENDER_KEY_DEPTH_BITS) - 1;
+	float t = farDepth > 0 ? depth / farDepth : 0.0f;
+	t = t < 0 ? 0.0f : (t > 1 ? 1.0f : t);
+	unsigned int quantized = (unsigned int)(t * depthMax + 0.5f);
+	if (pass == RENDER_PASS_BLENDED)
+		quantized = depthMax - quantized;
+	return keyField(pass, RENDER_KEY_PASS_BITS, RENDER_KEY_PASS_SHIFT)
+		| keyField(program, RENDER_KEY_PROGRAM_BITS, RENDER_KEY_PROGRAM_SHIFT)
+		| keyField(material, RENDER_KEY_MATERIAL_BITS, RENDER_KEY_MATERIAL_SHIFT)
+		| keyField(vertexArray, RENDER_KEY_VERTEX_ARRAY_BITS, RENDER_KEY_VERTEX_ARRAY_SHIFT)
+		| keyField(quantized, RENDER_KEY_DEPTH_BITS, RENDER_KEY_DEPTH_SHIFT);
+}
+
+void RenderQueue::push(uint64_t key, unsigned int item){
+	RenderPacket packet;
+	packet.key = key;
+	packet.item = item;
+	packets.push_back(packet);
+}
+
+void RenderQueue::sort(){
+	size_t count = packets.size();
+	if (count < 2)
+		return;
+
+	// One histogram per byte in a single read of the keys
+	size_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++){
+		uint64_t key = packets[i].key;
+		for (int b = 0; b < 8; b++)
+			histograms[b][(key >> (b * 8)) & 0xFF]++;
+	}
+
+	scratch.resize(count);
+	RenderPacket * from = &packets[0];
+	RenderPacket * to = &scratch[0];
+	for (int b = 0; b < 8; b++){
+		size_t * histogram = histograms[b];
+		// every key has the same byte here : the pass would keep the order
+		if (histogram[(packets[0].key >> (b * 8)) & 0xFF] == count)
+			continue;
+		size_t offset = 0;
+		for (int v = 0; v < 256; v++){
+			size_t n = histogram[v];
+			histogram[v] = offset;
+			offset += n;
+		}
+		for (size_t i = 0; i < count; i++)
+			to[histogram[(from[i].key >> (b * 8)) & 0xFF]++] = from[i];
+		RenderPacket * swap = from;
+		from = to;
+		to = swap;
+	}
+	if (from != &packets[0])
+		packets.swap(scratch);
+}
+
+void RenderStateTracker::reset(){
+	program = material = vertexArray = 0;
+	known[0] = known[1] = known[2] = false;
+	stateChanges = 0;
+}
+
+bool RenderStateTracker::change(unsigned int & current, bool & isKnown, unsigned int value){
+	if (isKnown && current == value)
+		return false;
+	current = value;
+	isKnown = true;
+	stateChanges++;
+	return true;
+}
+
+bool RenderStateTracker::useProgram(unsigned int value){
+	return change(program, known[0], value);
+}
+
+bool RenderStateTracker::bindMaterial(unsigned int value){
+	return change(material, known[1], value);
+}
+
+bool RenderStateTracker::bindVertexArray(unsigned int value){
+	return change(vertexArray, known[2], value);
+}
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <chrono>
 using namespace std;
 
 #include <stdlib.h>
@@ -12,22 +13,32 @@ using namespace std;
 #include <GL/glew.h>
 
 #include "shader.hpp"
+#include "programcache.hpp"
+
+// Reads a whole file in one go ; false if it cannot be opened
+static bool readShaderFile(const char * path, std::string & out_code){
+	std::ifstream stream(path, std::ios::in | std::ios::binary);
+	if (!stream.is_open())
+		return false;
+	stream.seekg(0, std::ios::end);
+	std::streamoff size = stream.tellg();
+	stream.seekg(0, std::ios::beg);
+	out_code.resize(size > 0 ? (size_t)size : 0);
+	if (size > 0)
+		stream.read(&out_code[0], size);
+	return true;
+}
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+static double millisecondsSince(std::chrono::steady_clock::time_point start){
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
 	// Read the Vertex Shader code from the file
 	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	}else{
+	if(!readShaderFile(vertex_file_path, VertexShaderCode)){
 		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
 		getchar();
 		return 0;
@@ -35,15 +46,21 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 
 	// Read the Fragment Shader code from the file
 	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+	readShaderFile(fragment_file_path, FragmentShaderCode);
+
+	// A program linked from the same sources by the same driver is loaded as is (programcache.hpp)
+	std::string CachePath = std::string(vertex_file_path) + ".programcache";
+	std::string Sources[2] = {VertexShaderCode, FragmentShaderCode};
+	uint64_t CacheKey = programCacheKey(Sources, 2);
+	GLuint CachedProgramID = loadCachedProgram(CachePath.c_str(), CacheKey);
+	if (CachedProgramID != 0){
+		printf("Loaded program %s from the program cache in %.1f ms\n", vertex_file_path, millisecondsSince(start));
+		return CachedProgramID;
 	}
 
-
+	// Create the shaders
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
 
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
@@ -89,6 +106,8 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	GLuint ProgramID = glCreateProgram();
 	glAttachShader(ProgramID, VertexShaderID);
 	glAttachShader(ProgramID, FragmentShaderID);
+	if (programBinarySupported())
+		glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ProgramID);
 
 	// Check the program
@@ -103,6 +122,10 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
+	if (Result == GL_TRUE && !saveCachedProgram(CachePath.c_str(), CacheKey, ProgramID) && programBinarySupported())
+		printf("Could not write program cache %s\n", CachePath.c_str());
+	printf("Compiled program %s in %.1f ms\n", vertex_file_path, millisecondsSince(start));
+
 	return ProgramID;
 }
 
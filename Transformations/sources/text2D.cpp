@@ -9,10 +9,12 @@ using namespace glm;
 
 #include "shader.hpp"
 #include "texture.hpp"
+#include "glstate.hpp"
 
 #include "text2D.hpp"
 
 unsigned int Text2DTextureID;
+unsigned int Text2DVertexArrayID;
 unsigned int Text2DVertexBufferID;
 unsigned int Text2DUVBufferID;
 unsigned int Text2DShaderID;
@@ -27,6 +29,21 @@ void initText2D(const char * texturePath){
 	glGenBuffers(1, &Text2DVertexBufferID);
 	glGenBuffers(1, &Text2DUVBufferID);
 
+	// The attribute setup is recorded once in a VAO, printing only binds it
+	glGenVertexArrays(1, &Text2DVertexArrayID);
+	glStateBindVertexArray(Text2DVertexArrayID);
+
+	// 1rst attribute buffer : vertices
+	glStateEnableVertexAttribArray(0);
+	glStateBindBuffer(GL_ARRAY_BUFFER, Text2DVertexBufferID);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0 );
+
+	// 2nd attribute buffer : UVs
+	glStateEnableVertexAttribArray(1);
+	glStateBindBuffer(GL_ARRAY_BUFFER, Text2DUVBufferID);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0 );
+	glStateBindVertexArray(0);
+
 	// Initialize Shader
 	Text2DShaderID = LoadShaders( "TextVertexShader.vertexshader", "TextVertexShader.fragmentshader" );
 
@@ -73,52 +90,42 @@ void printText2D(const char * text, int x, int y, int size){
 		UVs.push_back(uv_up_right);
 		UVs.push_back(uv_down_left);
 	}
-	glBindBuffer(GL_ARRAY_BUFFER, Text2DVertexBufferID);
+	glStateBindBuffer(GL_ARRAY_BUFFER, Text2DVertexBufferID);
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), &vertices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, Text2DUVBufferID);
+	glStateBindBuffer(GL_ARRAY_BUFFER, Text2DUVBufferID);
 	glBufferData(GL_ARRAY_BUFFER, UVs.size() * sizeof(glm::vec2), &UVs[0], GL_STATIC_DRAW);
 
 	// Bind shader
-	glUseProgram(Text2DShaderID);
+	glStateUseProgram(Text2DShaderID);
 
 	// Bind texture
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, Text2DTextureID);
+	glStateActiveTexture(GL_TEXTURE0);
+	glStateBindTexture(GL_TEXTURE_2D, Text2DTextureID);
 	// Set our "myTextureSampler" sampler to user Texture Unit 0
 	glUniform1i(Text2DUniformID, 0);
 
-	// 1rst attribute buffer : vertices
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, Text2DVertexBufferID);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0 );
-
-	// 2nd attribute buffer : UVs
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, Text2DUVBufferID);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0 );
+	glStateBindVertexArray(Text2DVertexArrayID);
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glStateEnable(GL_BLEND);
+	glStateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// Draw call
 	glDrawArrays(GL_TRIANGLES, 0, vertices.size() );
 
-	glDisable(GL_BLEND);
-
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
+	glStateDisable(GL_BLEND);
 
 }
 
 void cleanupText2D(){
 
 	// Delete buffers
-	glDeleteBuffers(1, &Text2DVertexBufferID);
-	glDeleteBuffers(1, &Text2DUVBufferID);
+	glStateDeleteBuffers(1, &Text2DVertexBufferID);
+	glStateDeleteBuffers(1, &Text2DUVBufferID);
+	glStateDeleteVertexArrays(1, &Text2DVertexArrayID);
 
 	// Delete texture
-	glDeleteTextures(1, &Text2DTextureID);
+	glStateDeleteTextures(1, &Text2DTextureID);
 
 	// Delete shader
-	glDeleteProgram(Text2DShaderID);
+	glStateDeleteProgram(Text2DShaderID);
 }
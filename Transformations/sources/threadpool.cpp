@@ -0,0 +1,98 @@
+#include <atomic>
+#include <memory>
+
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool(unsigned int threadCount) : stopping(false)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void ThreadPool::run(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(job);
+	}
+	wakeUp.notify_one();
+}
+
+void ThreadPool::parallelFor(unsigned int count, const std::function<void(unsigned int)> & job)
+{
+	if (count == 0)
+		return;
+	if (count == 1){
+		job(0);
+		return;
+	}
+
+	// Every thread (the caller included) grabs the next index until none is left.
+	// Helpers that only get scheduled after the loop is over still touch this state, hence the shared_ptr.
+	struct State{
+		std::atomic<unsigned int> next;
+		std::atomic<unsigned int> finished;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	std::shared_ptr<State> state = std::make_shared<State>();
+	state->next = 0;
+	state->finished = 0;
+	const std::function<void(unsigned int)> * body = &job;
+
+	std::function<void()> drain = [state, body, count](){
+		unsigned int i;
+		while ((i = state->next.fetch_add(1)) < count){
+			(*body)(i);
+			if (state->finished.fetch_add(1) + 1 == count){
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->done.notify_all();
+			}
+		}
+	};
+
+	unsigned int helpers = count - 1 < size() ? count - 1 : size();
+	for (unsigned int i = 0; i < helpers; i++)
+		run(drain);
+	drain();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&](){ return state->finished.load() == count; });
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true){
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeUp.wait(lock, [this](){ return stopping || !jobs.empty(); });
+			if (stopping && jobs.empty())
+				return;
+			job = jobs.front();
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+ThreadPool & defaultThreadPool()
+{
+	static ThreadPool pool;
+	return pool;
+}
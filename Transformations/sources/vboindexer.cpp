@@ -1,11 +1,16 @@
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <stdio.h>
 
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include "vboindexer.hpp"
+#include "vertexhash.hpp"
 
 #include <string.h> // for memcmp
+#include <math.h>
 
 
 // Returns true iif v1 can be considered equal to v2
@@ -46,7 +51,45 @@ bool getSimilarVertexIndex(
 	return false;
 }
 
-void indexVBO_slow(
+// The 16-bit indexers can number 65536 vertices. Past that their indices wrap, so the call is taken back : the
+// outputs return to their sizes before it (indexCount, vertexCount) and the indexer returns false
+static bool keepShortIndices(
+	size_t indexCount, size_t vertexCount,
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	if (out_vertices.size() <= 65536)
+		return true;
+	printf("%u vertices do not fit 16-bit indices, use the unsigned int version of the indexer\n", (unsigned int)out_vertices.size());
+	out_indices.resize(indexCount);
+	out_vertices.resize(vertexCount);
+	out_uvs.resize(vertexCount);
+	out_normals.resize(vertexCount);
+	return false;
+}
+
+// Same, for the TBN indexers : they also summed tangents into the vertices already there, restored from the copies
+static bool keepShortIndicesTBN(
+	size_t indexCount, size_t vertexCount,
+	const std::vector<glm::vec3> & tangentsBefore,
+	const std::vector<glm::vec3> & bitangentsBefore,
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<glm::vec3> & out_tangents,
+	std::vector<glm::vec3> & out_bitangents
+){
+	if (keepShortIndices(indexCount, vertexCount, out_indices, out_vertices, out_uvs, out_normals))
+		return true;
+	out_tangents = tangentsBefore;
+	out_bitangents = bitangentsBefore;
+	return false;
+}
+
+bool indexVBO_slow(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
 	std::vector<glm::vec3> & in_normals,
@@ -56,6 +99,8 @@ void indexVBO_slow(
 	std::vector<glm::vec2> & out_uvs,
 	std::vector<glm::vec3> & out_normals
 ){
+	size_t indexCount = out_indices.size(), vertexCount = out_vertices.size();
+
 	// For each input vertex
 	for ( unsigned int i=0; i<in_vertices.size(); i++ ){
 
@@ -72,6 +117,7 @@ void indexVBO_slow(
 			out_indices .push_back( (unsigned short)out_vertices.size() - 1 );
 		}
 	}
+	return keepShortIndices(indexCount, vertexCount, out_indices, out_vertices, out_uvs, out_normals);
 }
 
 struct PackedVertex{
@@ -97,7 +143,8 @@ bool getSimilarVertexIndex_fast(
 	}
 }
 
-void indexVBO(
+// Reference implementation kept for comparison : one tree node per unique vertex, O(n log n)
+bool indexVBO_map(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
 	std::vector<glm::vec3> & in_normals,
@@ -107,6 +154,7 @@ void indexVBO(
 	std::vector<glm::vec2> & out_uvs,
 	std::vector<glm::vec3> & out_normals
 ){
+	size_t indexCount = out_indices.size(), vertexCount = out_vertices.size();
 	std::map<PackedVertex,unsigned short> VertexToOutIndex;
 
 	// For each input vertex
@@ -130,15 +178,79 @@ void indexVBO(
 			VertexToOutIndex[ packed ] = newindex;
 		}
 	}
+	return keepShortIndices(indexCount, vertexCount, out_indices, out_vertices, out_uvs, out_normals);
 }
 
+template <typename Index>
+static void indexVBO_hashed(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+
+	std::vector<Index> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	// Welded vertices are numbered in first-use order, exactly like the std::map version did
+	VertexHashTable<PackedVertex> VertexToOutIndex(in_vertices.size() / 4);
+	size_t base = out_vertices.size();
+	out_indices.reserve(out_indices.size() + in_vertices.size());
 
+	// For each input vertex
+	for ( unsigned int i=0; i<in_vertices.size(); i++ ){
 
+		PackedVertex packed = {in_vertices[i], in_uvs[i], in_normals[i]};
 
+		bool inserted;
+		unsigned int index = VertexToOutIndex.findOrInsert(packed, inserted);
 
+		if ( inserted ){ // New vertex, it needs to be added in the output data.
+			out_vertices.push_back( in_vertices[i]);
+			out_uvs     .push_back( in_uvs[i]);
+			out_normals .push_back( in_normals[i]);
+		}
+		out_indices.push_back( (Index)(base + index) );
+	}
+}
 
 
-void indexVBO_TBN(
+bool indexVBO(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	size_t indexCount = out_indices.size(), vertexCount = out_vertices.size();
+	indexVBO_hashed(in_vertices, in_uvs, in_normals, out_indices, out_vertices, out_uvs, out_normals);
+	return keepShortIndices(indexCount, vertexCount, out_indices, out_vertices, out_uvs, out_normals);
+}
+
+bool indexVBO(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals
+){
+	indexVBO_hashed(in_vertices, in_uvs, in_normals, out_indices, out_vertices, out_uvs, out_normals);
+	return true;
+}
+
+
+
+
+
+
+// Reference implementation kept for comparison : quadratic search through every exported vertex
+bool indexVBO_TBN_slow(
 	std::vector<glm::vec3> & in_vertices,
 	std::vector<glm::vec2> & in_uvs,
 	std::vector<glm::vec3> & in_normals,
@@ -152,6 +264,9 @@ void indexVBO_TBN(
 	std::vector<glm::vec3> & out_tangents,
 	std::vector<glm::vec3> & out_bitangents
 ){
+	size_t indexCount = out_indices.size(), vertexCount = out_vertices.size();
+	std::vector<glm::vec3> tangentsBefore(out_tangents), bitangentsBefore(out_bitangents);
+
 	// For each input vertex
 	for ( unsigned int i=0; i<in_vertices.size(); i++ ){
 
@@ -174,4 +289,245 @@ void indexVBO_TBN(
 			out_indices .push_back( (unsigned short)out_vertices.size() - 1 );
 		}
 	}
+	return keepShortIndicesTBN(indexCount, vertexCount, tangentsBefore, bitangentsBefore,
+		out_indices, out_vertices, out_uvs, out_normals, out_tangents, out_bitangents);
+}
+
+// Uniform grid over vertex positions, with cells four times the is_near tolerance.
+// A vertex near a position lies in one of the cells overlapped by the box of half-size 0.01
+// around it : usually 1 to 8 cells instead of the whole VBO.
+struct GridCell{
+	int x, y, z;
+};
+
+static const float GRID_CELL_SIZE = 0.04f;
+static const float GRID_SEARCH_RADIUS = 0.0101f; // the tolerance, padded against rounding at cell borders
+
+static int gridCoordinate(float v){
+	return (int)floor(v / GRID_CELL_SIZE);
+}
+
+static GridCell gridCellOf(const glm::vec3 & position){
+	GridCell cell = {gridCoordinate(position.x), gridCoordinate(position.y), gridCoordinate(position.z)};
+	return cell;
+}
+
+template <typename Index>
+static void indexVBO_TBN_grid(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	std::vector<glm::vec3> & in_tangents,
+	std::vector<glm::vec3> & in_bitangents,
+
+	std::vector<Index> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<glm::vec3> & out_tangents,
+	std::vector<glm::vec3> & out_bitangents
+){
+	// Exported vertices of each cell, as singly-linked lists in export order
+	VertexHashTable<GridCell> cells(in_vertices.size() / 4);
+	std::vector<unsigned int> cellHead, cellTail;
+	std::vector<unsigned int> nextInCell(out_vertices.size(), ~0u);
+
+	// Vertices already in out_XXXX take part in the search, like with getSimilarVertexIndex
+	for ( unsigned int i=0; i<out_vertices.size(); i++ ){
+		bool inserted;
+		unsigned int cell = cells.findOrInsert(gridCellOf(out_vertices[i]), inserted);
+		if ( inserted ){
+			cellHead.push_back(i);
+			cellTail.push_back(i);
+		}else{
+			nextInCell[cellTail[cell]] = i;
+			cellTail[cell] = i;
+		}
+	}
+
+	// For each input vertex
+	for ( unsigned int i=0; i<in_vertices.size(); i++ ){
+
+		// Same answer as getSimilarVertexIndex : the first exported vertex that is near in all 8 components.
+		// The first match of each cell is its lowest index, so we keep the lowest over the cells searched.
+		const glm::vec3 & p = in_vertices[i];
+		GridCell lo = gridCellOf(p - glm::vec3(GRID_SEARCH_RADIUS));
+		GridCell hi = gridCellOf(p + glm::vec3(GRID_SEARCH_RADIUS));
+		unsigned int best = ~0u;
+		for ( int z=lo.z; z<=hi.z; z++ ){
+			for ( int y=lo.y; y<=hi.y; y++ ){
+				for ( int x=lo.x; x<=hi.x; x++ ){
+					GridCell neighbour = {x, y, z};
+					unsigned int cell;
+					if ( !cells.find(neighbour, cell) )
+						continue;
+					for ( unsigned int j=cellHead[cell]; j!=~0u && j<best; j=nextInCell[j] ){
+						if (
+							is_near( in_vertices[i].x , out_vertices[j].x ) &&
+							is_near( in_vertices[i].y , out_vertices[j].y ) &&
+							is_near( in_vertices[i].z , out_vertices[j].z ) &&
+							is_near( in_uvs[i].x      , out_uvs     [j].x ) &&
+							is_near( in_uvs[i].y      , out_uvs     [j].y ) &&
+							is_near( in_normals[i].x  , out_normals [j].x ) &&
+							is_near( in_normals[i].y  , out_normals [j].y ) &&
+							is_near( in_normals[i].z  , out_normals [j].z )
+						){
+							best = j;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if ( best != ~0u ){ // A similar vertex is already in the VBO, use it instead !
+			unsigned int index = best;
+			out_indices.push_back( (Index)index );
+
+			// Average the tangents and the bitangents
+			out_tangents[index] += in_tangents[i];
+			out_bitangents[index] += in_bitangents[i];
+		}else{ // If not, it needs to be added in the output data.
+			out_vertices.push_back( in_vertices[i]);
+			out_uvs     .push_back( in_uvs[i]);
+			out_normals .push_back( in_normals[i]);
+			out_tangents .push_back( in_tangents[i]);
+			out_bitangents .push_back( in_bitangents[i]);
+			unsigned int newindex = (unsigned int)out_vertices.size() - 1;
+			out_indices .push_back( (Index)newindex );
+
+			bool inserted;
+			unsigned int cell = cells.findOrInsert(gridCellOf(in_vertices[i]), inserted);
+			nextInCell.push_back(~0u);
+			if ( inserted ){
+				cellHead.push_back(newindex);
+				cellTail.push_back(newindex);
+			}else{
+				nextInCell[cellTail[cell]] = newindex;
+				cellTail[cell] = newindex;
+			}
+		}
+	}
+}
+
+bool indexVBO_TBN(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	std::vector<glm::vec3> & in_tangents,
+	std::vector<glm::vec3> & in_bitangents,
+
+	std::vector<unsigned short> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<glm::vec3> & out_tangents,
+	std::vector<glm::vec3> & out_bitangents
+){
+	// the copies undo the sums into vertices that were already there : empty, and free, for a fresh mesh
+	size_t indexCount = out_indices.size(), vertexCount = out_vertices.size();
+	std::vector<glm::vec3> tangentsBefore(out_tangents), bitangentsBefore(out_bitangents);
+	indexVBO_TBN_grid(in_vertices, in_uvs, in_normals, in_tangents, in_bitangents, out_indices, out_vertices, out_uvs, out_normals, out_tangents, out_bitangents);
+	return keepShortIndicesTBN(indexCount, vertexCount, tangentsBefore, bitangentsBefore,
+		out_indices, out_vertices, out_uvs, out_normals, out_tangents, out_bitangents);
+}
+
+bool indexVBO_TBN(
+	std::vector<glm::vec3> & in_vertices,
+	std::vector<glm::vec2> & in_uvs,
+	std::vector<glm::vec3> & in_normals,
+	std::vector<glm::vec3> & in_tangents,
+	std::vector<glm::vec3> & in_bitangents,
+
+	std::vector<unsigned int> & out_indices,
+	std::vector<glm::vec3> & out_vertices,
+	std::vector<glm::vec2> & out_uvs,
+	std::vector<glm::vec3> & out_normals,
+	std::vector<glm::vec3> & out_tangents,
+	std::vector<glm::vec3> & out_bitangents
+){
+	indexVBO_TBN_grid(in_vertices, in_uvs, in_normals, in_tangents, in_bitangents, out_indices, out_vertices, out_uvs, out_normals, out_tangents, out_bitangents);
+	return true;
+}
+
+unsigned int narrowestIndexSize(size_t vertexCount){
+	if (vertexCount <= 256)
+		return 1;
+	if (vertexCount <= 65536)
+		return 2;
+	return 4;
+}
+
+void packIndices(const std::vector<unsigned int> & indices, unsigned int indexSize, std::vector<unsigned char> & out_data){
+	out_data.resize(indices.size() * indexSize);
+	if (indices.empty())
+		return;
+	if (indexSize == 4){
+		memcpy(&out_data[0], &indices[0], indices.size() * 4);
+	}else if (indexSize == 2){
+		unsigned short * out = (unsigned short *)&out_data[0];
+		for (size_t i = 0; i < indices.size(); i++)
+			out[i] = (unsigned short)indices[i];
+	}else{
+		for (size_t i = 0; i < indices.size(); i++)
+			out_data[i] = (unsigned char)indices[i];
+	}
+}
+
+void interleaveVertices(
+	const glm::vec3 * positions,
+	const glm::vec3 * normals,
+	const glm::vec2 * uvs,
+	size_t count,
+	std::vector<InterleavedVertex> & out_vertices
+){
+	out_vertices.resize(count);
+	for (size_t i = 0; i < count; i++){
+		out_vertices[i].position = positions[i];
+		out_vertices[i].normal = normals[i];
+		out_vertices[i].uv = uvs[i];
+	}
+}
+
+void quantizeVertices(
+	const glm::vec3 * positions,
+	const glm::vec3 * normals,
+	const glm::vec2 * uvs,
+	size_t count,
+	const glm::vec3 & boundsMin,
+	const glm::vec3 & boundsMax,
+	std::vector<QuantizedVertex> & out_vertices,
+	QuantizationError & out_error
+){
+	glm::vec3 extent = boundsMax - boundsMin;
+	out_vertices.resize(count);
+	out_error.position = 0;
+	out_error.normal = 0;
+	out_error.uv = 0;
+	for (size_t i = 0; i < count; i++){
+		QuantizedVertex & v = out_vertices[i];
+
+		glm::vec3 decodedPosition;
+		for (int c = 0; c < 3; c++){
+			// a flat mesh has no extent along some axis : every vertex sits on boundsMin there
+			float t = extent[c] > 0 ? (positions[i][c] - boundsMin[c]) / extent[c] : 0.0f;
+			v.position[c] = glm::packUnorm1x16(t);
+			decodedPosition[c] = boundsMin[c] + glm::unpackUnorm1x16(v.position[c]) * extent[c];
+		}
+		v.position[3] = 0;
+		out_error.position = std::max(out_error.position, glm::distance(positions[i], decodedPosition));
+
+		v.normal = glm::packSnorm3x10_1x2(glm::vec4(normals[i], 0.0f));
+		glm::vec4 decodedNormal = glm::unpackSnorm3x10_1x2(v.normal);
+		float normalLength = glm::length(normals[i]) * glm::length(glm::vec3(decodedNormal.x, decodedNormal.y, decodedNormal.z));
+		if (normalLength > 0){
+			float cosine = glm::dot(normals[i], glm::vec3(decodedNormal.x, decodedNormal.y, decodedNormal.z)) / normalLength;
+			out_error.normal = std::max(out_error.normal, glm::degrees(acosf(glm::clamp(cosine, -1.0f, 1.0f))));
+		}
+
+		for (int c = 0; c < 2; c++){
+			v.uv[c] = glm::packHalf1x16(uvs[i][c]);
+			out_error.uv = std::max(out_error.uv, fabsf(glm::unpackHalf1x16(v.uv[c]) - uvs[i][c]));
+		}
+	}
 }